@@ -1,6 +1,7 @@
 
 #include <Base/Math/Math.h>
 #include <Base/Math/Quat.h>
+#include <Base/Math/LinInline.h>
 
 float Vec3_dot(__reg("a1") Vec3* v0, __reg("a0") Vec3* v1)
 {
@@ -105,6 +106,22 @@ void Vec3_setMat34MulVec3(__reg("a2") Vec3* v, __reg("a0") Mat34* t0, __reg("a1"
 	Vec3_add(v, &temp, &t0->Move);
 }
 
+void Vec3_setMat34MulVec3Array(__reg("a2") Vec3* v, __reg("a0") Mat34 const* t0, __reg("a1") Vec3 const* v0, __reg("d0") s32 count)
+{
+	// local copy, stores to v cannot alias it so it stays in registers
+	Mat34 t = *t0;
+	s32 i;
+	for (i = 0; i < count; i++)
+		Vec3_setMat34MulVec3Inline(&v[i], &t, &v0[i]);
+}
+
+void Vec3_normalizeArray(__reg("a1") Vec3* v, __reg("a0") Vec3 const* v0, __reg("d0") s32 count)
+{
+	s32 i;
+	for (i = 0; i < count; i++)
+		Vec3_normalizeFastInline(&v[i], &v0[i]);
+}
+
 void Mat33_copy(__reg("a1") Mat33* m, __reg("a0") Mat33* m0)
 {
 	Vec3_copy(&m->Row[0], &m0->Row[0]);
@@ -180,6 +197,13 @@ void Mat34_mul(__reg("a2") Mat34* t, __reg("a0") Mat34* t0, __reg("a1") Mat34* t
 	Mat33_mul(&t->Rot, &t0->Rot, &t1->Rot);
 }
 
+void Mat34_mulArray(__reg("a2") Mat34* t, __reg("a0") Mat34 const* t0, __reg("a1") Mat34 const* t1, __reg("d0") s32 count)
+{
+	s32 i;
+	for (i = 0; i < count; i++)
+		Mat34_mulInline(&t[i], &t0[i], &t1[i]);
+}
+
 void Mat34_invertOrthogonal(__reg("a1") Mat34* t, __reg("a0") Mat34* t0)
 {
 	Mat33_invertOrthogonal(&t->Rot, &t0->Rot);
@@ -50,6 +50,10 @@ extern void Vec3_setMat34RotVec3(__reg("a2") Vec3* v, __reg("a0") Mat34* t0, __r
 extern void Vec3_setMat34MulVec3(__reg("a2") Vec3* v, __reg("a0") Mat34* t0, __reg("a1") Vec3* v0);
 extern void Vec3_setMat33CofactorRow(__reg("a2") Vec3* v, __reg("a0") Vec3* v0, __reg("a1") Vec3* v1);
 
+// batch versions, v[i] = f(v0[i]); v may alias v0
+extern void Vec3_setMat34MulVec3Array(__reg("a2") Vec3* v, __reg("a0") Mat34 const* t0, __reg("a1") Vec3 const* v0, __reg("d0") s32 count);
+extern void Vec3_normalizeArray(__reg("a1") Vec3* v, __reg("a0") Vec3 const* v0, __reg("d0") s32 count);
+
 
 extern float Mat33_determinant(__reg("a0") Mat33* m0);
 
@@ -100,6 +104,8 @@ extern float Mat34_determinant(__reg("a0") Mat34* m0);
 extern void Mat34_copy(__reg("a1") Mat34* t, __reg("a0") Mat34* t0);
 extern void Mat34_mul(__reg("a2") Mat34* t, __reg("a0") Mat34* t0, __reg("a1") Mat34* t1);
 extern void Mat34_mulMat33(__reg("a2") Mat34* t, __reg("a0") Mat34* t0, __reg("a1") Mat33* t1);
+// t[i] = t0[i] * t1[i]; t may alias t0 or t1
+extern void Mat34_mulArray(__reg("a2") Mat34* t, __reg("a0") Mat34 const* t0, __reg("a1") Mat34 const* t1, __reg("d0") s32 count);
 extern void Mat34_invert(__reg("a1") Mat34* t, __reg("a0") Mat34* t0);
 extern void Mat34_invertOrthogonal(__reg("a1") Mat34* t, __reg("a0") Mat34* t0);
 
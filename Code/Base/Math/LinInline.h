@@ -0,0 +1,58 @@
+
+#ifndef NEWAGE_BASE_MATH_LININLINE_H
+#define NEWAGE_BASE_MATH_LININLINE_H
+
+#include "Lin.h"
+#include "Sqrt.h"
+
+/*
+	Header versions of the hot Lin.c routines, for loops that would otherwise
+	make one call per vector. Results are written after all inputs are read,
+	so the destination may alias any source.
+*/
+
+static inline void Vec3_setMat34MulVec3Inline(Vec3* v, Mat34 const* t0, Vec3 const* v0)
+{
+	float x = v0->x, y = v0->y, z = v0->z;
+	v->x = t0->Rot.Row[0].x * x + t0->Rot.Row[0].y * y + t0->Rot.Row[0].z * z + t0->Move.x;
+	v->y = t0->Rot.Row[1].x * x + t0->Rot.Row[1].y * y + t0->Rot.Row[1].z * z + t0->Move.y;
+	v->z = t0->Rot.Row[2].x * x + t0->Rot.Row[2].y * y + t0->Rot.Row[2].z * z + t0->Move.z;
+}
+
+static inline void Mat34_mulInline(Mat34* t, Mat34 const* t0, Mat34 const* t1)
+{
+	// t1 and the translation are read up front, then each row of t0 is read
+	// before the same row of t is written
+	float a00 = t1->Rot.Row[0].x, a01 = t1->Rot.Row[0].y, a02 = t1->Rot.Row[0].z;
+	float a10 = t1->Rot.Row[1].x, a11 = t1->Rot.Row[1].y, a12 = t1->Rot.Row[1].z;
+	float a20 = t1->Rot.Row[2].x, a21 = t1->Rot.Row[2].y, a22 = t1->Rot.Row[2].z;
+	Vec3 move;
+	int row;
+
+	Vec3_setMat34MulVec3Inline(&move, t0, &t1->Move);
+	for (row = 0; row < 3; row++)
+	{
+		float x = t0->Rot.Row[row].x, y = t0->Rot.Row[row].y, z = t0->Rot.Row[row].z;
+		t->Rot.Row[row].x = x * a00 + y * a10 + z * a20;
+		t->Rot.Row[row].y = x * a01 + y * a11 + z * a21;
+		t->Rot.Row[row].z = x * a02 + y * a12 + z * a22;
+	}
+	t->Move = move;
+}
+
+// zero length vectors are passed through
+static inline void Vec3_normalizeFastInline(Vec3* v, Vec3 const* v0)
+{
+	float x = v0->x, y = v0->y, z = v0->z;
+	float len2 = x * x + y * y + z * z;
+	if (len2 > 0.f)
+	{
+		float scale = mathRSqrtFast(len2);
+		x *= scale; y *= scale; z *= scale;
+	}
+	v->x = x;
+	v->y = y;
+	v->z = z;
+}
+
+#endif
@@ -113,6 +113,55 @@ void QuatSLinearCombine(__reg("a5") Quat *q, __reg("a0") Quat *q0, __reg("a0") Q
 	q->w = q0->w * t0 + e.w * t1;
 }
 
+/*
+	Normalized lerp along the shorter arc, no trig per quaternion. The error
+	against slerp grows with the angle between the keys and is not visible for
+	densely sampled curves. With correction t is warped by a polynomial fitted
+	to slerp's angle(t) curve, which removes most of the remaining error.
+	q may alias q0 or q1.
+*/
+static float_t nlerpCorrection(float_t t, float_t cosom)
+{
+	float_t ka = 1.0904f + cosom * (-3.2452f + cosom * (3.55645f - cosom * 1.43519f));
+	float_t kb = 0.848013f + cosom * (-1.06021f + cosom * 0.215638f);
+	float_t k = ka * (t - 0.5f) * (t - 0.5f) + kb;
+	return t + t * (t - 0.5f) * (t - 1.0f) * k;
+}
+
+void QuatNLerpArray(__reg("a5") Quat *q, __reg("a0") Quat const *q0, __reg("a1") Quat const *q1, __reg("a2") float const *t,
+					__reg("d0") s32 count, __reg("d1") s32 corrected)
+{
+	s32 i;
+	for( i = 0; i < count; ++i )
+	{
+		float_t cosom, t0, t1, x, y, z, w, rcpLength;
+
+		cosom = q0[i].x * q1[i].x + q0[i].y * q1[i].y + q0[i].z * q1[i].z + q0[i].w * q1[i].w;
+		t1 = t[i];
+		if( corrected )
+			t1 = nlerpCorrection(t1, (cosom < (float_t)0.0)? -cosom: cosom);
+		t0 = (float_t)1.0 - t1;
+		if( cosom < (float_t)0.0 )
+			t1 = -t1;
+
+		x = q0[i].x * t0 + q1[i].x * t1;
+		y = q0[i].y * t0 + q1[i].y * t1;
+		z = q0[i].z * t0 + q1[i].z * t1;
+		w = q0[i].w * t0 + q1[i].w * t1;
+
+		rcpLength = (float_t)1.0 / mathSqrt(x * x + y * y + z * z + w * w);
+		q[i].x = x * rcpLength;
+		q[i].y = y * rcpLength;
+		q[i].z = z * rcpLength;
+		q[i].w = w * rcpLength;
+	}
+}
+
+void QuatNLerp(__reg("a5") Quat *q, __reg("a0") Quat const *q0, __reg("a1") Quat const *q1, __reg("fp0") float t)
+{
+	QuatNLerpArray(q, q0, q1, &t, 1, 0);
+}
+
 void QuatMul(__reg("a5") Quat *q, __reg("a0") Quat *q0, __reg("a1") Quat *q1)
 {
 	q->x = q0->w*q1->x + q0->x*q1->w + q0->y*q1->z - q0->z*q1->y;
@@ -33,6 +33,9 @@ extern __asm void QuatLinearCombine3(__reg("a5") Quat *q, __reg("a0") Quat *q0,
 extern __asm void QuatLinearCombine4(__reg("a5") Quat *q, __reg("a0") Quat *q0, __reg("a1") Quat *q1, __reg("a2") Quat *q2, __reg("a3") Quat *q3,
 					__reg("fp0") float s, __reg("fp1") float t, __reg("fp2") float u, __reg("fp3") float v);
 extern __asm void QuatSLinearCombine(__reg("a5") Quat *q, __reg("a0") Quat *q0, __reg("a0") Quat *q1, __reg("fp0") float t);
+extern __asm void QuatNLerp(__reg("a5") Quat *q, __reg("a0") Quat const *q0, __reg("a1") Quat const *q1, __reg("fp0") float t);
+extern __asm void QuatNLerpArray(__reg("a5") Quat *q, __reg("a0") Quat const *q0, __reg("a1") Quat const *q1, __reg("a2") float const *t,
+					__reg("d0") s32 count, __reg("d1") s32 corrected);
 extern __asm void QuatMul(__reg("a5") Quat *q, __reg("a0") Quat *q0, __reg("a1") Quat *q1);
 extern __asm void QuatDiv(__reg("a5") Quat *q, __reg("a0") Quat *q0, __reg("a1") Quat *q1);
 extern __asm void QuatInvert(__reg("a5") Quat *q, __reg("a0") Quat *q0);
@@ -7,6 +7,23 @@ extern s32 mathISqrt(__reg("d0") s32 x);
 
 extern float mathSqrt(__reg("fp0") float x);
 
+/*
+	1/sqrt(x) from the float bit pattern and two Newton steps, no divide and
+	no sqrt. Relative error below 5e-6 for normal positive x; x must be > 0.
+*/
+static inline float mathRSqrtFast(float x)
+{
+	union { float f; s32 i; } u;
+	float y;
+
+	u.f = x;
+	u.i = 0x5f375a86 - (u.i >> 1);
+	y = u.f;
+	y = y * (1.5f - 0.5f * x * y * y);
+	y = y * (1.5f - 0.5f * x * y * y);
+	return y;
+}
+
 
 #endif
 
@@ -14,5 +14,38 @@ extern float mathACos(__reg("fp0") float f);
 extern float mathATan(__reg("fp0") float f);
 extern float mathATan2(__reg("fp0") float x, __reg("fp1") float y);
 
+/*
+	Polynomial sin and cos for per vertex or per particle use, where the libm
+	call dominates. The argument is reduced by the nearest multiple n of pi to
+	[-pi/2, pi/2], where an odd degree 7 minimax polynomial is evaluated, and
+	the sign is flipped for odd n; there are no branches.
+	Absolute error below 1e-6 for |f| < 1000; the reduction loses precision
+	with growing |f|, so keep angles bounded. |f| must stay below 1e5.
+*/
+static inline float mathSinPoly(float f, s32 n)
+{
+	union { float f; s32 i; } u;
+	float x2 = f * f;
+
+	u.f = f * (0.99999661f + x2 * (-0.16664824f + x2 * (0.00830629f + x2 * -0.00018363f)));
+	u.i ^= n << 31;
+	return u.f;
+}
+
+static inline float mathSinFast(float f)
+{
+	// round to nearest through a positive bias, pi split so that n * 3.140625f is exact
+	s32 n = (s32)(f * 0.31830989f + 32768.5f) - 32768;
+	f = (f - n * 3.140625f) - n * 9.676536e-4f;
+	return mathSinPoly(f, n);
+}
+
+// cos(f) = sin(f + pi/2), shifted after the reduction so the small angle keeps its precision
+static inline float mathCosFast(float f)
+{
+	s32 n = (s32)(f * 0.31830989f + 32768.0f) - 32768;
+	f = ((f - n * 3.140625f) - n * 9.676536e-4f) - 1.5707964f;
+	return mathSinPoly(f, n + 1);
+}
 
 #endif
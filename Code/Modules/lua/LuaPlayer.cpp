@@ -7,10 +7,57 @@ extern "C" {
 }
 
 #include <string>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+#if defined(__psp__)
+	#include <pspthreadman.h>
+#endif
 
 using namespace mutalisk;
 using namespace mutalisk::lua;
 
+// ------------------------------------------------------------------
+namespace
+{
+	unsigned microseconds()
+	{
+#if defined(__psp__)
+		return sceKernelGetSystemTimeLow();
+#else
+		return static_cast<unsigned>( clock() * ( 1000000.0 / CLOCKS_PER_SEC ) );
+#endif
+	}
+
+	// FNV-1a
+	unsigned contentHash( char const* data, size_t size )
+	{
+		unsigned hash = 2166136261U;
+		for( size_t q = 0; q < size; ++q )
+			hash = ( hash ^ static_cast<unsigned char>( data[q] ) ) * 16777619U;
+		return hash;
+	}
+
+	bool readFile( std::string const& fileName, std::vector<char>& data )
+	{
+		FILE* f = fopen( fileName.c_str(), "rb" );
+		if( !f )
+			return false;
+		fseek( f, 0, SEEK_END );
+		long size = ftell( f );
+		fseek( f, 0, SEEK_SET );
+		data.resize( size );
+		bool ok = ( size > 0 && fread( &data[0], 1, size, f ) == static_cast<size_t>( size ) );
+		fclose( f );
+		return ok;
+	}
+
+	int writeChunk( lua_State* L, const void* p, size_t size, void* file )
+	{
+		return ( fwrite( p, 1, size, static_cast<FILE*>( file ) ) == size )? 0: 1;
+	}
+}
+
 // ------------------------------------------------------------------
 std::string mutalisk::lua::getError(::lua_State* L)
 {
@@ -84,7 +131,7 @@ protected:
 
 		mLuaCurrentPath += getDirPart( fname );
 
-		int status = luaL_loadfile(L, curName.c_str() );
+		int status = LuaPlayer::getInstance().loadChunk( curName );
 
 		if (status != 0)
 			lua_error(L);
@@ -114,6 +161,11 @@ static int myPanic(lua_State *L)
 }
 
 LuaPlayer::LuaPlayer()
+{
+	open();
+}
+
+void LuaPlayer::open()
 {
 	L = lua_open();
 	luaopen_base( L );
@@ -154,7 +206,7 @@ void LuaPlayer::exec( std::string const& luaNamePath )
 		int status = 0;
 		//int errFuncHandler = luaErrorHandler();
 		printf("moo\n");
-		status = luaL_loadfile( L, filePath.c_str() );
+		status = loadChunk( filePath );
 		if( status != 0 )
 		{
 			THROW_LUAERROR( status, getError( L ) + ", while parsing " + luaNamePath + " [parsing]" );
@@ -179,13 +231,12 @@ void LuaPlayer::exec( std::string const& luaNamePath )
 
 void LuaPlayer::checkFunction( std::string const& funcName )
 {
-	int status = 0;
 	lua_getglobal( L, funcName.c_str() );
 
 	int top = lua_gettop( L );
 	if( lua_isnil( L, top ) )
 	{
-		THROW_LUAERROR( status, std::string( "Function '" ) + funcName + "' not found" );
+		THROW_LUAERROR( 0, std::string( "Function '" ) + funcName + "' not found" );
 	}
 }
 
@@ -198,20 +249,89 @@ int LuaPlayer::luaErrorHandler() const
 	return lua_gettop( L );
 }
 
+int LuaPlayer::loadChunk( std::string const& filePath )
+{
+	unsigned startTime = microseconds();
+	++mStats.loads;
+
+	std::vector<char> source;
+	if( mBytecodeCacheDir.empty() || !readFile( filePath, source ) )
+	{
+		int status = luaL_loadfile( L, filePath.c_str() );
+		mStats.loadTime += microseconds() - startTime;
+		return status;
+	}
+
+	char cacheName[16];
+	sprintf( cacheName, "%08x.luac", contentHash( &source[0], source.size() ) );
+	std::string cachePath = mBytecodeCacheDir;
+	if( cachePath[ cachePath.size() - 1 ] != '/' && cachePath[ cachePath.size() - 1 ] != '\\' )
+		cachePath += '/';
+	cachePath += cacheName;
+	std::string chunkName = "@" + filePath;
+
+	// bytecode from a different Lua build fails the header check,
+	// in that case fall through and recompile
+	std::vector<char> bytecode;
+	if( readFile( cachePath, bytecode ) )
+	{
+		if( luaL_loadbuffer( L, &bytecode[0], bytecode.size(), chunkName.c_str() ) == 0 )
+		{
+			++mStats.cacheHits;
+			mStats.loadTime += microseconds() - startTime;
+			return 0;
+		}
+		lua_pop( L, 1 );	// error message
+	}
+
+	int status = luaL_loadbuffer( L, &source[0], source.size(), chunkName.c_str() );
+	if( status == 0 )
+	{
+		FILE* f = fopen( cachePath.c_str(), "wb" );
+		if( f )
+		{
+			lua_dump( L, writeChunk, f );
+			fclose( f );
+		}
+	}
+	mStats.loadTime += microseconds() - startTime;
+	return status;
+}
+
 void LuaPlayer::garbageCollect()
 {
 	lua_close( L );
-	
+	open();
+}
 
-	L = lua_open();
-	luaopen_base( L );
-	luaopen_string( L );
-	luaopen_table( L );
-	luaopen_math( L );
-//	luaopen_io( L );
-//	luaopen_debug( L );
+void LuaPlayer::gcStep( unsigned budgetMicroseconds, int stepSize )
+{
+	unsigned startTime = microseconds();
+	unsigned elapsed = 0;
+	do
+	{
+		++mStats.gcSteps;
+		if( lua_gc( L, LUA_GCSTEP, stepSize ) )
+			break;			// cycle finished
+		elapsed = microseconds() - startTime;
+	} while( elapsed < budgetMicroseconds );
+
+	// no stop-the-world collections in the middle of a frame from now on;
+	// a step re-arms the automatic collector, so stop it after every one
+	lua_gc( L, LUA_GCSTOP, 0 );
+
+	elapsed = microseconds() - startTime;
+	mStats.gcTime += elapsed;
+	if( elapsed > mStats.gcWorstPause )
+		mStats.gcWorstPause = elapsed;
+}
 
-	CLuaPathTrack::registerFunc( L );
+void LuaPlayer::printStats() const
+{
+	printf( "lua: %u loads, %u from bytecode cache, %u us loading\n",
+		mStats.loads, mStats.cacheHits, mStats.loadTime );
+	printf( "lua: %u gc steps, %u us total, %u us worst frame pause, %u KB heap\n",
+		mStats.gcSteps, mStats.gcTime, mStats.gcWorstPause, lua_gc( L, LUA_GCCOUNT, 0 ) );
 }
 
 void LuaPlayer::onError( std::string const& luaError )
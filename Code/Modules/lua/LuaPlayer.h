@@ -65,7 +65,14 @@ public:
 		mPrefix = prefix;
 	}
 
+	// precompiled chunks are stored as <dir>/<content hash>.luac, the dir
+	// must exist; empty dir disables the cache
+	void setBytecodeCache( std::string const& dir = "" ) {
+		mBytecodeCacheDir = dir;
+	}
+
 	void exec( std::string const& luaName );
+	int loadChunk( std::string const& filePath );	// luaL_loadfile through the bytecode cache
 
 	/*
 	void call( std::string const& funcName ) {
@@ -100,6 +107,24 @@ public:
 
 	void garbageCollect();
 
+	// the collector runs on its own until the first gcStep(), which switches
+	// it to manual mode: from then on call it once per frame, it advances the
+	// collection incrementally and stops when the cycle finishes or the time
+	// budget runs out; garbageCollect() returns to automatic mode
+	void gcStep( unsigned budgetMicroseconds, int stepSize = 1 );
+
+	struct Stats {
+		Stats() : loads(0), cacheHits(0), loadTime(0), gcSteps(0), gcTime(0), gcWorstPause(0) {}
+		unsigned loads;
+		unsigned cacheHits;
+		unsigned loadTime;			// microseconds
+		unsigned gcSteps;
+		unsigned gcTime;			// microseconds
+		unsigned gcWorstPause;		// microseconds
+	};
+	Stats const& stats() const { return mStats; }
+	void printStats() const;
+
 	/*
 	bool isNil( luabind::object const& luaObject ) {
 		return( luaObject.type() == LUA_TNIL );
@@ -122,6 +147,7 @@ protected:
 	~LuaPlayer();
 
 	void checkFunction( std::string const& funcName );
+	void open();
 
 private:
 //	friend CustomLifetimePolicy<LuaPlayer>;
@@ -132,6 +158,8 @@ private:
 	lua_State*	L;
 	std::string	mLastError;
 	std::string mPrefix;
+	std::string mBytecodeCacheDir;
+	Stats		mStats;
 };
 } // namespace lua
 } // namespace mutalisk
@@ -17,7 +17,7 @@
 #ifdef PSP_FINAL
 #define ASSERT(exp)	{}
 #elif defined(__psp__)
-	#define ASSERT(exp) {if (!(exp)) { printf("ASSERT : %s\n", #exp); int* p = (int*)1; int i = *p; }}
+	#define ASSERT(exp) {if (!(exp)) { printf("ASSERT : %s\n", #exp); volatile int* p = (volatile int*)1; int i = *p; (void)i; }}
 #else
 	#define ASSERT(exp) assert(exp)
 #endif
@@ -48,7 +48,7 @@ void psp_texture::patchupTextureFromMemory(MtxHeader* header)
 	clutEntries = header->clutEntries;
 
 	data = header+1;
-	clut = (void*)(header->paletteOffset + (int)data);
+	clut = static_cast<char*>(data) + header->paletteOffset;
 
 	swizzled = header->swizzle;
 //	printf(" alloc = %x\n", (unsigned int)data);
@@ -52,7 +52,7 @@ inline template <typename In> In& operator>> (In& i, psp_texture& texture)
 		texture.clutEntries = header.clutEntries;
 
 		texture.data = malloc(header.vramAllocationSize);
-		texture.clut = (void*)(header.paletteOffset + (int)texture.data);
+		texture.clut = static_cast<char*>(texture.data) + header.paletteOffset;
 		
 		texture.swizzled = header.swizzle;
 //		printf(" alloc = %x\n", (unsigned int)texture.data);
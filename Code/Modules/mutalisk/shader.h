@@ -10,7 +10,8 @@ namespace mutalisk { namespace data
 
 	struct shader_fixed
 	{
-		enum { Version = 0x0103 };
+		enum { Version = 0x0104 };
+		enum { VersionWithoutUvScale = 0x0103 };	// still read, scales stay 1
 
 		Color			ambient;
 		Color			diffuse;
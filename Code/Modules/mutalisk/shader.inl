@@ -25,21 +25,24 @@ inline template <typename In> In& operator>> (In& i, shader_fixed& data)
 {
 	try
 	{
-		unsigned versionCheck = (data.Version == i.readDword()); ASSERT(versionCheck);
+		unsigned version = i.readDword();
+		unsigned versionCheck = (version == data.Version || version == data.VersionWithoutUvScale); ASSERT(versionCheck);
 
 		i.readType(data.ambient);
 		i.readType(data.diffuse);
 		i.readType(data.specular);
 		i.readType(data.emissive);
 
-		typedef unsigned TextureIndexT;
 		i.readType(data.diffuseTexture);
 		i.readType(data.envmapTexture);
 
 		i.readType(data.uOffset);
 		i.readType(data.vOffset);
-//		i.readType(data.uScale);
-//		i.readType(data.vScale);
+		if(version != data.VersionWithoutUvScale)
+		{
+			i.readType(data.uScale);
+			i.readType(data.vScale);
+		}
 		i.readType(data.transparency);
 
 		i.readType(data.frameBufferOp);
@@ -67,14 +70,13 @@ inline template <typename Out> Out& operator<< (Out& o, shader_fixed const& data
 		o.writeType(data.specular);
 		o.writeType(data.emissive);
 
-		typedef unsigned TextureIndexT;
 		o.writeType(data.diffuseTexture);
 		o.writeType(data.envmapTexture);
 
 		o.writeType(data.uOffset);
 		o.writeType(data.vOffset);
-//		o.writeType(data.uScale);
-//		o.writeType(data.vScale);
+		o.writeType(data.uScale);
+		o.writeType(data.vScale);
 		o.writeType(data.transparency);
 
 		o.writeDword(data.frameBufferOp);
@@ -0,0 +1,535 @@
+#include "texture_codec.h"
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#	define MUTALISK_CODEC_SSE2
+#endif
+
+namespace mutalisk { namespace data
+{
+
+namespace
+{
+	// one channel of a 16 bit format, Bits wide at Shift and byte Byte of 8888;
+	// constant shifts let every format compile to its own straight code
+	template <unsigned Bits, unsigned Shift, unsigned Byte>
+	struct Channel
+	{
+		enum
+		{
+			Max = (1 << Bits) - 1,
+			Up = 8 - Bits,
+			Down = (Bits >= 4)? 2 * Bits - 8: 0
+		};
+
+		// round(v * Max / 255) without a divide
+		static unsigned reduce(unsigned pixel)
+		{
+			if(!Bits)
+				return 0;
+			unsigned x = ((pixel >> (8 * Byte)) & 0xff) * Max + 128;
+			return ((x + (x >> 8)) >> 8) << Shift;
+		}
+
+		// top bits repeated down, a missing alpha is opaque
+		static unsigned expand(unsigned pixel)
+		{
+			if(!Bits)
+				return 0xffU << (8 * Byte);
+			unsigned v = (pixel >> Shift) & Max;
+			if(Bits == 1)
+				v = v? 0xff: 0;
+			else
+				v = (v << Up) | (v >> Down);
+			return v << (8 * Byte);
+		}
+
+#if defined(MUTALISK_CODEC_SSE2)
+		static __m128i reduce(__m128i pixels)
+		{
+			if(!Bits)
+				return _mm_setzero_si128();
+			__m128i v = _mm_and_si128(_mm_srli_epi32(pixels, 8 * Byte), _mm_set1_epi32(0xff));
+			// v * Max fits the low 16 bits of each lane, the high ones stay 0
+			__m128i x = _mm_add_epi32(_mm_mullo_epi16(v, _mm_set1_epi32(Max)), _mm_set1_epi32(128));
+			return _mm_slli_epi32(_mm_srli_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 8)), 8), Shift);
+		}
+
+		static __m128i expand(__m128i pixels)
+		{
+			if(!Bits)
+				return _mm_set1_epi32(int(0xffU << (8 * Byte)));
+			__m128i v = _mm_and_si128(_mm_srli_epi32(pixels, Shift), _mm_set1_epi32(Max));
+			if(Bits == 1)
+				v = _mm_and_si128(_mm_sub_epi32(_mm_setzero_si128(), v), _mm_set1_epi32(0xff));
+			else
+				v = _mm_or_si128(_mm_slli_epi32(v, Up), _mm_srli_epi32(v, Down));
+			return _mm_slli_epi32(v, 8 * Byte);
+		}
+#endif
+	};
+
+	// channel widths in order red, green, blue, alpha from the lowest bits
+	template <unsigned R, unsigned G, unsigned B, unsigned A>
+	struct Format16
+	{
+		typedef Channel<R, 0, 0>			Red;
+		typedef Channel<G, R, 1>			Green;
+		typedef Channel<B, R + G, 2>		Blue;
+		typedef Channel<A, R + G + B, 3>	Alpha;
+
+		static unsigned to16(unsigned pixel) { return Red::reduce(pixel) | Green::reduce(pixel) | Blue::reduce(pixel) | Alpha::reduce(pixel); }
+		static unsigned to8888(unsigned pixel) { return Red::expand(pixel) | Green::expand(pixel) | Blue::expand(pixel) | Alpha::expand(pixel); }
+#if defined(MUTALISK_CODEC_SSE2)
+		static __m128i to16(__m128i pixels)
+		{
+			return _mm_or_si128(_mm_or_si128(Red::reduce(pixels), Green::reduce(pixels)), _mm_or_si128(Blue::reduce(pixels), Alpha::reduce(pixels)));
+		}
+		static __m128i to8888(__m128i pixels)
+		{
+			return _mm_or_si128(_mm_or_si128(Red::expand(pixels), Green::expand(pixels)), _mm_or_si128(Blue::expand(pixels), Alpha::expand(pixels)));
+		}
+#endif
+	};
+	typedef Format16<5, 6, 5, 0>	Format5650;
+	typedef Format16<5, 5, 5, 1>	Format5551;
+	typedef Format16<4, 4, 4, 4>	Format4444;
+
+	unsigned channel(unsigned pixel, unsigned c) { return (pixel >> (8 * c)) & 0xff; }
+
+	// median cut over distinct colors weighted by how often they occur
+	struct Color
+	{
+		unsigned	value;
+		unsigned	count;
+	};
+
+	struct ByChannel
+	{
+		explicit ByChannel(unsigned c) : c(c) {}
+		bool operator() (Color const& a, Color const& b) const
+		{
+			unsigned ca = channel(a.value, c);
+			unsigned cb = channel(b.value, c);
+			return (ca != cb)? ca < cb: a.value < b.value;
+		}
+		unsigned c;
+	};
+
+	struct Box
+	{
+		unsigned	begin;
+		unsigned	end;
+
+		// widest channel and its range
+		unsigned widest(std::vector<Color> const& colors, unsigned& range) const
+		{
+			unsigned lo[4] = { 0xff, 0xff, 0xff, 0xff };
+			unsigned hi[4] = { 0, 0, 0, 0 };
+			for(unsigned q = begin; q < end; ++q)
+				for(unsigned c = 0; c < 4; ++c)
+				{
+					lo[c] = std::min(lo[c], channel(colors[q].value, c));
+					hi[c] = std::max(hi[c], channel(colors[q].value, c));
+				}
+
+			unsigned result = 0;
+			range = 0;
+			for(unsigned c = 0; c < 4; ++c)
+				if(hi[c] - lo[c] > range)
+				{
+					range = hi[c] - lo[c];
+					result = c;
+				}
+			return result;
+		}
+
+		unsigned average(std::vector<Color> const& colors) const
+		{
+			unsigned long long sum[4] = { 0, 0, 0, 0 };
+			unsigned long long weight = 0;
+			for(unsigned q = begin; q < end; ++q)
+			{
+				for(unsigned c = 0; c < 4; ++c)
+					sum[c] += (unsigned long long)channel(colors[q].value, c) * colors[q].count;
+				weight += colors[q].count;
+			}
+
+			unsigned result = 0;
+			for(unsigned c = 0; c < 4; ++c)
+				result |= unsigned((sum[c] + weight / 2) / weight) << (8 * c);
+			return result;
+		}
+	};
+
+#if defined(MUTALISK_CODEC_SSE2)
+	// palette split into (r, g) and (b, a) pairs of 16 bit lanes, four entries
+	// per vector, so _mm_madd_epi16 sums two squared differences at once
+	void nearest(unsigned char* indices, unsigned const* src, unsigned count, unsigned const* clut, unsigned clutEntries)
+	{
+		unsigned const groups = (clutEntries + 3) / 4;
+		short rg[256 * 2] __attribute__((aligned(16)));
+		short ba[256 * 2] __attribute__((aligned(16)));
+		for(unsigned e = 0; e < groups * 4; ++e)
+		{
+			// padding repeats entry 0, ties go to the lower index anyway
+			unsigned color = clut[(e < clutEntries)? e: 0];
+			rg[e * 2 + 0] = short(channel(color, 0));
+			rg[e * 2 + 1] = short(channel(color, 1));
+			ba[e * 2 + 0] = short(channel(color, 2));
+			ba[e * 2 + 1] = short(channel(color, 3));
+		}
+
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const four = _mm_set1_epi32(4);
+		unsigned last = 0;
+		unsigned lastIndex = ~0U;
+		for(unsigned q = 0; q < count; ++q)
+		{
+			if(src[q] != last || lastIndex == ~0U)
+			{
+				last = src[q];
+				__m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(last)), zero);
+				__m128i pixelRG = _mm_shuffle_epi32(pixel, _MM_SHUFFLE(0, 0, 0, 0));
+				__m128i pixelBA = _mm_shuffle_epi32(pixel, _MM_SHUFFLE(1, 1, 1, 1));
+
+				__m128i best = _mm_set1_epi32(0x7fffffff);
+				__m128i bestIndex = zero;
+				__m128i index = _mm_set_epi32(3, 2, 1, 0);
+				for(unsigned g = 0; g < groups; ++g)
+				{
+					__m128i dRG = _mm_sub_epi16(_mm_load_si128((__m128i const*)(rg + g * 8)), pixelRG);
+					__m128i dBA = _mm_sub_epi16(_mm_load_si128((__m128i const*)(ba + g * 8)), pixelBA);
+					__m128i d = _mm_add_epi32(_mm_madd_epi16(dRG, dRG), _mm_madd_epi16(dBA, dBA));
+					__m128i closer = _mm_cmplt_epi32(d, best);
+					best = _mm_or_si128(_mm_and_si128(closer, d), _mm_andnot_si128(closer, best));
+					bestIndex = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex));
+					index = _mm_add_epi32(index, four);
+				}
+
+				int lanes[4] __attribute__((aligned(16)));
+				int laneIndices[4] __attribute__((aligned(16)));
+				_mm_store_si128((__m128i*)lanes, best);
+				_mm_store_si128((__m128i*)laneIndices, bestIndex);
+				unsigned lane = 0;
+				for(unsigned l = 1; l < 4; ++l)
+					if(lanes[l] < lanes[lane] || (lanes[l] == lanes[lane] && laneIndices[l] < laneIndices[lane]))
+						lane = l;
+				lastIndex = unsigned(laneIndices[lane]);
+			}
+			indices[q] = static_cast<unsigned char>(lastIndex);
+		}
+	}
+
+	// four 32 bit lanes of at most 0xffff to 16 bit lanes, packs saturate signed
+	__m128i pack32To16(__m128i lo, __m128i hi)
+	{
+		__m128i const bias32 = _mm_set1_epi32(0x8000);
+		__m128i const bias16 = _mm_set1_epi16(short(0x8000));
+		return _mm_add_epi16(_mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32)), bias16);
+	}
+#else
+	unsigned distance(unsigned a, unsigned b)
+	{
+		unsigned result = 0;
+		for(unsigned c = 0; c < 4; ++c)
+		{
+			int d = int(channel(a, c)) - int(channel(b, c));
+			result += unsigned(d * d);
+		}
+		return result;
+	}
+
+	void nearest(unsigned char* indices, unsigned const* src, unsigned count, unsigned const* clut, unsigned clutEntries)
+	{
+		unsigned last = 0;
+		unsigned lastIndex = ~0U;
+		for(unsigned q = 0; q < count; ++q)
+		{
+			// flat areas repeat the same color
+			if(src[q] != last || lastIndex == ~0U)
+			{
+				last = src[q];
+				lastIndex = 0;
+				unsigned best = distance(last, clut[0]);
+				for(unsigned e = 1; e < clutEntries && best; ++e)
+				{
+					unsigned d = distance(last, clut[e]);
+					if(d < best)
+					{
+						best = d;
+						lastIndex = e;
+					}
+				}
+			}
+			indices[q] = static_cast<unsigned char>(lastIndex);
+		}
+	}
+#endif
+
+	template <typename Format>
+	void to16(unsigned short* dest, unsigned const* src, unsigned count)
+	{
+		unsigned q = 0;
+#if defined(MUTALISK_CODEC_SSE2)
+		for(; q + 8 <= count; q += 8)
+		{
+			__m128i lo = Format::to16(_mm_loadu_si128((__m128i const*)(src + q)));
+			__m128i hi = Format::to16(_mm_loadu_si128((__m128i const*)(src + q + 4)));
+			_mm_storeu_si128((__m128i*)(dest + q), pack32To16(lo, hi));
+		}
+#endif
+		for(; q < count; ++q)
+			dest[q] = static_cast<unsigned short>(Format::to16(src[q]));
+	}
+
+	template <typename Format>
+	void to8888(unsigned* dest, unsigned short const* src, unsigned count)
+	{
+		unsigned q = 0;
+#if defined(MUTALISK_CODEC_SSE2)
+		__m128i const zero = _mm_setzero_si128();
+		for(; q + 8 <= count; q += 8)
+		{
+			__m128i pixels = _mm_loadu_si128((__m128i const*)(src + q));
+			_mm_storeu_si128((__m128i*)(dest + q), Format::to8888(_mm_unpacklo_epi16(pixels, zero)));
+			_mm_storeu_si128((__m128i*)(dest + q + 4), Format::to8888(_mm_unpackhi_epi16(pixels, zero)));
+		}
+#endif
+		for(; q < count; ++q)
+			dest[q] = Format::to8888(src[q]);
+	}
+
+	// one 16 byte row of a block
+	void copy16(unsigned char* dest, unsigned char const* src)
+	{
+#if defined(MUTALISK_CODEC_SSE2)
+		_mm_storeu_si128((__m128i*)dest, _mm_loadu_si128((__m128i const*)src));
+#else
+		memcpy(dest, src, 16);
+#endif
+	}
+}
+
+unsigned textureBitsPerPixel(int format)
+{
+	switch(format)
+	{
+	case TextureFormat_5650:
+	case TextureFormat_5551:
+	case TextureFormat_4444:
+		return 16;
+	case TextureFormat_8888:
+		return 32;
+	case TextureFormat_T4:
+		return 4;
+	case TextureFormat_T8:
+		return 8;
+	}
+	ASSERT(!"unknown texture format");
+	return 0;
+}
+
+// swizzle
+//
+bool canSwizzle(unsigned widthBytes, unsigned height)
+{
+	return widthBytes && height && !(widthBytes % 16) && !(height % 8);
+}
+
+void swizzleTexture(void* dest, void const* src, unsigned widthBytes, unsigned height)
+{
+	ASSERT(canSwizzle(widthBytes, height));
+	ASSERT(dest != src);
+
+	unsigned char* out = static_cast<unsigned char*>(dest);
+	unsigned char const* in = static_cast<unsigned char const*>(src);
+	unsigned const blocks = widthBytes / 16;
+	// source rows read in order, each row scatters over a row of blocks
+	for(unsigned y = 0; y < height; ++y)
+	{
+		unsigned char* block = out + (y / 8) * blocks * 128 + (y % 8) * 16;
+		unsigned char const* row = in + y * widthBytes;
+		for(unsigned b = 0; b < blocks; ++b, block += 128, row += 16)
+			copy16(block, row);
+	}
+}
+
+void unswizzleTexture(void* dest, void const* src, unsigned widthBytes, unsigned height)
+{
+	ASSERT(canSwizzle(widthBytes, height));
+	ASSERT(dest != src);
+
+	unsigned char* out = static_cast<unsigned char*>(dest);
+	unsigned char const* in = static_cast<unsigned char const*>(src);
+	unsigned const blocks = widthBytes / 16;
+	for(unsigned y = 0; y < height; ++y)
+	{
+		unsigned char const* block = in + (y / 8) * blocks * 128 + (y % 8) * 16;
+		unsigned char* row = out + y * widthBytes;
+		for(unsigned b = 0; b < blocks; ++b, block += 128, row += 16)
+			copy16(row, block);
+	}
+}
+
+// palettes
+//
+void expandClut4(unsigned* dest, void const* src, unsigned count, unsigned const* clut)
+{
+	unsigned char const* in = static_cast<unsigned char const*>(src);
+	unsigned q = 0;
+	if(count >= 1024)
+	{
+		// every byte value to its pair of pixels, one lookup per two pixels
+		unsigned pairs[256][2];
+		for(unsigned b = 0; b < 256; ++b)
+		{
+			pairs[b][0] = clut[b & 0xf];
+			pairs[b][1] = clut[b >> 4];
+		}
+		for(; q + 2 <= count; q += 2)
+		{
+			unsigned const* pair = pairs[in[q / 2]];
+			dest[q + 0] = pair[0];
+			dest[q + 1] = pair[1];
+		}
+	}
+	for(; q < count; ++q)
+		dest[q] = clut[(in[q / 2] >> ((q & 1) * 4)) & 0xf];
+}
+
+void expandClut8(unsigned* dest, void const* src, unsigned count, unsigned const* clut)
+{
+	unsigned char const* in = static_cast<unsigned char const*>(src);
+	unsigned q = 0;
+	for(; q + 4 <= count; q += 4)
+	{
+		unsigned a = clut[in[q + 0]];
+		unsigned b = clut[in[q + 1]];
+		unsigned c = clut[in[q + 2]];
+		unsigned d = clut[in[q + 3]];
+		dest[q + 0] = a;
+		dest[q + 1] = b;
+		dest[q + 2] = c;
+		dest[q + 3] = d;
+	}
+	for(; q < count; ++q)
+		dest[q] = clut[in[q]];
+}
+
+unsigned buildClut(unsigned* clut, unsigned maxColors, unsigned const* src, unsigned count)
+{
+	ASSERT(maxColors > 0 && maxColors <= 256);
+	if(!count)
+		return 0;
+
+	std::vector<unsigned> sorted(src, src + count);
+	std::sort(sorted.begin(), sorted.end());
+	std::vector<Color> colors;
+	for(unsigned q = 0; q < count; ++q)
+	{
+		if(colors.empty() || colors.back().value != sorted[q])
+		{
+			Color color = { sorted[q], 0 };
+			colors.push_back(color);
+		}
+		++colors.back().count;
+	}
+
+	if(colors.size() <= maxColors)
+	{
+		for(unsigned q = 0; q < colors.size(); ++q)
+			clut[q] = colors[q].value;
+		return unsigned(colors.size());
+	}
+
+	std::vector<Box> boxes;
+	Box all = { 0, unsigned(colors.size()) };
+	boxes.push_back(all);
+	while(boxes.size() < maxColors)
+	{
+		// split the box with the widest channel at its weighted median
+		unsigned split = ~0U;
+		unsigned splitChannel = 0;
+		unsigned widestRange = 0;
+		for(unsigned q = 0; q < boxes.size(); ++q)
+		{
+			unsigned range = 0;
+			unsigned c = boxes[q].widest(colors, range);
+			if(range > widestRange)
+			{
+				widestRange = range;
+				splitChannel = c;
+				split = q;
+			}
+		}
+		if(split == ~0U)
+			break;
+
+		Box& box = boxes[split];
+		std::sort(colors.begin() + box.begin, colors.begin() + box.end, ByChannel(splitChannel));
+		unsigned long long weight = 0;
+		for(unsigned q = box.begin; q < box.end; ++q)
+			weight += colors[q].count;
+
+		unsigned middle = box.begin;
+		for(unsigned long long below = 0; middle < box.end - 1 && below + colors[middle].count <= weight / 2; ++middle)
+			below += colors[middle].count;
+		if(middle == box.begin)
+			++middle;
+
+		Box upper = { middle, box.end };
+		box.end = middle;
+		boxes.push_back(upper);
+	}
+
+	for(unsigned q = 0; q < boxes.size(); ++q)
+		clut[q] = boxes[q].average(colors);
+	return unsigned(boxes.size());
+}
+
+void quantizeToClut(unsigned char* indices, unsigned const* src, unsigned count, unsigned const* clut, unsigned clutEntries)
+{
+	ASSERT(clutEntries > 0 && clutEntries <= 256);
+	nearest(indices, src, count, clut, clutEntries);
+}
+
+void packClut4(void* dest, unsigned char const* indices, unsigned count)
+{
+	unsigned char* out = static_cast<unsigned char*>(dest);
+	for(unsigned q = 0; q + 1 < count; q += 2)
+		out[q / 2] = static_cast<unsigned char>((indices[q] & 0xf) | (indices[q + 1] << 4));
+	if(count & 1)
+		out[count / 2] = static_cast<unsigned char>(indices[count - 1] & 0xf);
+}
+
+// 16 bit formats
+//
+void convert8888To16(unsigned short* dest, unsigned const* src, unsigned count, int format)
+{
+	switch(format)
+	{
+	case TextureFormat_5650: to16<Format5650>(dest, src, count); break;
+	case TextureFormat_5551: to16<Format5551>(dest, src, count); break;
+	case TextureFormat_4444: to16<Format4444>(dest, src, count); break;
+	default: ASSERT(!"not a 16 bit format");
+	}
+}
+
+void convert16To8888(unsigned* dest, unsigned short const* src, unsigned count, int format)
+{
+	switch(format)
+	{
+	case TextureFormat_5650: to8888<Format5650>(dest, src, count); break;
+	case TextureFormat_5551: to8888<Format5551>(dest, src, count); break;
+	case TextureFormat_4444: to8888<Format4444>(dest, src, count); break;
+	default: ASSERT(!"not a 16 bit format");
+	}
+}
+
+} // namespace data
+} // namespace mutalisk
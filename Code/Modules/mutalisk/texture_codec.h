@@ -0,0 +1,57 @@
+#ifndef MUTALISK_DATA_TEXTURE_CODEC_H_
+#define MUTALISK_DATA_TEXTURE_CODEC_H_
+
+#include "cfg.h"
+
+// Conversions between the texture layouts the GE reads and linear 8888
+// images, for the players and the offline tools alike:
+//	- swizzle: rows cut into blocks of 16 bytes by 8 lines, blocks stored one
+//	  after another left to right, top to bottom; any pixel format
+//	- CLUT4/CLUT8: expansion through a palette and quantization to one
+//	- the 16 bit formats 5650, 5551 and 4444 to and from 8888
+// Pixels are little endian as the GE reads them, red in the lowest bits.
+// Hosts with SSE2 take vector paths that give the same results as the
+// scalar ones, which the PSP runs.
+namespace mutalisk { namespace data
+{
+	// pixel formats, the values of GU_PSM_*
+	enum TextureFormat
+	{
+		TextureFormat_5650 = 0,
+		TextureFormat_5551 = 1,
+		TextureFormat_4444 = 2,
+		TextureFormat_8888 = 3,
+		TextureFormat_T4 = 4,
+		TextureFormat_T8 = 5
+	};
+	unsigned textureBitsPerPixel(int format);
+
+	// swizzled textures need rows of a multiple of 16 bytes and a multiple of
+	// 8 rows; dest and src must not overlap
+	bool canSwizzle(unsigned widthBytes, unsigned height);
+	void swizzleTexture(void* dest, void const* src, unsigned widthBytes, unsigned height);
+	void unswizzleTexture(void* dest, void const* src, unsigned widthBytes, unsigned height);
+
+	// palette indices to 8888; T4 holds two pixels per byte, the first one in
+	// the low nibble
+	void expandClut4(unsigned* dest, void const* src, unsigned count, unsigned const* clut);
+	void expandClut8(unsigned* dest, void const* src, unsigned count, unsigned const* clut);
+
+	// median cut palette of at most maxColors entries, exact when src has no
+	// more distinct colors; returns the number of entries
+	unsigned buildClut(unsigned* clut, unsigned maxColors, unsigned const* src, unsigned count);
+	// nearest palette entry of each pixel in RGBA space, an index per byte
+	void quantizeToClut(unsigned char* indices, unsigned const* src, unsigned count, unsigned const* clut, unsigned clutEntries);
+	// an index per byte to T4, count rounded up to whole bytes
+	void packClut4(void* dest, unsigned char const* indices, unsigned count);
+
+	// 8888 to and from a 16 bit format; reduced channels are rounded to
+	// nearest, expanded ones repeat their top bits, so 16 -> 8888 -> 16 is
+	// exact
+	void convert8888To16(unsigned short* dest, unsigned const* src, unsigned count, int format);
+	void convert16To8888(unsigned* dest, unsigned short const* src, unsigned count, int format);
+
+} // namespace data
+} // namespace mutalisk
+
+#endif // MUTALISK_DATA_TEXTURE_CODEC_H_
@@ -0,0 +1,35 @@
+#ifndef MUTANT_BINARY_MEMORY_INPUT_H_
+#define MUTANT_BINARY_MEMORY_INPUT_H_
+
+#include "cfg.h"
+
+#include <string.h>
+#include "binary_io.h"
+
+namespace mutant
+{
+	// reads from a block of memory, e.g. a whole file read ahead; the block is
+	// owned by the caller and must outlive the input
+	class memory_input : public binary_input
+	{
+	public:
+		memory_input( void const* data, int size )
+		:	mData( static_cast<unsigned char const*>(data) ), mSize( size ), mPos( 0 ) {
+		}
+
+		virtual void read( void* dest, int n, int* wasRead ) {
+			int bytesRead = ( n < mSize - mPos )? n: mSize - mPos;
+			memcpy( dest, mData + mPos, bytesRead );
+			mPos += bytesRead;
+			if( wasRead )
+				*wasRead = bytesRead;
+		}
+
+	private:
+		unsigned char const*	mData;
+		int						mSize;
+		int						mPos;
+	};
+}
+
+#endif // MUTANT_BINARY_MEMORY_INPUT_H_
@@ -1,6 +1,11 @@
 #ifndef MUTANT_HIERARCHY_H_
 #define MUTANT_HIERARCHY_H_
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace mutant
 {
 	//
@@ -45,9 +50,12 @@ namespace mutant
 		typedef NodeT node_t;
 		typedef std::vector<node_t> nodes_t;
 
+		hierarchy() : mIndexStale( true ) {}
+
 		size_t size() const { return mNodes.size(); }
 
 		void push_back( node_t const& node ) {
+			mIndexStale = true;
 			mNodes.push_back( node );
 		}
 
@@ -63,6 +71,7 @@ namespace mutant
 		{
 			assert( nodeId >= 0 && nodeId < (int)mNodes.size() );
 			assert( rp == child_discard );
+			mIndexStale = true;
 
 			int cnt = countChildren( nodeId ) + 1;
 			mNodes.erase( mNodes.begin() + nodeId, mNodes.begin() + nodeId + cnt );
@@ -92,16 +101,19 @@ namespace mutant
 			return cnt;
 		}
 
-		node_t& root() { return mNodes[0]; }
+		// non-const access may rename nodes, the name index is rebuilt on the
+		// next lookup
+		node_t& root() { mIndexStale = true; return mNodes[0]; }
 		node_t const& root() const { return mNodes[0]; }
 
-		node_t& operator[]( int n ) { return mNodes[ n ]; }
+		node_t& operator[]( int n ) { mIndexStale = true; return mNodes[ n ]; }
 		node_t const& operator[]( int n ) const { return mNodes[ n ]; }
 		node_t& operator[]( std::string const& str ) {
 			int in = index_by_name( str );
 			if( in == node_t::nparent )
 				mutant_throw( std::string("Node `") + str + "' does not exist" );
 
+			mIndexStale = true;
 			return mNodes[ in ];
 		}
 		node_t const& operator[]( std::string const& str ) const {
@@ -112,7 +124,7 @@ namespace mutant
 			return mNodes[ in ];
 		}
 
-		nodes_t& nodes() { return mNodes; }
+		nodes_t& nodes() { mIndexStale = true; return mNodes; }
 		nodes_t const& nodes() const { return mNodes; }
 
 		std::string const& name() const { return mName; }
@@ -120,14 +132,29 @@ namespace mutant
 
 		typedef mutant::iterator<nodes_t> node_it_t;
 		typedef mutant::const_iterator<nodes_t> node_cit_t;
-		node_it_t iterate() { return node_it_t( mNodes.begin(), mNodes.end() ); }
+		node_it_t iterate() { mIndexStale = true; return node_it_t( mNodes.begin(), mNodes.end() ); }
 		node_cit_t iterate() const { return node_cit_t( mNodes.begin(), mNodes.end() ); }
 
+		// FNV-1a, names are compared only when their hashes match
+		static unsigned name_hash( std::string const& name ) {
+			unsigned hash = 2166136261U;
+			for( std::string::const_iterator it = name.begin(); it != name.end(); ++it )
+				hash = ( hash ^ (unsigned char)*it ) * 16777619U;
+			return hash;
+		}
+
+		// first node with the name, nparent if there is none
 		int index_by_name( std::string const& node_name ) const {
-			for( unsigned i = 0; i < (unsigned)size(); ++i )
+			if( mIndexStale )
+				build_index();
+
+			unsigned hash = name_hash( node_name );
+			typename name_index_t::const_iterator it =
+				std::lower_bound( mIndex.begin(), mIndex.end(), std::make_pair( hash, 0 ) );
+			for( ; it != mIndex.end() && it->first == hash; ++it )
 			{
-				if( mNodes[ i ].name == node_name )
-					return i;
+				if( mNodes[ it->second ].name == node_name )
+					return it->second;
 			}
 
 			return node_t::nparent;
@@ -190,8 +217,21 @@ namespace mutant
 		}
 		
 	private:
-		std::string	mName;
-		nodes_t		mNodes;
+		// (name hash, node index) sorted, equal hashes by increasing index
+		typedef std::vector<std::pair<unsigned,int> > name_index_t;
+
+		void build_index() const {
+			mIndex.resize( mNodes.size() );
+			for( unsigned i = 0; i < (unsigned)mNodes.size(); ++i )
+				mIndex[ i ] = std::make_pair( name_hash( mNodes[ i ].name ), (int)i );
+			std::sort( mIndex.begin(), mIndex.end() );
+			mIndexStale = false;
+		}
+
+		std::string				mName;
+		nodes_t					mNodes;
+		mutable name_index_t	mIndex;
+		mutable bool			mIndexStale;
 	};
 
 	//
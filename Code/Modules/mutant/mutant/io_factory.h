@@ -8,6 +8,7 @@
 #include "binary_compressed_output.h"
 #include "binary_output.h"
 #include "binary_io_platform.h"
+#include "binary_memory_input.h"
 #include "data.h"
 #include "errors.h"
 
@@ -80,8 +81,20 @@ namespace mutant
 
 			try
 			{
-				ret_ptr in( new file_input(name) );
+				return createInput( ret_ptr( new file_input(name) ), name );
+			} catch( EIoError& /*e*/ ) {
+				THROW_MutantError( std::string("Error while reading file. ") + e.what() );
+			}
+			return ret_ptr(NULL);
+		}
 
+		// same for an input opened elsewhere, e.g. a file read to memory; name
+		// is used for errors only
+		static std::auto_ptr<binary_input> createInput( std::auto_ptr<binary_input> in, std::string const& name ) {
+			typedef std::auto_ptr<binary_input> ret_ptr;
+
+			try
+			{
 				unsigned int magic = 0;
 				in->read( &magic, sizeof(magic), 0 );
 
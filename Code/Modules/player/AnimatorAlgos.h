@@ -57,6 +57,23 @@ struct CAnimatorAlgos
 		return unsigned(outIt - outRootIt);
 	}
 
+	// same as transformHierarchy above, but only for nodes listed in [nodeIt, nodeItEnd)
+	// nodes must be listed parents first, matrices of all other nodes have to be up to date
+	template<typename OutputIteratorT, typename RandomAccessItT, typename NodeIteratorT>
+	static void transformHierarchyNodes( OutputIteratorT outRootIt, RandomAccessItT rootToTransformIt, mutant::anim_hierarchy const& hier, NodeIteratorT nodeIt, NodeIteratorT nodeItEnd )
+	{
+		for( ; nodeIt != nodeItEnd; ++nodeIt )
+		{
+			int node = *nodeIt;
+			int parent = hier[ node ].parent;
+
+			if( parent != mutant::anim_node::nparent )
+				*( outRootIt + node ) = *( outRootIt + parent ) * *( rootToTransformIt + node );
+			else
+				*( outRootIt + node ) = *( rootToTransformIt + node );
+		}
+	}
+
 	// multiplies every transform in [rootBeginIt...rootEndIt) by rootTransform
 	template<typename OutputIteratorT, typename InputIteratorT>
 	static void transformFlattened(
@@ -15,6 +15,7 @@ CTransformAnimator::CTransformAnimator()
 ,	mDataType( dGUESS )
 ,	mInterpolateMethod( iLINEAR )
 ,	mTimeType( tLOOP )
+,	mConstant( true )
 #if SEPARATE_SPEED
 ,	mSpeed( 1.0f )
 #endif
@@ -26,6 +27,7 @@ CTransformAnimator::CTransformAnimator( eTimeType timeType, eDataType dataType,
 ,	mDataType( dataType )
 ,	mInterpolateMethod( interpolateMethod )
 ,	mTimeType( timeType )
+,	mConstant( true )
 #if SEPARATE_SPEED
 ,	mSpeed( 1.0f )
 #endif
@@ -37,6 +39,7 @@ CTransformAnimator::CTransformAnimator( mutant::anim_bundle const& bundle, eTime
 ,	mDataType( dataType )
 ,	mInterpolateMethod( interpolateMethod )
 ,	mTimeType( timeType )
+,	mConstant( true )
 #if SEPARATE_SPEED
 ,	mSpeed( 1.0f )
 #endif
@@ -65,6 +68,7 @@ CTransformAnimator& CTransformAnimator::operator= ( CTransformAnimator const& rh
 	mDataType = rhs.mDataType;
 	mInterpolateMethod = rhs.mInterpolateMethod;
 	mTimeType = rhs.mTimeType;
+	mConstant = rhs.mConstant;
 #if SEPARATE_SPEED
 	mSpeed = rhs.mSpeed;
 #endif
@@ -74,6 +78,43 @@ CTransformAnimator& CTransformAnimator::operator= ( CTransformAnimator const& rh
 }
 
 
+template<class QuatEvaluatorT>
+void CTransformAnimator::createLinearInterpolator()
+{
+	typedef CTransform::t_vector t_vec;
+	typedef CTransform::t_quaternion t_quat;
+
+	typedef knot_data<float,float> t_float_knots;
+	typedef compose_access_policy<t_vec,3> t_access_vector;
+	typedef comp_3to1<CTransform,t_vec,t_quat,t_vec> t_comp_vqv_to_transform;
+
+	typedef linear_evaluator<t_vec,t_access_vector> t_vec_eval;
+	typedef composite_evaluator<CTransform,t_comp_vqv_to_transform,t_vec_eval, QuatEvaluatorT, t_vec_eval> t_compose_evaluator;
+
+	ASSERT( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ).componentSize() == 10 );
+
+	t_compose_evaluator eval( t_comp_vqv_to_transform(), t_vec_eval(), 0, QuatEvaluatorT(), 3, t_vec_eval(), 7 );
+
+	switch( mTimeType )
+	{
+	default:
+	case tLOOP:
+		{
+			typedef interpolator1<t_float_knots, t_compose_evaluator, time_algo_cycle> t_interpolator;
+			t_interpolator ipol( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ), eval );
+			mAnimatorImpl.reset( new InterpolatorEmbed<t_interpolator>( ipol ) );
+			break;
+		}
+	case tCONSTANT:
+		{
+			typedef interpolator1<t_float_knots, t_compose_evaluator, time_algo_constant> t_interpolator;
+			t_interpolator ipol( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ), eval );
+			mAnimatorImpl.reset( new InterpolatorEmbed<t_interpolator>( ipol ) );
+			break;
+		}
+	}
+}
+
 void CTransformAnimator::createInterpolator()
 {
 	typedef CTransform::t_vector t_vec;
@@ -90,6 +131,7 @@ void CTransformAnimator::createInterpolator()
 	typedef comp_quaternion_from_euler<t_quat,float,float,float> t_comp_3_floats_to_quaternion;
 	typedef comp_3to1<CTransform,t_vec,t_quat,t_vec> t_comp_vec_quat_vec_to_transform;
 
+	mConstant = true;
 	if( !mBundle )
 		return;
 
@@ -97,35 +139,17 @@ void CTransformAnimator::createInterpolator()
 	{
 	default:
 	case iLINEAR:
+	case iNLERP:
+	case iNLERP_CORRECTED:
 		{
 			if( mDataType == dPOS_ROT_SCL )
 			{
-				typedef linear_evaluator<t_vec,t_access_vector> t_vec_eval;
-				typedef linear_quaternion_evaluator<t_quat,t_access_quaternion> t_quat_eval;
-				typedef composite_evaluator<CTransform,t_comp_vqv_to_transform,t_vec_eval, t_quat_eval, t_vec_eval> t_compose_evaluator;
-
-				ASSERT( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ).componentSize() == 10 );
-
-				t_compose_evaluator eval( t_comp_vqv_to_transform(), t_vec_eval(), 0, t_quat_eval(), 3, t_vec_eval(), 7 );
-
-				switch( mTimeType )
-				{
-				default:
-				case tLOOP:
-					{
-						typedef interpolator1<t_float_knots, t_compose_evaluator, time_algo_cycle> t_interpolator;
-						t_interpolator ipol( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ), eval );
-						mAnimatorImpl.reset( new InterpolatorEmbed<t_interpolator>( ipol ) );
-						break;
-					}
-				case tCONSTANT:
-					{
-						typedef interpolator1<t_float_knots, t_compose_evaluator, time_algo_constant> t_interpolator;
-						t_interpolator ipol( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ), eval );
-						mAnimatorImpl.reset( new InterpolatorEmbed<t_interpolator>( ipol ) );
-						break;
-					}
-				}
+				if( mInterpolateMethod == iNLERP )
+					createLinearInterpolator< nlerp_quaternion_evaluator<t_quat,t_access_quaternion,false> >();
+				else if( mInterpolateMethod == iNLERP_CORRECTED )
+					createLinearInterpolator< nlerp_quaternion_evaluator<t_quat,t_access_quaternion,true> >();
+				else
+					createLinearInterpolator< linear_quaternion_evaluator<t_quat,t_access_quaternion> >();
 			}
 
 			// it's hermite actually
@@ -299,38 +323,98 @@ void CTransformAnimator::createInterpolator()
 		}
 
 	}
+
+	mConstant = !mAnimatorImpl.get() || hasConstantCurves();
 }
 
-CTransformAnimator::eDataType CTransformAnimator::guessDataType()
+namespace {
+	// hermite curves store value, in-tangent x/y and out-tangent x/y per key;
+	// equal values with flat tangents give the same value between any keys
+	bool isConstantCurve( knot_data<float,float> const& curve, bool hermite )
+	{
+		size_t const keys = curve.size();
+		size_t const componentSize = curve.componentSize();
+		if( keys < 2 )
+			return true;
+		if( curve.values().size() < keys * componentSize )
+			return false;
+
+		float const* first = curve.component( 0 );
+		for( unsigned k = 0; k < keys; ++k )
+		{
+			float const* v = curve.component( k );
+			for( unsigned c = 0; c < componentSize; ++c )
+			{
+				if( hermite && ( c == 1 || c == 3 ) )
+					continue;
+				float expected = ( hermite && ( c == 2 || c == 4 ) )? 0.0f: first[ c ];
+				if( v[ c ] != expected )
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool CTransformAnimator::hasConstantCurves() const
 {
-	if( mBundle )
+	ASSERT( mBundle );
+
+	switch( mDataType )
 	{
-		if( mBundle->has_ff( sTypeNames::VEC_QUAT_VEC ) )
-			return dPOS_ROT_SCL;
-		else if( mBundle->has_ff( sTypeNames::VEC_QUAT ) )
-			return dPOS_ROT;
-		else if(
-				mBundle->size_ff() >= 9 &&
-				mBundle->has_ff( sTypeNames::TRANSLATE_X ) &&
-				mBundle->has_ff( sTypeNames::TRANSLATE_Y ) &&
-				mBundle->has_ff( sTypeNames::TRANSLATE_Z ) &&
-				mBundle->has_ff( sTypeNames::ROTATE_X ) &&
-				mBundle->has_ff( sTypeNames::ROTATE_Y ) &&
-				mBundle->has_ff( sTypeNames::ROTATE_Z ) &&
-				mBundle->has_ff( sTypeNames::SCALE_X ) &&
-				mBundle->has_ff( sTypeNames::SCALE_Y ) &&
-				mBundle->has_ff( sTypeNames::SCALE_Z ) )
-			return dPOS_ROT_SCL_SEP;
-		else if(
-				mBundle->size_ff() >= 6 &&
-				mBundle->has_ff( sTypeNames::TRANSLATE_X ) &&
-				mBundle->has_ff( sTypeNames::TRANSLATE_Y ) &&
-				mBundle->has_ff( sTypeNames::TRANSLATE_Z ) &&
-				mBundle->has_ff( sTypeNames::ROTATE_X ) &&
-				mBundle->has_ff( sTypeNames::ROTATE_Y ) &&
-				mBundle->has_ff( sTypeNames::ROTATE_Z ) )
-			return dPOS_ROT_SEP;
+	case dPOS_ROT_SCL:
+		return isConstantCurve( mBundle->floatFloat( sTypeNames::VEC_QUAT_VEC ), false );
+	case dPOS_ROT_SCL_SEP:
+		if( !isConstantCurve( mBundle->floatFloat( sTypeNames::SCALE_X ), true ) ||
+			!isConstantCurve( mBundle->floatFloat( sTypeNames::SCALE_Y ), true ) ||
+			!isConstantCurve( mBundle->floatFloat( sTypeNames::SCALE_Z ), true ) )
+			return false;
+		// fall through
+	case dPOS_ROT_SEP:
+		return
+			isConstantCurve( mBundle->floatFloat( sTypeNames::TRANSLATE_X ), true ) &&
+			isConstantCurve( mBundle->floatFloat( sTypeNames::TRANSLATE_Y ), true ) &&
+			isConstantCurve( mBundle->floatFloat( sTypeNames::TRANSLATE_Z ), true ) &&
+			isConstantCurve( mBundle->floatFloat( sTypeNames::ROTATE_X ), true ) &&
+			isConstantCurve( mBundle->floatFloat( sTypeNames::ROTATE_Y ), true ) &&
+			isConstantCurve( mBundle->floatFloat( sTypeNames::ROTATE_Z ), true );
+	default:
+		return false;
 	}
+}
+
+CTransformAnimator::eDataType CTransformAnimator::guessDataType()
+{
+	return mBundle ? guessDataType( *mBundle ) : dGUESS;
+}
+
+CTransformAnimator::eDataType CTransformAnimator::guessDataType( mutant::anim_bundle const& bundle )
+{
+	if( bundle.has_ff( sTypeNames::VEC_QUAT_VEC ) )
+		return dPOS_ROT_SCL;
+	else if( bundle.has_ff( sTypeNames::VEC_QUAT ) )
+		return dPOS_ROT;
+	else if(
+			bundle.size_ff() >= 9 &&
+			bundle.has_ff( sTypeNames::TRANSLATE_X ) &&
+			bundle.has_ff( sTypeNames::TRANSLATE_Y ) &&
+			bundle.has_ff( sTypeNames::TRANSLATE_Z ) &&
+			bundle.has_ff( sTypeNames::ROTATE_X ) &&
+			bundle.has_ff( sTypeNames::ROTATE_Y ) &&
+			bundle.has_ff( sTypeNames::ROTATE_Z ) &&
+			bundle.has_ff( sTypeNames::SCALE_X ) &&
+			bundle.has_ff( sTypeNames::SCALE_Y ) &&
+			bundle.has_ff( sTypeNames::SCALE_Z ) )
+		return dPOS_ROT_SCL_SEP;
+	else if(
+			bundle.size_ff() >= 6 &&
+			bundle.has_ff( sTypeNames::TRANSLATE_X ) &&
+			bundle.has_ff( sTypeNames::TRANSLATE_Y ) &&
+			bundle.has_ff( sTypeNames::TRANSLATE_Z ) &&
+			bundle.has_ff( sTypeNames::ROTATE_X ) &&
+			bundle.has_ff( sTypeNames::ROTATE_Y ) &&
+			bundle.has_ff( sTypeNames::ROTATE_Z ) )
+		return dPOS_ROT_SEP;
 
 	return dGUESS;
 }
@@ -372,7 +456,8 @@ unsigned CTransformArrayAnimator::createFromClip(
 	mutant::anim_hierarchy const& hier,
 	bool create_looping_animators,
 	eCreationPolicy creationPolicy,
-	bool identity_animator_for_non_existen_bundle
+	bool identity_animator_for_non_existen_bundle,
+	CTransformAnimator::eInterpolateMethod interpolateMethod
 	)
 {
 	typedef mutant::anim_hierarchy::node_cit_t t_hit;
@@ -393,7 +478,7 @@ unsigned CTransformArrayAnimator::createFromClip(
 		for( t_cit it = clip.iterate(); it; ++it )
 		{
 			mutant::anim_bundle const& bundle = *it->second;
-			addAnimator( CTransformAnimator( bundle ) );
+			addAnimator( CTransformAnimator( bundle, CTransformAnimator::tLOOP, CTransformAnimator::dGUESS, interpolateMethod ) );
 			created++;
 		}
 		break;
@@ -402,7 +487,7 @@ unsigned CTransformArrayAnimator::createFromClip(
 		for( t_hit it = hier.iterate(); it; ++it )
 		{
 			if( clip.has( it->name ) ) {
-				addAnimator( CTransformAnimator( clip[ it->name ], timeType ) );
+				addAnimator( CTransformAnimator( clip[ it->name ], timeType, CTransformAnimator::dGUESS, interpolateMethod ) );
 				created++;
 			} else if( identity_animator_for_non_existen_bundle ) {
 				addAnimator( CTransformAnimator( timeType ) );
@@ -415,3 +500,57 @@ unsigned CTransformArrayAnimator::createFromClip(
 
 	return created;
 }
+
+unsigned CTransformArrayAnimator::createFromBinding(
+	CTransformBinding const& binding,
+	bool create_looping_animators,
+	bool identity_animator_for_non_existen_bundle,
+	CTransformAnimator::eInterpolateMethod interpolateMethod
+	)
+{
+	ASSERT( binding.clip() );
+	clear();
+
+	timeController().set_length( binding.clip()->clip_length() );
+	timeController().set_mode( create_looping_animators ? time_controller<>::time_loop : time_controller<>::time_constant );
+
+	CTransformAnimator::eTimeType timeType = CTransformAnimator::tCONSTANT;
+
+	// sources are set in place, a copied animator creates its interpolator again
+	std::vector<CTransformBinding::Node> const& nodes = binding.nodes();
+	mAnimators.reserve( nodes.size() );
+	for( std::vector<CTransformBinding::Node>::const_iterator it = nodes.begin(); it != nodes.end(); ++it )
+	{
+		if( !it->bundle && !identity_animator_for_non_existen_bundle )
+			continue;
+
+		mAnimators.push_back( CTransformAnimator( timeType ) );
+		if( it->bundle )
+			mAnimators.back().setSource( it->dataType, *it->bundle, interpolateMethod );
+		if( !mAnimators.back().isConstant() )
+			mAnimated.push_back( unsigned( mAnimators.size() - 1 ) );
+	}
+
+	return unsigned( mAnimators.size() );
+}
+
+///
+void CTransformBinding::create( mutant::anim_clip const& clip, mutant::anim_hierarchy const& hier )
+{
+	typedef mutant::anim_hierarchy::node_cit_t t_hit;
+
+	mClip = &clip;
+	mHierarchy = &hier;
+	mNodes.resize( 0 );
+	mNodes.reserve( hier.size() );
+	for( t_hit it = hier.iterate(); it; ++it )
+	{
+		Node node = { 0, CTransformAnimator::dGUESS };
+		if( clip.has( it->name ) )
+		{
+			node.bundle = &clip[ it->name ];
+			node.dataType = CTransformAnimator::guessDataType( *node.bundle );
+		}
+		mNodes.push_back( node );
+	}
+}
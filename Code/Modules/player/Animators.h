@@ -61,7 +61,11 @@ public:
 	enum eInterpolateMethod
 	{
 		iLINEAR,
-		iHERMITE // (not supported yet)
+		iHERMITE, // (not supported yet)
+
+		// linear, rotations with normalized lerp instead of slerp (dPOS_ROT_SCL only)
+		iNLERP,
+		iNLERP_CORRECTED
 	};
 
 	enum eTimeType
@@ -110,6 +114,14 @@ public:
 	void setSpeed( float speed ) { mSpeed = speed; }
 #endif
 
+	// true when value() is the same for any time: no curves, or curves whose
+	// keys all hold the same value
+	bool isConstant() const { return mConstant; }
+	bool hasSource() const { return mBundle != 0; }
+
+	// data type dGUESS resolves to for bundle
+	static eDataType guessDataType( mutant::anim_bundle const& bundle );
+
 	CTransform value( float t ) const {
 		if( mAnimatorImpl.get() )
 #if SEPARATE_SPEED
@@ -128,6 +140,8 @@ public:
 protected:
 	eDataType guessDataType();
 	void createInterpolator();
+	template<class QuatEvaluatorT> void createLinearInterpolator();
+	bool hasConstantCurves() const;
 
 private:
 	t_anim_ptr					mAnimatorImpl;
@@ -135,11 +149,39 @@ private:
 	eDataType					mDataType;
 	eInterpolateMethod			mInterpolateMethod;
 	eTimeType					mTimeType;
+	bool						mConstant;
 #if SEPARATE_SPEED
 	float						mSpeed;
 #endif
 };
 
+////////////////////////////////////////////////
+// Nodes of a hierarchy resolved by name to the bundles of a clip, with their
+// data types guessed. Built once per (clip, hierarchy) pair, so setting the
+// clip again does no string matching; see CTransformArrayAnimator::createFromBinding.
+class CTransformBinding
+{
+public:
+	struct Node
+	{
+		mutant::anim_bundle const*		bundle;			// 0 when the clip does not animate the node
+		CTransformAnimator::eDataType	dataType;
+	};
+
+	CTransformBinding() : mClip( 0 ), mHierarchy( 0 ) {}
+
+	void create( mutant::anim_clip const& clip, mutant::anim_hierarchy const& hier );
+
+	mutant::anim_clip const* clip() const { return mClip; }
+	mutant::anim_hierarchy const* hierarchy() const { return mHierarchy; }
+	std::vector<Node> const& nodes() const { return mNodes; }
+
+private:
+	mutant::anim_clip const*		mClip;
+	mutant::anim_hierarchy const*	mHierarchy;
+	std::vector<Node>				mNodes;			// by hierarchy node
+};
+
 ////////////////////////////////////////////////
 class CTransformArrayAnimator
 {
@@ -156,11 +198,15 @@ public:
 
 	void addAnimator( CTransformAnimator const& animator )
 	{
+		if( !animator.isConstant() )
+			mAnimated.push_back( unsigned( mAnimators.size() ) );
 		mAnimators.push_back( animator );
 	}
 
-	void clear() { mAnimators.clear(); }
+	void clear() { mAnimators.clear(); mAnimated.clear(); }
 	size_t size() const { return mAnimators.size(); }
+	CTransformAnimator const& operator[]( size_t index ) const { return mAnimators[ index ]; }
+	std::vector<unsigned> const& animated() const { return mAnimated; }
 	void setSpeed( float speed ) { timeController().set_speed( speed ); }
 
 	mutant::time_controller<>& timeController() { return mTimeController; }
@@ -172,7 +218,17 @@ public:
 		mutant::anim_hierarchy const& hier,
 		bool create_looping_animators = true,
 		eCreationPolicy creationPolicy = FILTER_HIERARCHY,
-		bool identity_animator_for_non_existen_bundle = true
+		bool identity_animator_for_non_existen_bundle = true,
+		CTransformAnimator::eInterpolateMethod interpolateMethod = CTransformAnimator::iLINEAR
+		);
+
+	// Same animators as createFromClip with FILTER_HIERARCHY, from a binding;
+	// replaces the animators created before
+	unsigned createFromBinding(
+		CTransformBinding const& binding,
+		bool create_looping_animators = true,
+		bool identity_animator_for_non_existen_bundle = true,
+		CTransformAnimator::eInterpolateMethod interpolateMethod = CTransformAnimator::iLINEAR
 		);
 
 	// Updates matrices begining at supplied iterator 'dest'
@@ -197,8 +253,25 @@ public:
 		}
 	}
 
+	// Same as updateTransforms, but skips constant animators
+	// Their slots in [dest, destEnd) must hold values from an earlier updateTransforms
+	template<typename ItT>
+	void updateAnimatedTransforms( float t, ItT dest, ItT destEnd )
+	{
+		mTimeController.set_time( t );
+
+		size_t const count = destEnd - dest;
+		for( std::vector<unsigned>::const_iterator it = mAnimated.begin(); it != mAnimated.end(); ++it )
+		{
+			if( !(*it < count) )
+				break;
+			*( dest + *it ) = mAnimators[ *it ].value( mTimeController.processed_time() );
+		}
+	}
+
 private:
 	t_animators					mAnimators;
+	std::vector<unsigned>		mAnimated;			// indices of animators that are not constant
 	mutant::time_controller<>	mTimeController;
 };
 
@@ -0,0 +1,366 @@
+#include "AudioStream.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__psp__)
+#	include <pspkernel.h>
+	// single core, only the compiler has to be kept from reordering
+#	define AUDIO_BARRIER() __asm__ __volatile__("" ::: "memory")
+#elif defined(WIN32)
+#	include <windows.h>
+#	include <time.h>
+#	define AUDIO_BARRIER() MemoryBarrier()
+#else
+#	include <sys/time.h>
+#	define AUDIO_BARRIER() __sync_synchronize()
+#endif
+
+using namespace mutalisk;
+
+namespace
+{
+	unsigned readU16(unsigned char const* p) { return p[0] | (p[1] << 8); }
+	unsigned readU32(unsigned char const* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24); }
+
+	// KSDATAFORMAT_SUBTYPE_ATRAC3PLUS
+	unsigned char const ATRAC3PLUS_GUID[16] = {
+		0xbf, 0xaa, 0x23, 0xe9, 0x58, 0xcb, 0x71, 0x44, 0xa1, 0x19, 0xff, 0xfa, 0x01, 0xe4, 0xce, 0x62 };
+
+	enum
+	{
+		WAVE_FORMAT_PCM = 0x0001,
+		WAVE_FORMAT_ATRAC3 = 0x0270,
+		WAVE_FORMAT_EXTENSIBLE = 0xfffe,
+
+		ATRAC3_SAMPLES_PER_FRAME = 1024,
+		ATRAC3PLUS_SAMPLES_PER_FRAME = 2048
+	};
+}
+
+////////////////////////////////////////////////
+AudioSeekIndex::AudioSeekIndex()
+:	format(Unknown)
+,	frequency(0)
+,	channels(0)
+,	dataOffset(0)
+,	dataLength(0)
+,	blockAlign(0)
+,	samplesPerBlock(0)
+{
+}
+
+bool AudioSeekIndex::build(AudioFile& file)
+{
+	format = Unknown;
+	unsigned char header[12];
+	if(file.read(header, sizeof(header)) != sizeof(header) ||
+		memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+	{
+		printf("file not riff-wave\n");
+		return false;
+	}
+
+	unsigned pos = sizeof(header);
+	unsigned formatTag = 0;
+	unsigned char fmt[40];
+	for(;;)
+	{
+		unsigned char chunk[8];
+		if(file.read(chunk, sizeof(chunk)) != sizeof(chunk))
+		{
+			printf("unable to find data chunk\n");
+			return false;
+		}
+		pos += sizeof(chunk);
+		unsigned chunkSize = readU32(chunk + 4);
+
+		if(memcmp(chunk, "data", 4) == 0)
+		{
+			dataOffset = pos;
+			dataLength = chunkSize;
+			break;
+		}
+
+		unsigned skip = chunkSize + (chunkSize & 1);
+		if(memcmp(chunk, "fmt ", 4) == 0)
+		{
+			unsigned fmtSize = (chunkSize < sizeof(fmt))? chunkSize: sizeof(fmt);
+			memset(fmt, 0, sizeof(fmt));
+			if(fmtSize < 16 || file.read(fmt, fmtSize) != (int)fmtSize)
+			{
+				printf("broken fmt chunk\n");
+				return false;
+			}
+			formatTag = readU16(fmt);
+			channels = readU16(fmt + 2);
+			frequency = readU32(fmt + 4);
+			blockAlign = readU16(fmt + 12);
+			pos += fmtSize;
+			skip -= fmtSize;
+		}
+
+		if(skip > 0)
+			file.seek(pos + skip);
+		pos += skip;
+	}
+
+	if(formatTag == WAVE_FORMAT_EXTENSIBLE)
+	{
+		if(memcmp(fmt + 24, ATRAC3PLUS_GUID, sizeof(ATRAC3PLUS_GUID)) == 0)
+		{
+			format = Atrac3Plus;
+			samplesPerBlock = ATRAC3PLUS_SAMPLES_PER_FRAME;
+		}
+		else
+			formatTag = readU16(fmt + 24);
+	}
+	if(format == Unknown && formatTag == WAVE_FORMAT_ATRAC3)
+	{
+		format = Atrac3;
+		samplesPerBlock = ATRAC3_SAMPLES_PER_FRAME;
+	}
+	if(format == Unknown && formatTag == WAVE_FORMAT_PCM)
+	{
+		format = Pcm;
+		samplesPerBlock = 1;
+	}
+
+	if(format == Unknown || blockAlign == 0)
+	{
+		printf("unsupported format = 0x%x\n", formatTag);
+		return false;
+	}
+	return true;
+}
+
+unsigned AudioSeekIndex::offsetForSample(unsigned sample) const
+{
+	unsigned block = sample / samplesPerBlock;
+	if(block >= blockCount())
+		return blockCount() * blockAlign;
+	return block * blockAlign;
+}
+
+unsigned AudioSeekIndex::sampleForOffset(unsigned offset) const
+{
+	return (offset / blockAlign) * samplesPerBlock;
+}
+
+////////////////////////////////////////////////
+AudioRing::AudioRing(unsigned capacity)
+:	mData(new unsigned char[capacity])
+,	mMask(capacity - 1)
+,	mRead(0)
+,	mWrite(0)
+{
+	ASSERT((capacity & mMask) == 0);
+}
+
+AudioRing::~AudioRing()
+{
+	delete[] mData;
+}
+
+unsigned AudioRing::writeSpan(unsigned char** dst) const
+{
+	unsigned write = mWrite;
+	unsigned free = capacity() - (write - mRead);
+	unsigned toEnd = capacity() - (write & mMask);
+	*dst = mData + (write & mMask);
+	return (free < toEnd)? free: toEnd;
+}
+
+void AudioRing::commit(unsigned size)
+{
+	ASSERT(size <= capacity() - available());
+	AUDIO_BARRIER();
+	mWrite = mWrite + size;
+}
+
+unsigned AudioRing::read(void* dst, unsigned size)
+{
+	unsigned read = mRead;
+	unsigned ready = mWrite - read;
+	AUDIO_BARRIER();
+
+	if(size > ready)
+		size = ready;
+	unsigned first = capacity() - (read & mMask);
+	if(first > size)
+		first = size;
+	memcpy(dst, mData + (read & mMask), first);
+	memcpy(static_cast<unsigned char*>(dst) + first, mData, size - first);
+
+	AUDIO_BARRIER();
+	mRead = read + size;
+	return size;
+}
+
+void AudioRing::discardTo(unsigned index)
+{
+	// never move backwards, the consumer may already be past index
+	if(static_cast<int>(index - mRead) > 0)
+		mRead = index;
+}
+
+////////////////////////////////////////////////
+AudioStream::AudioStream(unsigned ringSize, unsigned readSize)
+:	mRing(ringSize)
+,	mFile(0)
+,	mReadSize(readSize)
+,	mFilePos(0)
+,	mSeekServed(0)
+,	mSeekSample(0)
+,	mSeekRequest(0)
+,	mSeekAck(0)
+,	mFlushIndex(0)
+,	mFlushPos(0)
+,	mEndOfData(false)
+,	mSeekApplied(0)
+,	mSeekStart(0)
+,	mSeekPending(false)
+,	mPlayPos(0)
+{
+	ASSERT(readSize <= ringSize);
+}
+
+bool AudioStream::open(AudioFile* file)
+{
+	mFile = file;
+	if(!mFile || !mIndex.build(*mFile))
+		return false;
+
+	mFilePos = 0;
+	mPlayPos = 0;
+	mEndOfData = false;
+	return mFile->seek(mIndex.dataOffset);
+}
+
+bool AudioStream::fill()
+{
+	ASSERT(mFile);
+
+	unsigned request = mSeekRequest;
+	if(request != mSeekServed)
+	{
+		AUDIO_BARRIER();
+		unsigned offset = mIndex.offsetForSample(mSeekSample);
+		mFile->seek(mIndex.dataOffset + offset);
+		mFilePos = offset;
+		mFlushPos = offset;
+		mFlushIndex = mRing.writeIndex();
+		mEndOfData = false;
+		AUDIO_BARRIER();
+		mSeekAck = request;
+		mSeekServed = request;
+	}
+
+	if(mFilePos >= mIndex.dataLength)
+	{
+		mEndOfData = true;
+		return false;
+	}
+
+	unsigned char* dst;
+	unsigned size = mRing.writeSpan(&dst);
+	if(size > mReadSize)
+		size = mReadSize;
+	if(size > mIndex.dataLength - mFilePos)
+		size = mIndex.dataLength - mFilePos;
+	if(size == 0)
+		return true;
+
+	++mStats.reads;
+	int bytes = mFile->read(dst, size);
+	if(bytes <= 0)
+	{
+		mEndOfData = true;
+		return false;
+	}
+
+	mRing.commit(bytes);
+	mFilePos += bytes;
+	return true;
+}
+
+unsigned AudioStream::read(void* dst, unsigned size)
+{
+	unsigned ack = mSeekAck;
+	if(ack != mSeekApplied)
+	{
+		AUDIO_BARRIER();
+		unsigned flushIndex = mFlushIndex;
+		mRing.discardTo(flushIndex);
+		mPlayPos = mFlushPos + (mRing.readIndex() - flushIndex);
+		mSeekApplied = ack;
+	}
+
+	unsigned bytes = mRing.read(dst, size);
+	mPlayPos += bytes;
+
+	if(mSeekPending && bytes > 0 && ack == mSeekRequest)
+	{
+		unsigned latency = microseconds() - mSeekStart;
+		++mStats.completedSeeks;
+		mStats.seekLatency += latency;
+		if(latency > mStats.maxSeekLatency)
+			mStats.maxSeekLatency = latency;
+		mSeekPending = false;
+	}
+
+	if(bytes < size && mIndex.format == AudioSeekIndex::Pcm)
+	{
+		memset(static_cast<unsigned char*>(dst) + bytes, 0, size - bytes);
+		if(!mEndOfData && !mSeekPending)
+		{
+			++mStats.underruns;
+			mStats.underrunBytes += size - bytes;
+		}
+	}
+	return bytes;
+}
+
+void AudioStream::seek(unsigned sample)
+{
+	// drop buffered data right away so the producer has the whole ring
+	// available for the new position
+	mRing.discardTo(mRing.writeIndex());
+	mSeekSample = sample;
+	AUDIO_BARRIER();
+	mSeekRequest = mSeekRequest + 1;
+	mSeekStart = microseconds();
+	mSeekPending = true;
+	++mStats.seeks;
+}
+
+unsigned AudioStream::position() const
+{
+	return mIndex.sampleForOffset(mPlayPos);
+}
+
+bool AudioStream::finished() const
+{
+	return mEndOfData && !mSeekPending && mRing.available() == 0;
+}
+
+void AudioStream::printStats() const
+{
+	printf("audio stream: reads %u, underruns %u (%u bytes), seeks %u (%u completed)", mStats.reads, mStats.underruns, mStats.underrunBytes, mStats.seeks, mStats.completedSeeks);
+	if(mStats.completedSeeks > 0)
+		printf(", seek latency avg %.3f ms, max %.3f ms", mStats.seekLatency / (1000.0f * mStats.completedSeeks), mStats.maxSeekLatency / 1000.0f);
+	printf("\n");
+}
+
+unsigned AudioStream::microseconds()
+{
+#if defined(__psp__)
+	return sceKernelGetSystemTimeLow();
+#elif defined(WIN32)
+	return static_cast<unsigned>( clock() * ( 1000000.0 / CLOCKS_PER_SEC ) );
+#else
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return static_cast<unsigned>(tv.tv_sec * 1000000 + tv.tv_usec);
+#endif
+}
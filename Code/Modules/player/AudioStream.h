@@ -0,0 +1,141 @@
+#ifndef MUTALISK__AUDIOSTREAM_H_
+#define MUTALISK__AUDIOSTREAM_H_
+
+#include "cfg.h"
+
+namespace mutalisk
+{
+	// platform file access used by the streamer
+	class AudioFile
+	{
+	public:
+		virtual ~AudioFile() {}
+		virtual int read(void* dst, unsigned size) = 0;
+		virtual bool seek(unsigned offset) = 0;
+	};
+
+	// seekable units of a RIFF audio file: sample frames for PCM, codec frames
+	// for ATRAC3/ATRAC3plus; both have a constant byte size so the index is
+	// parsed once from the header and any sample maps to a file offset directly
+	struct AudioSeekIndex
+	{
+		enum nFormat { Unknown, Pcm, Atrac3, Atrac3Plus };
+
+		AudioSeekIndex();
+		bool build(AudioFile& file);
+
+		unsigned blockCount() const { return (blockAlign)? dataLength / blockAlign: 0; }
+		unsigned sampleCount() const { return blockCount() * samplesPerBlock; }
+		// data relative offset of the block containing sample
+		unsigned offsetForSample(unsigned sample) const;
+		unsigned sampleForOffset(unsigned offset) const;
+
+		nFormat		format;
+		unsigned	frequency;
+		unsigned	channels;
+		unsigned	dataOffset;
+		unsigned	dataLength;
+		unsigned	blockAlign;
+		unsigned	samplesPerBlock;
+	};
+
+	// single producer / single consumer lock-free ring, indices grow
+	// monotonically and are wrapped by the power of two capacity
+	class AudioRing
+	{
+	public:
+		AudioRing(unsigned capacity);
+		~AudioRing();
+
+		// producer
+		unsigned writeSpan(unsigned char** dst) const;
+		void commit(unsigned size);
+		unsigned writeIndex() const { return mWrite; }
+
+		// consumer
+		unsigned read(void* dst, unsigned size);
+		void discardTo(unsigned index);
+		unsigned readIndex() const { return mRead; }
+		unsigned available() const { return mWrite - mRead; }
+
+		unsigned capacity() const { return mMask + 1; }
+
+	private:
+		AudioRing(AudioRing const&);
+		AudioRing& operator= (AudioRing const&);
+
+		unsigned char*		mData;
+		unsigned			mMask;
+		volatile unsigned	mRead;
+		volatile unsigned	mWrite;
+	};
+
+	// file streamer, fill() runs on the producer (io) thread and read() on the
+	// consumer (audio) thread; seek() is posted by the consumer and served by
+	// the producer with a single file read
+	class AudioStream
+	{
+	public:
+		struct Stats
+		{
+			Stats() : reads(0), underruns(0), underrunBytes(0), seeks(0), completedSeeks(0), seekLatency(0), maxSeekLatency(0) {}
+			unsigned	reads;
+			unsigned	underruns;
+			unsigned	underrunBytes;
+			unsigned	seeks;
+			unsigned	completedSeeks;		// not superseded by a later seek
+			unsigned	seekLatency;		// microseconds, sum over completed seeks
+			unsigned	maxSeekLatency;		// microseconds
+		};
+
+		AudioStream(unsigned ringSize = 64*1024, unsigned readSize = 16*1024);
+
+		bool open(AudioFile* file);
+		AudioSeekIndex const& index() const { return mIndex; }
+
+		// producer side, returns false when there is nothing left to read
+		bool fill();
+		bool isFull() const { return mRing.available() + mReadSize > mRing.capacity(); }
+
+		// consumer side, missing PCM data is replaced with silence; silence
+		// while a seek is pending is not counted as an underrun
+		unsigned read(void* dst, unsigned size);
+		void seek(unsigned sample);
+		unsigned position() const;
+		bool finished() const;
+
+		Stats const& stats() const { return mStats; }
+		void printStats() const;
+
+		static unsigned microseconds();
+
+	private:
+		AudioRing			mRing;
+		AudioSeekIndex		mIndex;
+		AudioFile*			mFile;
+		unsigned			mReadSize;
+
+		// producer state
+		unsigned			mFilePos;
+		unsigned			mSeekServed;
+
+		// seek handshake
+		volatile unsigned	mSeekSample;
+		volatile unsigned	mSeekRequest;
+		volatile unsigned	mSeekAck;
+		volatile unsigned	mFlushIndex;
+		volatile unsigned	mFlushPos;
+		volatile bool		mEndOfData;
+
+		// consumer state
+		unsigned			mSeekApplied;
+		unsigned			mSeekStart;
+		bool				mSeekPending;
+		unsigned			mPlayPos;
+
+		Stats				mStats;
+	};
+
+} // namespace mutalisk
+
+#endif // MUTALISK__AUDIOSTREAM_H_
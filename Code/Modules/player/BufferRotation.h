@@ -0,0 +1,96 @@
+#ifndef MUTALISK__BUFFER_ROTATION_H_
+#define MUTALISK__BUFFER_ROTATION_H_
+
+#include "cfg.h"
+
+namespace mutalisk
+{
+	// Frame fence of a backend. Every recorded frame signals a value once the
+	// GPU is done with it, values grow by one per frame starting at 1.
+	class GpuFence
+	{
+	public:
+		typedef unsigned ValueT;
+
+		virtual ~GpuFence() {}
+
+		// value the frame being recorded will signal
+		virtual ValueT pending() const = 0;
+		// last value signalled
+		virtual ValueT completed() const = 0;
+		// blocks until completed() >= value; a value that was not submitted
+		// yet cannot be waited for and returns at once
+		virtual void wait(ValueT value) = 0;
+	};
+
+	// Picks which of N buffers the CPU writes next, for data rewritten every
+	// frame while the GPU may still read earlier versions:
+	//
+	//	mesh.mAmplifiedBufferIndex = mesh.mAmplifiedRotation.acquire(fence);
+	//	... write mAmplifiedVertexData[mAmplifiedBufferIndex]
+	//	...
+	//	mesh.mAmplifiedRotation.markDrawn(fence);	// when a draw references it
+	//
+	// Each buffer remembers the last frame that drew it. acquire() never hands
+	// out a buffer a frame in flight still reads; the least recently drawn
+	// buffer is taken, waiting on the fence only when all of them are in use.
+	// The buffer memory is owned by the caller.
+	class BufferRotation
+	{
+	public:
+		enum { MaxBuffers = 4 };
+
+		BufferRotation(unsigned count = 2) { reset(count); }
+
+		void reset(unsigned count)
+		{
+			ASSERT(count > 0 && count <= MaxBuffers);
+			mCount = count;
+			mCurrent = 0;
+			mStalls = 0;
+			for(unsigned q = 0; q < MaxBuffers; ++q)
+				mLastDrawn[q] = 0;
+		}
+
+		unsigned count() const { return mCount; }
+		// buffer written last, the one to draw
+		unsigned current() const { return mCurrent; }
+		// acquire() calls that had to wait for the GPU
+		unsigned stalls() const { return mStalls; }
+		GpuFence::ValueT lastDrawn(unsigned index) const { ASSERT(index < mCount); return mLastDrawn[index]; }
+
+		unsigned acquire(GpuFence& fence)
+		{
+			// round robin from the one after current, so ties rotate
+			unsigned best = (mCurrent + 1) % mCount;
+			for(unsigned q = 1; q < mCount; ++q)
+			{
+				unsigned index = (mCurrent + 1 + q) % mCount;
+				if(mLastDrawn[index] < mLastDrawn[best])
+					best = index;
+			}
+
+			if(mLastDrawn[best] > fence.completed())
+			{
+				++mStalls;
+				fence.wait(mLastDrawn[best]);
+			}
+			mCurrent = best;
+			return best;
+		}
+
+		// the current buffer is read by the frame being recorded
+		void markDrawn(GpuFence const& fence) const
+		{
+			mLastDrawn[mCurrent] = fence.pending();
+		}
+
+	private:
+		unsigned					mCount;
+		unsigned					mCurrent;
+		unsigned					mStalls;
+		mutable GpuFence::ValueT	mLastDrawn[MaxBuffers];
+	};
+}
+
+#endif // MUTALISK__BUFFER_ROTATION_H_
@@ -0,0 +1,257 @@
+#include "CpuPostProcess.h"
+#include "Profiler.h"
+
+#include <vector>
+
+using namespace mutalisk;
+using namespace mutalisk::cpu;
+
+namespace
+{
+	// red/blue and alpha/green are split into two words with a 16bit lane per
+	// channel, which leaves room for carries and for sums of up to 257 pixels
+	enum { LaneMask = 0x00ff00ff, LaneCarry = 0x01000100, MaxRadius = 127 };
+
+	inline unsigned lanesRB(unsigned c) { return c & LaneMask; }
+	inline unsigned lanesAG(unsigned c) { return (c >> 8) & LaneMask; }
+	inline unsigned pack(unsigned rb, unsigned ag) { return rb | (ag << 8); }
+
+	// max(a - b, 0) in both lanes
+	inline unsigned subSaturate(unsigned a, unsigned b)
+	{
+		unsigned d = (a | LaneCarry) - b;
+		unsigned keep = d & LaneCarry;
+		return d & (keep - (keep >> 8));
+	}
+
+	// min(a + b, 255) in both lanes
+	inline unsigned addSaturate(unsigned a, unsigned b)
+	{
+		unsigned s = a + b;
+		unsigned over = s & LaneCarry;
+		return (s | (over - (over >> 8))) & LaneMask;
+	}
+
+	// x * m / 255 in both lanes, m = 255 keeps x intact
+	inline unsigned scale(unsigned x, unsigned m)
+	{
+		return ((x * (m + (m >> 7))) >> 8) & LaneMask;
+	}
+
+	// sum / n in both lanes of a running sum, inverse rounded up so that
+	// a constant 255 area stays 255
+	inline unsigned average(unsigned sum, unsigned inverse)
+	{
+		return (((sum & 0xffff) * inverse) >> 16) | ((((sum >> 16) * inverse) >> 16) << 16);
+	}
+
+	inline unsigned inverseTaps(int radius)
+	{
+		unsigned taps = 2 * radius + 1;
+		return (65536 + taps - 1) / taps;
+	}
+
+	inline int clampRadius(int radius)
+	{
+		return (radius > MaxRadius)? MaxRadius: radius;
+	}
+
+	struct BloomJob
+	{
+		Image*		target;
+		Image*		src;
+		Image*		dst;
+		unsigned	threshold;
+		unsigned	srcModifier;
+		unsigned	dstModifier;
+		int			radius;
+	};
+
+	void thresholdJob(void* ctx, int first, int count)
+	{
+		BloomJob& job = *static_cast<BloomJob*>(ctx);
+		threshold(*job.target, *job.dst, job.threshold, first, count);
+	}
+
+	void blurRowsJob(void* ctx, int first, int count)
+	{
+		BloomJob& job = *static_cast<BloomJob*>(ctx);
+		blurRows(*job.src, *job.dst, job.radius, first, count);
+	}
+
+	void blurColumnsJob(void* ctx, int first, int count)
+	{
+		BloomJob& job = *static_cast<BloomJob*>(ctx);
+		blurColumns(*job.src, *job.dst, job.radius, first, count);
+	}
+
+	void compositeJob(void* ctx, int first, int count)
+	{
+		BloomJob& job = *static_cast<BloomJob*>(ctx);
+		composite(*job.target, *job.src, job.srcModifier, job.dstModifier, first, count);
+	}
+
+	void run(ParallelForT parallelFor, JobT job, void* ctx, int count)
+	{
+		if(parallelFor)
+			parallelFor(job, ctx, count);
+		else
+			job(ctx, 0, count);
+	}
+}
+
+////////////////////////////////////////////////
+void cpu::threshold(Image const& src, Image& dst, unsigned threshold, int firstRow, int rowCount)
+{
+	unsigned const t = lanesRB(threshold * 0x01010101);
+	for(int y = firstRow; y < firstRow + rowCount; ++y)
+	{
+		unsigned const* in = src.row(y);
+		unsigned* out = dst.row(y);
+		for(int x = 0; x < src.width; ++x)
+		{
+			unsigned c = in[x];
+			out[x] = pack(subSaturate(lanesRB(c), t), subSaturate(lanesAG(c), t));
+		}
+	}
+}
+
+void cpu::blurRows(Image const& src, Image& dst, int radius, int firstRow, int rowCount)
+{
+	radius = clampRadius(radius);
+	unsigned const inverse = inverseTaps(radius);
+	int const last = src.width - 1;
+
+	for(int y = firstRow; y < firstRow + rowCount; ++y)
+	{
+		unsigned const* in = src.row(y);
+		unsigned* out = dst.row(y);
+
+		unsigned sumRB = lanesRB(in[0]) * (radius + 1);
+		unsigned sumAG = lanesAG(in[0]) * (radius + 1);
+		for(int x = 1; x <= radius; ++x)
+		{
+			unsigned c = in[(x < last)? x: last];
+			sumRB += lanesRB(c);
+			sumAG += lanesAG(c);
+		}
+
+		for(int x = 0; x < src.width; ++x)
+		{
+			out[x] = pack(average(sumRB, inverse), average(sumAG, inverse));
+
+			unsigned add = in[(x + radius + 1 < last)? x + radius + 1: last];
+			unsigned sub = in[(x - radius > 0)? x - radius: 0];
+			sumRB += lanesRB(add) - lanesRB(sub);
+			sumAG += lanesAG(add) - lanesAG(sub);
+		}
+	}
+}
+
+void cpu::blurColumns(Image const& src, Image& dst, int radius, int firstColumn, int columnCount)
+{
+	radius = clampRadius(radius);
+	unsigned const inverse = inverseTaps(radius);
+	int const last = src.height - 1;
+
+	// running sums for a stripe of columns, walking down keeps memory access linear
+	std::vector<unsigned> sums(columnCount * 2);
+	unsigned* sumRB = &sums[0];
+	unsigned* sumAG = &sums[columnCount];
+
+	unsigned const* in = src.row(0) + firstColumn;
+	for(int x = 0; x < columnCount; ++x)
+	{
+		sumRB[x] = lanesRB(in[x]) * (radius + 1);
+		sumAG[x] = lanesAG(in[x]) * (radius + 1);
+	}
+	for(int y = 1; y <= radius; ++y)
+	{
+		in = src.row((y < last)? y: last) + firstColumn;
+		for(int x = 0; x < columnCount; ++x)
+		{
+			sumRB[x] += lanesRB(in[x]);
+			sumAG[x] += lanesAG(in[x]);
+		}
+	}
+
+	for(int y = 0; y < src.height; ++y)
+	{
+		unsigned* out = dst.row(y) + firstColumn;
+		unsigned const* add = src.row((y + radius + 1 < last)? y + radius + 1: last) + firstColumn;
+		unsigned const* sub = src.row((y - radius > 0)? y - radius: 0) + firstColumn;
+		for(int x = 0; x < columnCount; ++x)
+		{
+			out[x] = pack(average(sumRB[x], inverse), average(sumAG[x], inverse));
+			sumRB[x] += lanesRB(add[x]) - lanesRB(sub[x]);
+			sumAG[x] += lanesAG(add[x]) - lanesAG(sub[x]);
+		}
+	}
+}
+
+void cpu::composite(Image& target, Image const& bloom, unsigned srcModifier, unsigned dstModifier, int firstRow, int rowCount)
+{
+	for(int y = firstRow; y < firstRow + rowCount; ++y)
+	{
+		unsigned* out = target.row(y);
+		unsigned const* in = bloom.row(y);
+		for(int x = 0; x < target.width; ++x)
+		{
+			unsigned d = out[x];
+			unsigned s = in[x];
+			unsigned rb = addSaturate(scale(lanesRB(d), dstModifier), scale(lanesRB(s), srcModifier));
+			unsigned ag = addSaturate(scale(lanesAG(d), dstModifier), scale(lanesAG(s), srcModifier));
+			out[x] = (pack(rb, ag) & 0x00ffffff) | (d & 0xff000000);
+		}
+	}
+}
+
+int cpu::blurRadius(float strength, unsigned quality)
+{
+	// gpuBlurFast places 2*quality taps at odd half texel offsets scaled by
+	// strength * (6 - quality); the outermost tap gives the box half width
+	if(strength <= 0.0f)
+		return 0;
+	int radius = static_cast<int>((quality - 0.5f) * strength * (6.0f - quality) + 0.5f);
+	return (radius < 1)? 1: clampRadius(radius);
+}
+
+void cpu::bloom(Image& target, Image& scratch0, Image& scratch1,
+	float strength, unsigned threshold, unsigned srcModifier, unsigned dstModifier, unsigned quality,
+	ParallelForT parallelFor)
+{
+	ASSERT(scratch0.width == target.width && scratch0.height == target.height);
+	ASSERT(scratch1.width == target.width && scratch1.height == target.height);
+
+	BloomJob job;
+	job.target = &target;
+	job.threshold = threshold;
+	job.srcModifier = srcModifier;
+	job.dstModifier = dstModifier;
+	job.radius = blurRadius(strength, quality);
+
+	MUTALISK_PROFILE_ZONE("cpu::bloom");
+	{
+		MUTALISK_PROFILE_ZONE("cpu::threshold");
+		job.dst = &scratch0;
+		run(parallelFor, thresholdJob, &job, target.height);
+	}
+
+	for(int q = 0; q < 2 && job.radius > 0; ++q)
+	{
+		MUTALISK_PROFILE_ZONE("cpu::blur");
+		job.src = &scratch0;
+		job.dst = &scratch1;
+		run(parallelFor, blurRowsJob, &job, target.height);
+
+		job.src = &scratch1;
+		job.dst = &scratch0;
+		run(parallelFor, blurColumnsJob, &job, target.width);
+	}
+
+	{
+		MUTALISK_PROFILE_ZONE("cpu::composite");
+		job.src = &scratch0;
+		run(parallelFor, compositeJob, &job, target.height);
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef MUTALISK__CPUPOSTPROCESS_H_
+#define MUTALISK__CPUPOSTPROCESS_H_
+
+#include "cfg.h"
+
+namespace mutalisk
+{
+	// software version of the bloom in TimelinePlayer, takes the same parameters
+	// as BaseDemoPlayer::PostProcessSettings. Pixels are RGBA8 stored as 32bit
+	// words and are processed two channels per 16bit lane of a word
+	namespace cpu
+	{
+		struct Image
+		{
+			unsigned*	data;
+			int			width;
+			int			height;
+			int			stride;		// in pixels
+
+			unsigned* row(int y) const { return data + y * stride; }
+		};
+
+		// jobs work on [first, first + count) rows (or columns for blurColumns),
+		// a ParallelForT splits count into ranges and runs them concurrently
+		typedef void (*JobT)(void* ctx, int first, int count);
+		typedef void (*ParallelForT)(JobT job, void* ctx, int count);
+
+		// dst = max(src - threshold, 0) per channel
+		void threshold(Image const& src, Image& dst, unsigned threshold, int firstRow, int rowCount);
+		// box filter of 2*radius+1 taps with running sums, clamped at the edges
+		void blurRows(Image const& src, Image& dst, int radius, int firstRow, int rowCount);
+		void blurColumns(Image const& src, Image& dst, int radius, int firstColumn, int columnCount);
+		// target = target * dstModifier/255 + bloom * srcModifier/255, saturated; alpha is kept
+		void composite(Image& target, Image const& bloom, unsigned srcModifier, unsigned dstModifier, int firstRow, int rowCount);
+
+		// blur radius in pixels matching the tap spread of gpuBlurFast
+		int blurRadius(float strength, unsigned quality);
+
+		// threshold, two separable blur iterations and additive composite;
+		// scratch images must have the same size as target
+		void bloom(Image& target, Image& scratch0, Image& scratch1,
+			float strength, unsigned threshold, unsigned srcModifier, unsigned dstModifier, unsigned quality,
+			ParallelForT parallelFor = 0);
+	}
+
+} // namespace mutalisk
+
+#endif // MUTALISK__CPUPOSTPROCESS_H_
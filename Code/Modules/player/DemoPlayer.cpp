@@ -2,6 +2,7 @@
 
 #include "Timeline.h"
 #include "ScenePlayer.h"
+#include "Profiler.h"
 #if defined(MUTALISK_DX9)
 #	include "dx9/dx9ScenePlayer.h"
 #elif defined(MUTALISK_PSP)
@@ -66,6 +67,18 @@ BaseDemoPlayer::Scene const& BaseDemoPlayer::load(Scene& scene, std::string cons
 	return scene;
 }
 
+BaseDemoPlayer::Scene const& BaseDemoPlayer::instance(Scene& scene, Scene const& source)
+{
+	ASSERT(source.renderable);
+	scene.pathPrefix = source.pathPrefix;
+	scene.blueprint = source.blueprint;
+	scene.renderable = prepareInstance(renderContext, *source.renderable).release();
+	scene.startTime = -1.0f;
+	scene.znear = source.znear;
+	scene.zfar = source.zfar;
+	return scene;
+}
+
 void BaseDemoPlayer::restart(Scene const& scene)
 {
 	scene.startTime = -1.0f;
@@ -99,8 +112,12 @@ void BaseDemoPlayer::loadTextures(Scene& scene, bool async)
 		}
 		else
 		{
-			textures[q].blueprint = loadResource<mutalisk::data::texture>(textureIds[q]);
-			textures[q].renderable = prepare(renderContext, *textures[q].blueprint);
+			textures[q].blueprint = loadTexture(textureIds[q]);
+			// a texture that failed to read stays empty, the scene draws without it
+			if(textures[q].blueprint.get())
+				textures[q].renderable = prepare(renderContext, *textures[q].blueprint);
+			else
+				printf("texture %s missing\n", textureIds[q].c_str());
 		}
 	}
 }
@@ -114,6 +131,7 @@ void BaseDemoPlayer::unloadTextures(Scene& scene)
 
 int BaseDemoPlayer::updateTextures()
 {
+	MUTALISK_PROFILE_ZONE("textureStreaming");
 	// if texture load in flight; check to see if done
 	if (m_currentLoad)
 	{
@@ -136,10 +154,9 @@ int BaseDemoPlayer::updateTextures()
 		}
 		sceIoClose(m_currentLoad);
 		m_currentLoad = 0;
-		std::auto_ptr<data::texture> resource(new mutalisk::data::texture);
-		resource->patchupTextureFromMemory(m_currentTexture);
 
-		m_currentResource->blueprint = resource;
+		m_currentResource->blueprint = acquireTexture(m_currentTexture, m_currentSize);
+		ResourceCache<data::texture>::getInstance().addLoadTime(sceKernelGetSystemTimeLow() - m_currentStartTime);
 		m_currentResource->renderable = prepare(renderContext, *m_currentResource->blueprint);
 		return m_texQueue.size();
 	}
@@ -152,6 +169,7 @@ int BaseDemoPlayer::updateTextures()
 		m_currentResource = item.second;	
 
 //		printf("trying to open file %s\n", name.c_str());
+		m_currentStartTime = sceKernelGetSystemTimeLow();
 		m_currentLoad = sceIoOpen(name.c_str(), PSP_O_RDONLY, 0777);
 		if (m_currentLoad>=0)
 		{
@@ -160,6 +178,7 @@ int BaseDemoPlayer::updateTextures()
 			sceIoLseek(m_currentLoad, 0, PSP_SEEK_SET);
 //			printf("file size = %i\n", size);
 			m_currentTexture = (data::MtxHeader*)malloc(size + sizeof(data::MtxHeader));
+			m_currentSize = size;
 //			printf("mem ptr = %x\n", (unsigned)m_currentTexture);
 			if (sceIoChangeAsyncPriority(m_currentLoad, 0x8))
 			{
@@ -201,6 +220,18 @@ void BaseDemoPlayer::setPath(std::string const& pathPrefix)
 	return time() - scene.startTime;
 }
 
+void BaseDemoPlayer::animationLod(Scene const& scene, AnimationLod const& lod)
+{
+	ASSERT(scene.renderable);
+	scene.renderable->setAnimationLod(lod);
+}
+
+void BaseDemoPlayer::invalidate(Scene const& scene)
+{
+	ASSERT(scene.renderable);
+	scene.renderable->invalidate();
+}
+
 namespace {
 void onDrawDefault(RenderableSceneT const& scene) {}
 }
@@ -229,6 +260,7 @@ void BaseDemoPlayer::draw(Scene const& scene, OnDrawT onDraw, float timeScale)
 {
 	if(mPhase == UpdatePhase)
 	{
+		MUTALISK_PROFILE_ZONE("draw.update");
 		if(scene.startTime <= 0.0f)
 			scene.startTime = time();
 
@@ -247,6 +279,7 @@ void BaseDemoPlayer::draw(Scene const& scene, OnDrawT onDraw, float timeScale)
 	}
 	else if(mPhase == RenderPhase)
 	{
+		MUTALISK_PROFILE_ZONE("draw.render");
 		renderContext.znear = scene.znear;
 		renderContext.zfar = scene.zfar;
 		mutalisk::render(renderContext, *scene.renderable);
@@ -4,6 +4,7 @@
 #include "cfg.h"
 #include "platform.h"
 #include <mutalisk/mutalisk.h>
+#include "ResourceCache.h"
 #if defined(MUTALISK_PSP)
 #include <pspkernel.h>
 #include <list>
@@ -18,7 +19,7 @@ namespace mutalisk
 	public:
 		struct Scene
 		{
-			std::auto_ptr<mutalisk::data::scene>	blueprint;
+			SharedRef<mutalisk::data::scene>		blueprint;		// shared with instances
 			mutable RenderableSceneT*				renderable;
 			mutable float							startTime;
 			std::string								pathPrefix;
@@ -45,11 +46,16 @@ namespace mutalisk
 		void clearColor();
 
 		Scene const& load(Scene& scene, std::string const& sceneName);
+		// another copy of a loaded scene, it shares all loaded data with source
+		// and has its own time, clip, level of detail and skinned meshes
+		Scene const& instance(Scene& scene, Scene const& source);
 		void draw(Scene const& scene, OnDrawT onDraw, float timeScale = 1.0f);
 		void draw(Scene const& scene, float timeScale = 1.0f);
 		void pause(Scene const& scene) {}
 		void restart(Scene const& scene);
 		float sceneTime(Scene const& scene);
+		void animationLod(Scene const& scene, AnimationLod const& lod);
+		void invalidate(Scene const& scene);
 
 		void ppBloom(float strength, unsigned threshold = 0, unsigned srcModifier = 0, unsigned dstModifier = 255, unsigned quality = 3);
 		void blink() {}
@@ -117,6 +123,8 @@ namespace mutalisk
 		std::list<QueueItem> m_texQueue;
 		SceUID			m_currentLoad;
 		data::MtxHeader*m_currentTexture;
+		unsigned		m_currentSize;
+		unsigned		m_currentStartTime;
 		RenderableScene::SharedResources::Texture*		m_currentResource;
 #endif
 
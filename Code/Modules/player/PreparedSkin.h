@@ -0,0 +1,38 @@
+#ifndef MUTALISK__PREPARED_SKIN_H_
+#define MUTALISK__PREPARED_SKIN_H_
+
+#include "cfg.h"
+#include <vector>
+#include "Transform.h"
+
+namespace mutalisk
+{
+	// Skin data rearranged once when the mesh is prepared, so that per frame
+	// skinning neither inverts bind matrices nor tests weights:
+	//	- inverse bind matrices of all skin_info bones
+	//	- weights below the prune threshold dropped, the rest renormalized to 1
+	//	  and stored strongest first
+	//	- vertices grouped by the number of influences left, each group runs a
+	//	  loop specialized for its count; vertices left without any are skinned
+	//	  to the origin
+	// Vertex data is not reordered, groups hold indices into it.
+	struct PreparedSkin
+	{
+		struct Group
+		{
+			unsigned					influences;
+			std::vector<unsigned>		vertices;
+			std::vector<unsigned char>	boneIds;		// influences per vertex
+			std::vector<float>			weights;		// influences per vertex, sum of 1
+		};
+
+		PreparedSkin() : prunedWeights(0) {}
+		bool empty() const { return groups.empty(); }
+
+		std::vector<CTransform::t_matrix>	inverseBindMatrices;	// by skin_info bone
+		std::vector<Group>					groups;					// by increasing influences from 0, no empty ones
+		unsigned							prunedWeights;
+	};
+}
+
+#endif // MUTALISK__PREPARED_SKIN_H_
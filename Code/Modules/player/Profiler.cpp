@@ -0,0 +1,268 @@
+#include "Profiler.h"
+
+#if defined(MUTALISK_PROFILER)
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(__psp__)
+#	include <pspkernel.h>
+#elif defined(WIN32)
+#	include <windows.h>
+#else
+#	include <pthread.h>
+#	include <time.h>
+#endif
+
+using namespace mutalisk;
+using namespace mutalisk::profiler;
+
+namespace
+{
+	enum { MaxThreads = 8 };
+
+	// the registry lock is only taken when a thread records its first zone
+	struct Registry
+	{
+		ThreadBuffer*	buffers[MaxThreads];
+		unsigned		count;
+		unsigned		nextThreadId;
+#if defined(__psp__)
+		SceUID			lock;
+		Registry() : count(0), nextThreadId(1) { lock = sceKernelCreateSema("profiler", 0, 1, 1, 0); }
+		void enter() { sceKernelWaitSema(lock, 1, 0); }
+		void leave() { sceKernelSignalSema(lock, 1); }
+#elif defined(WIN32)
+		CRITICAL_SECTION lock;
+		Registry() : count(0), nextThreadId(1) { InitializeCriticalSection(&lock); }
+		void enter() { EnterCriticalSection(&lock); }
+		void leave() { LeaveCriticalSection(&lock); }
+#else
+		pthread_mutex_t	lock;
+		Registry() : count(0), nextThreadId(1) { pthread_mutex_init(&lock, 0); }
+		void enter() { pthread_mutex_lock(&lock); }
+		void leave() { pthread_mutex_unlock(&lock); }
+#endif
+	};
+
+	Registry& registry()
+	{
+		static Registry r;
+		return r;
+	}
+
+	unsigned currentThreadId()
+	{
+#if defined(__psp__)
+		return static_cast<unsigned>(sceKernelGetThreadId());
+#elif defined(WIN32)
+		return static_cast<unsigned>(GetCurrentThreadId());
+#else
+		return 0;	// not needed, the buffer pointer is thread local
+#endif
+	}
+
+	ThreadBuffer* createBuffer(unsigned threadId)
+	{
+		Registry& r = registry();
+		r.enter();
+		ThreadBuffer* buffer = 0;
+		if(r.count < MaxThreads)
+		{
+			buffer = new ThreadBuffer;
+			buffer->next = 0;
+			buffer->threadId = threadId? threadId: r.nextThreadId++;
+			buffer->threadName = 0;
+			r.buffers[r.count++] = buffer;
+		}
+		r.leave();
+
+		// threads past MaxThreads share a buffer that is never exported
+		static ThreadBuffer* overflow = 0;
+		if(!buffer)
+		{
+			if(!overflow)
+				overflow = new ThreadBuffer;
+			buffer = overflow;
+		}
+		return buffer;
+	}
+
+#if (defined(__GNUC__) && !defined(__psp__)) || defined(_MSC_VER)
+#	if defined(_MSC_VER)
+	__declspec(thread) ThreadBuffer* tCurrent = 0;
+#	else
+	__thread ThreadBuffer* tCurrent = 0;
+#	endif
+
+	inline ThreadBuffer& findBuffer()
+	{
+		if(!tCurrent)
+			tCurrent = createBuffer(currentThreadId());
+		return *tCurrent;
+	}
+#else
+	// no thread local storage, buffers are looked up by thread id; the table
+	// only grows and a handful of threads record zones
+	inline ThreadBuffer& findBuffer()
+	{
+		Registry& r = registry();
+		unsigned threadId = currentThreadId();
+		for(unsigned q = 0; q < r.count; ++q)
+			if(r.buffers[q]->threadId == threadId)
+				return *r.buffers[q];
+		return *createBuffer(threadId);
+	}
+#endif
+}
+
+////////////////////////////////////////////////
+TicksT profiler::now()
+{
+#if defined(__psp__)
+	return static_cast<TicksT>(sceKernelGetSystemTimeWide());
+#elif defined(WIN32)
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return static_cast<TicksT>(counter.QuadPart);
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	// the time stamp counter is constant rate on current x86, and a fraction
+	// of the cost of clock_gettime
+	return static_cast<TicksT>(__builtin_ia32_rdtsc());
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<TicksT>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+TicksT profiler::ticksPerSecond()
+{
+#if defined(__psp__)
+	return 1000000ULL;
+#elif defined(WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<TicksT>(frequency.QuadPart);
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	// measured once against the monotonic clock
+	static TicksT frequency = 0;
+	if(!frequency)
+	{
+		timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		TicksT ticks = now();
+		timespec pause = { 0, 20000000 };
+		nanosleep(&pause, 0);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		ticks = now() - ticks;
+		double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+		frequency = static_cast<TicksT>(ticks / seconds);
+	}
+	return frequency;
+#else
+	return 1000000000ULL;
+#endif
+}
+
+ThreadBuffer& profiler::threadBuffer()
+{
+	return findBuffer();
+}
+
+void profiler::setThreadName(char const* name)
+{
+	threadBuffer().threadName = name;
+}
+
+void profiler::reset()
+{
+	Registry& r = registry();
+	r.enter();
+	for(unsigned q = 0; q < r.count; ++q)
+		r.buffers[q]->next = 0;
+	r.leave();
+}
+
+namespace
+{
+	// event names are literals from the source, only quotes and backslashes
+	// need escaping
+	void writeString(FILE* f, char const* s)
+	{
+		fputc('"', f);
+		for(; *s; ++s)
+		{
+			if(*s == '"' || *s == '\\')
+				fputc('\\', f);
+			fputc(*s, f);
+		}
+		fputc('"', f);
+	}
+
+	// parents before their children, which may start on the same tick
+	bool earlierBegin(Event const& a, Event const& b)
+	{
+		return (a.begin != b.begin)? a.begin < b.begin: a.end > b.end;
+	}
+}
+
+bool profiler::writeChromeTrace(char const* path)
+{
+	FILE* f = fopen(path, "w");
+	if(!f)
+		return false;
+
+	Registry& r = registry();
+	r.enter();
+
+	// timestamps are written relative to the first event, in microseconds
+	TicksT origin = ~0ULL;
+	for(unsigned q = 0; q < r.count; ++q)
+	{
+		ThreadBuffer const& b = *r.buffers[q];
+		unsigned first = (b.next > ThreadBuffer::Capacity)? b.next - ThreadBuffer::Capacity: 0;
+		for(unsigned e = first; e < b.next; ++e)
+			origin = std::min(origin, b.events[e & ThreadBuffer::Mask].begin);
+	}
+	double const toMicroseconds = 1e6 / static_cast<double>(ticksPerSecond());
+
+	fprintf(f, "{\"traceEvents\":[\n");
+	bool firstLine = true;
+	std::vector<Event> events;
+	for(unsigned q = 0; q < r.count; ++q)
+	{
+		ThreadBuffer const& b = *r.buffers[q];
+		if(b.threadName)
+		{
+			fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", firstLine? "": ",\n", b.threadId);
+			writeString(f, b.threadName);
+			fprintf(f, "}}");
+			firstLine = false;
+		}
+
+		// oldest first, so viewers get the events of a thread in order
+		unsigned first = (b.next > ThreadBuffer::Capacity)? b.next - ThreadBuffer::Capacity: 0;
+		events.resize(0);
+		for(unsigned e = first; e < b.next; ++e)
+			events.push_back(b.events[e & ThreadBuffer::Mask]);
+		std::sort(events.begin(), events.end(), earlierBegin);
+
+		for(size_t e = 0; e < events.size(); ++e)
+		{
+			fprintf(f, "%s{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", firstLine? "": ",\n",
+				b.threadId, (events[e].begin - origin) * toMicroseconds, (events[e].end - events[e].begin) * toMicroseconds);
+			writeString(f, events[e].name);
+			fprintf(f, "}");
+			firstLine = false;
+		}
+	}
+	fprintf(f, "\n]}\n");
+
+	r.leave();
+	return fclose(f) == 0;
+}
+
+#endif // MUTALISK_PROFILER
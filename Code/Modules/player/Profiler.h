@@ -0,0 +1,96 @@
+#ifndef MUTALISK__PROFILER_H_
+#define MUTALISK__PROFILER_H_
+
+// Scoped zone profiler, built only when MUTALISK_PROFILER is defined:
+//
+//	void BaseDemoPlayer::draw(...)
+//	{
+//		MUTALISK_PROFILE_ZONE("draw");
+//		...
+//	}
+//
+// A zone takes a timestamp when it opens and appends one complete event to
+// the ring buffer of its thread when it closes, so nesting is implied by the
+// timestamps. Buffers are owned by their thread and written without locks;
+// the oldest events are overwritten when a buffer is full. Zone names must
+// be string literals or otherwise outlive the profiler.
+//
+// Without MUTALISK_PROFILER the macros expand to nothing.
+
+#if defined(MUTALISK_PROFILER)
+
+#include "cfg.h"
+
+#ifndef MUTALISK_PROFILER_EVENTS
+#define MUTALISK_PROFILER_EVENTS 4096		// per thread, power of two
+#endif
+
+namespace mutalisk { namespace profiler
+{
+	typedef unsigned long long TicksT;
+
+	struct Event
+	{
+		char const*	name;
+		TicksT		begin;
+		TicksT		end;
+	};
+
+	struct ThreadBuffer
+	{
+		enum { Capacity = MUTALISK_PROFILER_EVENTS, Mask = Capacity - 1 };
+
+		Event		events[Capacity];
+		unsigned	next;			// total events written, wraps into events by Mask
+		unsigned	threadId;
+		char const*	threadName;
+
+		void push(char const* name, TicksT begin, TicksT end)
+		{
+			Event& e = events[next & Mask];
+			e.name = name;
+			e.begin = begin;
+			e.end = end;
+			++next;
+		}
+	};
+
+	// platform timer, ticksPerSecond() converts it
+	TicksT now();
+	TicksT ticksPerSecond();
+
+	// buffer of the calling thread, created on first use
+	ThreadBuffer& threadBuffer();
+	void setThreadName(char const* name);
+
+	// drops all recorded events
+	void reset();
+	// Chrome trace event JSON (chrome://tracing, Perfetto); call it while the
+	// other profiled threads are idle, buffers are read without locks
+	bool writeChromeTrace(char const* path);
+
+	class Zone
+	{
+	public:
+		Zone(char const* name) : mName(name), mBegin(now()) {}
+		~Zone() { threadBuffer().push(mName, mBegin, now()); }
+
+	private:
+		char const*	mName;
+		TicksT		mBegin;
+	};
+}}
+
+#define MUTALISK_PROFILE_CONCAT2(a, b) a##b
+#define MUTALISK_PROFILE_CONCAT(a, b) MUTALISK_PROFILE_CONCAT2(a, b)
+#define MUTALISK_PROFILE_ZONE(name) mutalisk::profiler::Zone MUTALISK_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define MUTALISK_PROFILE_THREAD(name) mutalisk::profiler::setThreadName(name)
+
+#else
+
+#define MUTALISK_PROFILE_ZONE(name) do {} while(0)
+#define MUTALISK_PROFILE_THREAD(name) do {} while(0)
+
+#endif
+
+#endif // MUTALISK__PROFILER_H_
@@ -76,10 +76,50 @@ struct blastInstanceInputs
 	void gatherInstanceLights() { /* @TBD:*/ }
 };
 
+// native surface inputs of a scene instance kept between frames and freed
+// with it, see RenderableScene::mRendererState; an actor's materials
+// are converted again only when RenderableScene::mMaterialVersions changes.
+// Texture pointers are resolved every frame since textures are (un)loaded
+// independently of the materials
+struct SurfaceCache : RendererState
+{
+	struct Stats
+	{
+		Stats() : frames(0), conversions(0), reuses(0), time(0) {}
+		unsigned frames;
+		unsigned conversions;		// materials converted with toNative
+		unsigned reuses;			// materials served from the cache
+		unsigned time;				// microseconds, measured by the platform renderer
+	};
+
+	struct Actor
+	{
+		Actor() : version(0) {}
+		unsigned								version;	// 0 = never converted
+		std::vector<BaseEffect::Input::Surface>	surfaces;
+	};
+
+	std::vector<Actor>	actors;
+	Stats				stats;
+
+	// the cache of this instance, instances sharing materials convert them
+	// each on their own
+	static SurfaceCache& get(RenderableSceneT const& scene)
+	{
+		if(!scene.mRendererState.get())
+			scene.mRendererState.reset(new SurfaceCache);
+		SurfaceCache& cache = static_cast<SurfaceCache&>(*scene.mRendererState);
+		if(cache.actors.size() != scene.mBlueprint.actors.size())
+			cache.actors.assign(scene.mBlueprint.actors.size(), Actor());
+		return cache;
+	}
+};
+
 struct blastSurfaceInputs
 {
 	RenderableSceneT const& scene;
-	blastSurfaceInputs(RenderableSceneT const& scene_, int) : scene(scene_) {}
+	SurfaceCache& cache;
+	blastSurfaceInputs(RenderableSceneT const& scene_, int) : scene(scene_), cache(SurfaceCache::get(scene_)) {}
 
 	template <typename Container, typename Out>
 	void operator()(Container& c, Out& o) { operator()(c.begin(), c.end(), o); }
@@ -95,13 +135,29 @@ struct blastSurfaceInputs
 			mutalisk::data::scene::Actor const& actor = **first;
 
 			ASSERT(!actor.materials.empty());
+			size_t actorIndex = &actor - &scene.mBlueprint.actors[0];
+			ASSERT(actorIndex < cache.actors.size());
+			SurfaceCache::Actor& cached = cache.actors[actorIndex];
+			if(cached.version != scene.mMaterialVersions[actorIndex])
+			{
+				cached.surfaces.resize(actor.materials.size());
+				for(unsigned q = 0; q < actor.materials.size(); ++q)
+					toNative(cached.surfaces[q], scene, actor.materials[q].shaderInput);
+				cached.version = scene.mMaterialVersions[actorIndex];
+				cache.stats.conversions += actor.materials.size();
+			}
+			else
+				cache.stats.reuses += actor.materials.size();
+
 			surfaceInputs.resize(surfaceInputs.size() + actor.materials.size());
 			for(unsigned q = 0; q < actor.materials.size(); ++q, ++block)
 			{
 				BaseEffect::Input::Surface& surfaceInput = surfaceInputs[block];
-				toNative(surfaceInput, scene, actor.materials[q].shaderInput);
+				surfaceInput = cached.surfaces[q];
+				toNativeTextures(surfaceInput, scene, actor.materials[q].shaderInput);
 			}
 		}
+		++cache.stats.frames;
 	}
 };
 
@@ -129,7 +185,7 @@ struct blastRenderBlocks
 			ASSERT(*first);
 			mutalisk::data::scene::Actor const& actor = **first;
 
-			RenderableMesh const* mesh = this->scene.mResources.meshes[actor.meshIndex].renderable.get();
+			RenderableMesh const* mesh = this->scene.renderableMesh(actor.meshIndex);
 			float cameraDistanceSq = calcCameraDistanceSq(
 				this->scene.mState.matrices[this->scene.mState.actor2XformIndex[actor.id]].Move);
 
@@ -227,6 +283,43 @@ struct sortRenderBlocks
 	}
 };
 
+// blocks of a pass keyed again by distance to another camera, e.g. the
+// reflected one of a mirror pass; insertion puts them back in order, which is
+// close to linear for lists sorted for a nearby camera and keeps the order of
+// equal keys
+struct rekeyRenderBlocks
+{
+	Vec3 cameraPos;
+	Vec3 const* instancePositions;
+
+	rekeyRenderBlocks(Vec3 cameraPos_, Vec3 const* instancePositions_) : cameraPos(cameraPos_), instancePositions(instancePositions_) {}
+
+	template <typename Container>
+	void operator()(Container& c) { operator()(c.begin(), c.end()); }
+
+	template <typename In>
+	void operator()(In first, In last)
+	{
+		typedef typename In::value_type T;
+		for(In it = first; it != last; ++it)
+		{
+			Vec3 d;
+			Vec3_sub(&d, &this->cameraPos, const_cast<Vec3*>(&this->instancePositions[it->instanceIndex]));
+			it->cameraDistanceSq = Vec3_dot(&d, &d);
+		}
+
+		sortRenderBlocks::BackToFront<T> less;
+		for(In it = first; it != last; ++it)
+		{
+			T block = *it;
+			In hole = it;
+			for(; hole != first && less(block, *(hole - 1)); --hole)
+				*hole = *(hole - 1);
+			*hole = block;
+		}
+	}
+};
+
 struct drawRenderBlocks
 {
 	RenderContextT& rc;
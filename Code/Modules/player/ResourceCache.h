@@ -0,0 +1,152 @@
+#ifndef MUTALISK__RESOURCECACHE_H_
+#define MUTALISK__RESOURCECACHE_H_
+
+#include "cfg.h"
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace mutalisk
+{
+	// FNV-1a over raw resource data; static as well, Base/Common/Config.h
+	// defines inline away on the PSP
+	static inline unsigned contentHash(void const* data, size_t size, unsigned hash = 2166136261U)
+	{
+		unsigned char const* bytes = static_cast<unsigned char const*>(data);
+		for(size_t q = 0; q < size; ++q)
+			hash = (hash ^ bytes[q]) * 16777619U;
+		return hash;
+	}
+
+	// reference counted resource handle, mimics std::auto_ptr interface
+	// so that it can replace it in RenderableScene::SharedResources
+	template <typename T>
+	class SharedRef
+	{
+	public:
+		typedef void (*OnFreeT)(T*);
+
+		SharedRef() : mNode(0) {}
+		explicit SharedRef(std::auto_ptr<T> object) : mNode(0) { reset(object.release()); }
+		SharedRef(SharedRef const& r) : mNode(r.mNode) { if(mNode) ++mNode->refCount; }
+		~SharedRef() { release(); }
+
+		SharedRef& operator= (SharedRef const& r)
+		{
+			if(r.mNode)
+				++r.mNode->refCount;
+			release();
+			mNode = r.mNode;
+			return *this;
+		}
+		SharedRef& operator= (std::auto_ptr<T> object) { reset(object.release()); return *this; }
+
+		void reset(T* object = 0, OnFreeT onFree = 0)
+		{
+			release();
+			if(!object)
+				return;
+			mNode = new Node;
+			mNode->object = object;
+			mNode->refCount = 1;
+			mNode->onFree = onFree;
+		}
+
+		T* get() const { return (mNode)? mNode->object: 0; }
+		T& operator*() const { ASSERT(get()); return *get(); }
+		T* operator->() const { ASSERT(get()); return get(); }
+		unsigned refCount() const { return (mNode)? mNode->refCount: 0; }
+
+	private:
+		template <typename U> friend class ResourceCache;
+		struct Node
+		{
+			T*			object;
+			unsigned	refCount;
+			OnFreeT		onFree;
+		};
+		explicit SharedRef(Node* node) : mNode(node) { if(mNode) ++mNode->refCount; }
+
+		void release()
+		{
+			if(mNode && --mNode->refCount == 0)
+			{
+				if(mNode->onFree)
+					mNode->onFree(mNode->object);
+				delete mNode->object;
+				delete mNode;
+			}
+			mNode = 0;
+		}
+
+		Node*		mNode;
+	};
+
+	// global cache of resources shared between scenes, keyed by content
+	// the cache does not own resources, they are freed with the last SharedRef
+	template <typename T>
+	class ResourceCache
+	{
+	public:
+		struct Stats
+		{
+			Stats() : requests(0), hits(0), loadedBytes(0), dedupBytes(0), loadTime(0) {}
+			unsigned	requests;
+			unsigned	hits;
+			unsigned	loadedBytes;
+			unsigned	dedupBytes;
+			unsigned	loadTime;		// microseconds
+		};
+
+		static ResourceCache& getInstance()
+		{
+			static ResourceCache instance;
+			return instance;
+		}
+
+		SharedRef<T> find(unsigned hash, unsigned size)
+		{
+			++mStats.requests;
+			typename EntriesT::iterator i = mEntries.find(std::make_pair(hash, size));
+			if(i == mEntries.end())
+				return SharedRef<T>();
+
+			++mStats.hits;
+			mStats.dedupBytes += size;
+			return SharedRef<T>(i->second);
+		}
+
+		SharedRef<T> insert(unsigned hash, unsigned size, std::auto_ptr<T> object)
+		{
+			SharedRef<T> result;
+			result.reset(object.release(), &ResourceCache::onFree);
+			mEntries[std::make_pair(hash, size)] = result.mNode;
+			mStats.loadedBytes += size;
+			return result;
+		}
+
+		void addLoadTime(unsigned microseconds) { mStats.loadTime += microseconds; }
+		Stats const& stats() const { return mStats; }
+		size_t size() const { return mEntries.size(); }
+
+	private:
+		typedef std::map<std::pair<unsigned, unsigned>, typename SharedRef<T>::Node*> EntriesT;
+
+		static void onFree(T* object)
+		{
+			EntriesT& entries = getInstance().mEntries;
+			for(typename EntriesT::iterator i = entries.begin(); i != entries.end(); ++i)
+				if(i->second->object == object)
+				{
+					entries.erase(i);
+					return;
+				}
+		}
+
+		EntriesT	mEntries;
+		Stats		mStats;
+	};
+
+} // namespace mutalisk
+
+#endif // MUTALISK__RESOURCECACHE_H_
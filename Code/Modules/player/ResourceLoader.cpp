@@ -0,0 +1,266 @@
+#include "ResourceLoader.h"
+
+#include <stdio.h>
+#include <deque>
+#include <mutant/binary_memory_input.h>
+
+#if defined(MUTALISK_LOADER_PSP_THREADS)
+#	include <pspkernel.h>
+#	include <pspiofilemgr.h>
+#	include <pspthreadman.h>
+#else
+#	include <pthread.h>
+#endif
+
+namespace mutalisk
+{
+////////////////////////////////////////////////
+struct ResourceLoader::Queue
+{
+	std::deque<Job*>	jobs;
+	bool				quit;
+#if defined(MUTALISK_LOADER_PSP_THREADS)
+	SceUID				lock;
+	SceUID				queued;		// counts jobs added and quit requests
+	SceUID				done;		// signalled once per finished job
+	SceUID				threads[MaxWorkers];
+
+	Queue() : quit(false)
+	{
+		lock = sceKernelCreateSema("loader", 0, 1, 1, 0);
+		queued = sceKernelCreateSema("loader queued", 0, 0, 0x7fffffff, 0);
+		done = sceKernelCreateSema("loader done", 0, 0, 0x7fffffff, 0);
+	}
+	~Queue()
+	{
+		sceKernelDeleteSema(done);
+		sceKernelDeleteSema(queued);
+		sceKernelDeleteSema(lock);
+	}
+	void enter() { sceKernelWaitSema(lock, 1, 0); }
+	void leave() { sceKernelSignalSema(lock, 1); }
+	void signalQueued() { sceKernelSignalSema(queued, 1); }
+	void waitQueued() { leave(); sceKernelWaitSema(queued, 1, 0); enter(); }
+	void signalDone() { sceKernelSignalSema(done, 1); }
+	void waitDone() { leave(); sceKernelWaitSema(done, 1, 0); enter(); }
+
+	static int entry(SceSize args, void* argp)
+	{
+		ResourceLoader::work(**static_cast<Queue**>(argp));
+		return 0;
+	}
+	bool start(unsigned index)
+	{
+		// same priority as the caller: threads of equal priority are not time
+		// sliced, a parsing worker runs until it blocks on I/O
+		threads[index] = sceKernelCreateThread("loader", entry, sceKernelGetThreadCurrentPriority(), 0x10000, PSP_THREAD_ATTR_USER, 0);
+		if(threads[index] < 0)
+			return false;
+		Queue* self = this;
+		sceKernelStartThread(threads[index], sizeof(self), &self);
+		return true;
+	}
+	void join(unsigned index)
+	{
+		sceKernelWaitThreadEnd(threads[index], 0);
+		sceKernelDeleteThread(threads[index]);
+	}
+#else
+	pthread_mutex_t		lock;
+	pthread_cond_t		queued;
+	pthread_cond_t		done;
+	pthread_t			threads[MaxWorkers];
+
+	Queue() : quit(false)
+	{
+		pthread_mutex_init(&lock, 0);
+		pthread_cond_init(&queued, 0);
+		pthread_cond_init(&done, 0);
+	}
+	~Queue()
+	{
+		pthread_cond_destroy(&done);
+		pthread_cond_destroy(&queued);
+		pthread_mutex_destroy(&lock);
+	}
+	void enter() { pthread_mutex_lock(&lock); }
+	void leave() { pthread_mutex_unlock(&lock); }
+	void signalQueued() { pthread_cond_signal(&queued); }
+	void waitQueued() { pthread_cond_wait(&queued, &lock); }
+	void signalDone() { pthread_cond_broadcast(&done); }
+	void waitDone() { pthread_cond_wait(&done, &lock); }
+
+	static void* entry(void* arg)
+	{
+		ResourceLoader::work(*static_cast<Queue*>(arg));
+		return 0;
+	}
+	bool start(unsigned index)
+	{
+		return pthread_create(&threads[index], 0, entry, this) == 0;
+	}
+	void join(unsigned index)
+	{
+		pthread_join(threads[index], 0);
+	}
+#endif
+};
+
+ResourceLoader::ResourceLoader(unsigned workers)
+:	mQueue(0)
+,	mWorkerCount(0)
+{
+	if(workers > MaxWorkers)
+		workers = MaxWorkers;
+	if(!workers)
+		return;
+
+	mQueue = new Queue;
+	while(mWorkerCount < workers && mQueue->start(mWorkerCount))
+		++mWorkerCount;
+	if(!mWorkerCount)
+	{
+		printf("ResourceLoader: unable to start workers, loading serially\n");
+		delete mQueue;
+		mQueue = 0;
+	}
+}
+
+ResourceLoader::~ResourceLoader()
+{
+	if(!mQueue)
+		return;
+
+	// workers drain the queue before they see quit
+	mQueue->enter();
+	mQueue->quit = true;
+	mQueue->leave();
+	for(unsigned q = 0; q < mWorkerCount; ++q)
+		mQueue->signalQueued();
+	for(unsigned q = 0; q < mWorkerCount; ++q)
+		mQueue->join(q);
+	delete mQueue;
+}
+
+void ResourceLoader::add(Job& job)
+{
+	job.mDone = false;
+	if(!mQueue)
+	{
+		job.run();
+		job.mDone = true;
+		return;
+	}
+
+	mQueue->enter();
+	mQueue->jobs.push_back(&job);
+	mQueue->leave();
+	mQueue->signalQueued();
+}
+
+void ResourceLoader::wait(Job& job)
+{
+	if(!mQueue)
+	{
+		ASSERT(job.mDone);
+		return;
+	}
+
+	mQueue->enter();
+	while(!job.mDone)
+		mQueue->waitDone();
+	mQueue->leave();
+}
+
+void ResourceLoader::work(Queue& queue)
+{
+	queue.enter();
+	for(;;)
+	{
+#if defined(MUTALISK_LOADER_PSP_THREADS)
+		// every job and every quit request counts once on the semaphore
+		queue.waitQueued();
+#else
+		while(queue.jobs.empty() && !queue.quit)
+			queue.waitQueued();
+#endif
+		if(queue.jobs.empty())
+		{
+			if(queue.quit)
+				break;
+			continue;
+		}
+
+		Job* job = queue.jobs.front();
+		queue.jobs.pop_front();
+		queue.leave();
+
+		job->run();
+
+		queue.enter();
+		job->mDone = true;
+		queue.signalDone();
+	}
+	queue.leave();
+}
+
+////////////////////////////////////////////////
+void* readFile(std::string const& fullName, unsigned& size, unsigned extra)
+{
+	size = 0;
+#if defined(MUTALISK_LOADER_PSP_THREADS)
+	SceUID fd = sceIoOpen(fullName.c_str(), PSP_O_RDONLY, 0777);
+	if(fd < 0)
+	{
+		printf("unable to find file %s\n", fullName.c_str());
+		return 0;
+	}
+
+	SceOff end = sceIoLseek(fd, 0, PSP_SEEK_END);
+	void* data = (end >= 0 && sceIoLseek(fd, 0, PSP_SEEK_SET) == 0)? malloc(static_cast<unsigned>(end) + extra): 0;
+	if(data && sceIoRead(fd, data, static_cast<unsigned>(end)) != static_cast<int>(end))
+	{
+		free(data);
+		data = 0;
+	}
+	sceIoClose(fd);
+#else
+	FILE* file = fopen(fullName.c_str(), "rb");
+	if(!file)
+	{
+		printf("unable to find file %s\n", fullName.c_str());
+		return 0;
+	}
+
+	long end = (fseek(file, 0, SEEK_END) == 0)? ftell(file): -1;
+	void* data = (end >= 0 && fseek(file, 0, SEEK_SET) == 0)? malloc(static_cast<unsigned>(end) + extra): 0;
+	if(data && fread(data, 1, static_cast<size_t>(end), file) != static_cast<size_t>(end))
+	{
+		free(data);
+		data = 0;
+	}
+	fclose(file);
+#endif
+	if(!data)
+	{
+		printf("unable to read file %s\n", fullName.c_str());
+		return 0;
+	}
+	size = static_cast<unsigned>(end);
+	return data;
+}
+
+std::auto_ptr<mutant::mutant_reader> createMemoryReader(void const* data, unsigned size, std::string const& name)
+{
+	std::auto_ptr<mutant::binary_input> input(new mutant::memory_input(data, static_cast<int>(size)));
+	std::auto_ptr<mutant::mutant_reader> reader(new mutant::mutant_reader(mutant::reader_factory::createInput(input, name)));
+	reader->enableLog(false);
+	return reader;
+}
+
+void readResource(mutant::mutant_reader& reader, mutant::anim_character_set& resource)
+{
+	reader.read(resource);
+}
+
+} // namespace mutalisk
@@ -0,0 +1,118 @@
+#ifndef MUTALISK__RESOURCE_LOADER_H_
+#define MUTALISK__RESOURCE_LOADER_H_
+
+#include "cfg.h"
+#include <memory>
+#include <string>
+#include <stdlib.h>
+#include <mutant/mutant.h>
+#include <mutant/io_factory.h>
+#include <mutant/reader.h>
+
+// host tools build the psp data headers with __psp__ and stub SDK headers,
+// MUTALISK_HOST_THREADS gives them pthreads and stdio instead
+#if defined(__psp__) && !defined(MUTALISK_HOST_THREADS)
+#	define MUTALISK_LOADER_PSP_THREADS
+#endif
+
+#ifndef MUTALISK_LOADER_WORKERS
+#	if defined(MUTALISK_LOADER_PSP_THREADS)
+		// one thread waits on the memory stick while the other parses, a
+		// single core gains nothing from more
+#		define MUTALISK_LOADER_WORKERS 2
+#	else
+#		define MUTALISK_LOADER_WORKERS 4
+#	endif
+#endif
+
+namespace mutalisk
+{
+	// Runs the resource loads of a scene on a pool of worker threads, so that
+	// reading one file overlaps decompressing and parsing others:
+	//
+	//	LoadJob<data::mesh> job(fullName);
+	//	loader.add(job);				// starts on the first idle worker
+	//	...
+	//	loader.wait(job);				// job.resource is parsed now
+	//
+	// Jobs start in the order they were added. Callers wait for them in that
+	// order too and publish the results themselves, caches and scenes then see
+	// resources in the same order as a serial load. Jobs must not touch shared
+	// state. Without workers add() runs the job at once, the serial path.
+	class ResourceLoader
+	{
+	public:
+		enum { MaxWorkers = 8 };
+
+		class Job
+		{
+		public:
+			Job() : mDone(false) {}
+			virtual ~Job() {}
+			virtual void run() = 0;
+
+		private:
+			friend class ResourceLoader;
+			bool	mDone;
+		};
+
+		explicit ResourceLoader(unsigned workers = MUTALISK_LOADER_WORKERS);
+		// waits for the jobs added
+		~ResourceLoader();
+
+		unsigned workers() const { return mWorkerCount; }
+
+		// the job is not owned and must live until wait() returns for it
+		void add(Job& job);
+		void wait(Job& job);
+
+	private:
+		struct Queue;
+		static void work(Queue& queue);
+
+		Queue*		mQueue;
+		unsigned	mWorkerCount;
+
+		ResourceLoader(ResourceLoader const&);
+		ResourceLoader& operator= (ResourceLoader const&);
+	};
+
+	// whole file into malloc'ed memory with extra bytes left after it, 0 when
+	// the file cannot be opened or read in full; the caller frees it
+	void* readFile(std::string const& fullName, unsigned& size, unsigned extra = 0);
+
+	// mutant reader over a file read to memory, the memory must outlive it
+	std::auto_ptr<mutant::mutant_reader> createMemoryReader(void const* data, unsigned size, std::string const& name);
+
+	void readResource(mutant::mutant_reader& reader, mutant::anim_character_set& resource);
+	template <typename ResourceType>
+	inline void readResource(mutant::mutant_reader& reader, ResourceType& resource) { reader >> resource; }
+
+	// reads and parses one mutant file on a worker
+	template <typename ResourceType>
+	class LoadJob : public ResourceLoader::Job
+	{
+	public:
+		explicit LoadJob(std::string const& fullName) : fullName(fullName) {}
+
+		virtual void run()
+		{
+			unsigned size = 0;
+			void* data = readFile(fullName, size);
+			if(!data)
+				return;
+
+			{
+				std::auto_ptr<mutant::mutant_reader> reader = createMemoryReader(data, size, fullName);
+				resource.reset(new ResourceType);
+				readResource(*reader, *resource);
+			}
+			free(data);
+		}
+
+		std::string						fullName;
+		std::auto_ptr<ResourceType>		resource;		// 0 when the file is missing
+	};
+}
+
+#endif // MUTALISK__RESOURCE_LOADER_H_
@@ -2,6 +2,10 @@
 
 #include <mutant/mutant.h>
 
+extern "C" {
+	#include <Base/Math/LinInline.h>
+}
+
 namespace mutalisk {
 ////////////////////////////////////////////////
 std::string gResourcePath = "";
@@ -24,6 +28,14 @@ std::auto_ptr<mutant::mutant_reader> createFileReader(std::string const& fileNam
 	return mutReader;
 }
 
+bool gPreparedSkinning = true;
+
+unsigned nextMaterialVersion()
+{
+	static unsigned version = 0;
+	return ++version;
+}
+
 void setMatrix(CTransform::t_matrix& matrix, float const* matrixData)
 {
 	// new-age wants transposed matrix
@@ -38,7 +50,8 @@ void setMatrix(CTransform::t_matrix& matrix, float const* matrixData)
 void CSkinnedAlgos::processSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNormals, float const* srcWeights, unsigned char const* srcBoneIndices,
 	Vec3 *dstPositions, Vec3* dstNormals, size_t srcVertexStride, size_t srcWeightStride, size_t srcBoneIndexStride,
 	size_t dstVertexStride, size_t vertexCount,
-	mutalisk::data::skin_info const& skinInfo, BoneMapT const& boneMap, CTransform::t_matrix const* matrices)
+	mutalisk::data::skin_info const& skinInfo, BoneMapT const& boneMap, CTransform::t_matrix const* matrices,
+	unsigned maxInfluences)
 {		
 	static std::vector<CTransform::t_matrix> worldMatrices;
 	worldMatrices.resize( boneMap.size() );
@@ -79,6 +92,13 @@ void CSkinnedAlgos::processSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNor
 
 	unsigned char* dstPositionsRaw = reinterpret_cast<unsigned char*>(dstPositions);
 	unsigned char* dstNormalsRaw = reinterpret_cast<unsigned char*>(dstNormals);
+
+	// reduced influences go through a list of picked weights, all of them otherwise
+	enum { MaxWeights = 8 };
+	unsigned char picked[MaxWeights];
+	unsigned const keep = (maxInfluences < MaxWeights)? maxInfluences: MaxWeights;
+	bool const reduced = (keep > 0 && keep < skinInfo.weightsPerVertex);
+
 	for( size_t q = 0; q < vertexCount; ++q )
 	{
 		CTransform::t_vector pos3 = *reinterpret_cast<CTransform::t_vector const*>(srcPositionsRaw + q * srcVertexStride);
@@ -87,13 +107,28 @@ void CSkinnedAlgos::processSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNor
 		unsigned char const* boneIndices = srcBoneIndicesRaw + q * srcBoneIndexStride;
 		CTransform::t_vector accumP3( 0.0f, 0.0f, 0.0f ), accumN3( 0.0f, 0.0f, 0.0f );
 		float accumWeight = 0.0f;
+
+		size_t influences = skinInfo.weightsPerVertex;
+		float weightScale = 1.0f;
+		if( reduced )
+		{
+			// the dropped weight is spread over the kept ones
+			influences = strongestInfluences( weights, skinInfo.weightsPerVertex, keep, picked );
+			float total = 0.0f, kept = 0.0f;
+			for( size_t w = 0; w < skinInfo.weightsPerVertex; ++w )
+				total += weights[w];
+			for( size_t w = 0; w < influences; ++w )
+				kept += weights[picked[w]];
+			weightScale = (kept > 0.0f)? total / kept: 0.0f;
+		}
 		
-		for( size_t w = 0; w < skinInfo.weightsPerVertex; ++w )
+		for( size_t k = 0; k < influences; ++k )
 		{
+			size_t w = reduced? picked[k]: k;
 			unsigned char boneId = boneIndices[w];
 			ASSERT(boneId < worldMatrices.size());
 			ASSERT(boneId <= lastI);
-			float boneWeight = weights[w];
+			float boneWeight = weights[w] * weightScale;
 			accumWeight += boneWeight;
 
 			if(boneWeight < 0.001f)
@@ -121,4 +156,169 @@ void CSkinnedAlgos::processSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNor
 		dstNormals = reinterpret_cast<Vec3*>(dstNormalsRaw);
 	}
 }
+void CSkinnedAlgos::prepareSkin(PreparedSkin& skin, float const* srcWeights, unsigned char const* srcBoneIndices,
+	size_t srcWeightStride, size_t srcBoneIndexStride, size_t vertexCount,
+	mutalisk::data::skin_info const& skinInfo, float pruneThreshold)
+{
+	skin.inverseBindMatrices.resize( skinInfo.bones.size() );
+	for( size_t q = 0; q < skinInfo.bones.size(); ++q )
+	{
+		CTransform::t_matrix tm;
+		setMatrix(tm, skinInfo.bones[q].matrix.data);
+		Mat34_invertOrthogonal( &skin.inverseBindMatrices[q], &tm );
+	}
+
+	skin.groups.resize(0);
+	skin.prunedWeights = 0;
+	enum { MaxWeights = 8 };
+	ASSERT(skinInfo.weightsPerVertex <= MaxWeights);
+	unsigned const weightsPerVertex = (skinInfo.weightsPerVertex < MaxWeights)? skinInfo.weightsPerVertex: MaxWeights;
+	if( weightsPerVertex == 0 )
+		return;
+
+	// groups[n] collects the vertices left with n influences
+	std::vector<PreparedSkin::Group> groups( weightsPerVertex + 1 );
+	unsigned char const* srcWeightsRaw = reinterpret_cast<unsigned char const*>(srcWeights);
+	for( size_t q = 0; q < vertexCount; ++q )
+	{
+		float const* weights = reinterpret_cast<float const*>(srcWeightsRaw + q * srcWeightStride);
+		unsigned char const* boneIndices = srcBoneIndices + q * srcBoneIndexStride;
+
+		unsigned char picked[MaxWeights];
+		unsigned const count = strongestInfluences( weights, weightsPerVertex, weightsPerVertex, picked );
+		// without a weight above the threshold the vertex keeps no influence
+		// and is skinned to the origin, as the unprepared loop leaves it when
+		// all its weights are below 0.001
+		unsigned kept = (count > 0 && !(weights[picked[0]] < pruneThreshold))? 1: 0;
+		while( kept > 0 && kept < count && !(weights[picked[kept]] < pruneThreshold) )
+			++kept;
+		skin.prunedWeights += weightsPerVertex - kept;
+
+		float total = 0.0f;
+		for( unsigned w = 0; w < kept; ++w )
+			total += weights[picked[w]];
+		float const scale = (total > 0.0f)? 1.0f / total: 0.0f;
+
+		PreparedSkin::Group& group = groups[kept];
+		group.vertices.push_back( static_cast<unsigned>(q) );
+		for( unsigned w = 0; w < kept; ++w )
+		{
+			group.boneIds.push_back( boneIndices[picked[w]] );
+			// single influences stay exact, their loop does not weight at all
+			group.weights.push_back( (kept == 1 && total > 0.0f)? 1.0f: weights[picked[w]] * scale );
+		}
+	}
+
+	for( unsigned n = 0; n < groups.size(); ++n )
+		if( !groups[n].vertices.empty() )
+		{
+			groups[n].influences = n;
+			skin.groups.push_back( groups[n] );
+		}
+}
+
+namespace
+{
+	// the group of vertices without influences
+	void skinZeroGroup(PreparedSkin::Group const& group, unsigned char* dstPositions, unsigned char* dstNormals, size_t dstVertexStride)
+	{
+		Vec3 const zero = { 0.0f, 0.0f, 0.0f };
+		for( size_t q = 0; q < group.vertices.size(); ++q )
+		{
+			size_t const v = group.vertices[q];
+			*reinterpret_cast<Vec3*>(dstPositions + v * dstVertexStride) = zero;
+			*reinterpret_cast<Vec3*>(dstNormals + v * dstVertexStride) = zero;
+		}
+	}
+
+	// skins one group of PreparedSkin; Count is the number of influences used,
+	// 0 takes it from count at run time, the group may store more per vertex
+	template <unsigned Count>
+	void skinGroup(PreparedSkin::Group const& group, unsigned count, CTransform::t_matrix const* worldMatrices,
+		unsigned char const* srcPositions, unsigned char const* srcNormals, unsigned char* dstPositions, unsigned char* dstNormals,
+		size_t srcVertexStride, size_t dstVertexStride)
+	{
+		unsigned const n = Count? Count: count;
+		unsigned const stride = group.influences;
+		bool const renormalize = (n < stride);
+		size_t const vertexCount = group.vertices.size();
+		for( size_t q = 0; q < vertexCount; ++q )
+		{
+			size_t const v = group.vertices[q];
+			Vec3 const& pos3 = *reinterpret_cast<Vec3 const*>(srcPositions + v * srcVertexStride);
+			Vec3 const& nrm3 = *reinterpret_cast<Vec3 const*>(srcNormals + v * srcVertexStride);
+			Vec3& dstPos = *reinterpret_cast<Vec3*>(dstPositions + v * dstVertexStride);
+			Vec3& dstNrm = *reinterpret_cast<Vec3*>(dstNormals + v * dstVertexStride);
+			unsigned char const* boneIds = &group.boneIds[q * stride];
+			float const* weights = &group.weights[q * stride];
+
+			if( Count == 1 && !renormalize )
+			{
+				Mat34 const& m = worldMatrices[boneIds[0]];
+				Vec3_setMat34MulVec3Inline( &dstPos, &m, &pos3 );
+				Vec3 nrm = nrm3;
+				dstNrm.x = m.Rot.Row[0].x * nrm.x + m.Rot.Row[0].y * nrm.y + m.Rot.Row[0].z * nrm.z;
+				dstNrm.y = m.Rot.Row[1].x * nrm.x + m.Rot.Row[1].y * nrm.y + m.Rot.Row[1].z * nrm.z;
+				dstNrm.z = m.Rot.Row[2].x * nrm.x + m.Rot.Row[2].y * nrm.y + m.Rot.Row[2].z * nrm.z;
+				continue;
+			}
+
+			float scale = 1.0f;
+			if( renormalize )
+			{
+				float kept = 0.0f;
+				for( unsigned w = 0; w < n; ++w )
+					kept += weights[w];
+				scale = (kept > 0.0f)? 1.0f / kept: 0.0f;
+			}
+
+			float px = 0.0f, py = 0.0f, pz = 0.0f;
+			float nx = 0.0f, ny = 0.0f, nz = 0.0f;
+			for( unsigned w = 0; w < n; ++w )
+			{
+				Mat34 const& m = worldMatrices[boneIds[w]];
+				float const weight = weights[w] * scale;
+				Vec3 p;
+				Vec3_setMat34MulVec3Inline( &p, &m, &pos3 );
+				px += p.x * weight; py += p.y * weight; pz += p.z * weight;
+				nx += (m.Rot.Row[0].x * nrm3.x + m.Rot.Row[0].y * nrm3.y + m.Rot.Row[0].z * nrm3.z) * weight;
+				ny += (m.Rot.Row[1].x * nrm3.x + m.Rot.Row[1].y * nrm3.y + m.Rot.Row[1].z * nrm3.z) * weight;
+				nz += (m.Rot.Row[2].x * nrm3.x + m.Rot.Row[2].y * nrm3.y + m.Rot.Row[2].z * nrm3.z) * weight;
+			}
+			dstPos.x = px; dstPos.y = py; dstPos.z = pz;
+			dstNrm.x = nx; dstNrm.y = ny; dstNrm.z = nz;
+		}
+	}
+}
+
+void CSkinnedAlgos::processPreparedSkin(Vec3 const* srcPositions, Vec3 const* srcNormals, Vec3* dstPositions, Vec3* dstNormals,
+	size_t srcVertexStride, size_t dstVertexStride, PreparedSkin const& skin,
+	BoneMapT const& boneMap, CTransform::t_matrix const* matrices, unsigned maxInfluences)
+{
+	static std::vector<CTransform::t_matrix> worldMatrices;
+	worldMatrices.resize( boneMap.size() );
+	for( size_t i = 0; i < boneMap.size(); ++i )
+		Mat34_mulInline( &worldMatrices[i], &matrices[ boneMap[i].second ], &skin.inverseBindMatrices[ boneMap[i].first ] );
+
+	unsigned char const* srcPositionsRaw = reinterpret_cast<unsigned char const*>(srcPositions);
+	unsigned char const* srcNormalsRaw = reinterpret_cast<unsigned char const*>(srcNormals);
+	unsigned char* dstPositionsRaw = reinterpret_cast<unsigned char*>(dstPositions);
+	unsigned char* dstNormalsRaw = reinterpret_cast<unsigned char*>(dstNormals);
+	CTransform::t_matrix const* world = worldMatrices.empty()? 0: &worldMatrices[0];
+
+	for( size_t g = 0; g < skin.groups.size(); ++g )
+	{
+		PreparedSkin::Group const& group = skin.groups[g];
+		unsigned const n = (maxInfluences > 0 && maxInfluences < group.influences)? maxInfluences: group.influences;
+		switch( n )
+		{
+		case 0: skinZeroGroup( group, dstPositionsRaw, dstNormalsRaw, dstVertexStride ); break;
+		case 1: skinGroup<1>( group, n, world, srcPositionsRaw, srcNormalsRaw, dstPositionsRaw, dstNormalsRaw, srcVertexStride, dstVertexStride ); break;
+		case 2: skinGroup<2>( group, n, world, srcPositionsRaw, srcNormalsRaw, dstPositionsRaw, dstNormalsRaw, srcVertexStride, dstVertexStride ); break;
+		case 3: skinGroup<3>( group, n, world, srcPositionsRaw, srcNormalsRaw, dstPositionsRaw, dstNormalsRaw, srcVertexStride, dstVertexStride ); break;
+		case 4: skinGroup<4>( group, n, world, srcPositionsRaw, srcNormalsRaw, dstPositionsRaw, dstNormalsRaw, srcVertexStride, dstVertexStride ); break;
+		default: skinGroup<0>( group, n, world, srcPositionsRaw, srcNormalsRaw, dstPositionsRaw, dstNormalsRaw, srcVertexStride, dstVertexStride ); break;
+		}
+	}
+}
 } // namespace mutalisk
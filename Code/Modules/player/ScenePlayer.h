@@ -13,6 +13,9 @@
 
 #include "Animators.h"
 #include "AnimatorAlgos.h"
+#include "ResourceCache.h"
+#include "PreparedSkin.h"
+#include "Profiler.h"
 
 namespace mutalisk
 {
@@ -22,18 +25,96 @@ namespace mutalisk
 #endif
 void setMatrix(CTransform::t_matrix& matrix, float const* worldMatrixData);
 
+// material versions are unique across all scenes, 0 is never returned
+unsigned nextMaterialVersion();
+
+// assigns value and reports whether it differed, material writers use it to
+// decide whether RenderableScene::touchMaterials is needed
+template <typename T>
+inline bool setIfChanged(T& dst, T const& value)
+{
+	if(dst == value)
+		return false;
+	dst = value;
+	return true;
+}
+
+// Per instance animation level of detail. Below full rate keyframes are
+// evaluated every rate-th update only, the local transforms of animated
+// nodes are blended towards a pose evaluated ahead in between. A frozen
+// instance keeps its pose and skips hierarchy and skinning updates.
+struct AnimationLod
+{
+	enum { Frozen = 0, Full = 1 };
+
+	AnimationLod(unsigned rate_ = Full, unsigned maxInfluences_ = 0) : rate(rate_), maxInfluences(maxInfluences_) {}
+	bool operator==(AnimationLod const& rhs) const { return rate == rhs.rate && maxInfluences == rhs.maxInfluences; }
+
+	unsigned	rate;				// updates per keyframe evaluation, Frozen keeps the pose
+	unsigned	maxInfluences;		// strongest bone weights kept per skinned vertex, 0 keeps all
+};
+
+// skinned meshes go through their PreparedSkin, cleared only to measure
+// against the unprepared path
+extern bool gPreparedSkinning;
+
 struct RenderableMesh;
 struct RenderableTexture;
 struct CSkinnedAlgos
 {
 	typedef std::vector<std::pair<int, int> > BoneMapT;
-	static void processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMap, CTransform::t_matrix const* data);
+	// maxInfluences below skinInfo.weightsPerVertex keeps the strongest weights
+	// of every vertex and renormalizes them, 0 uses all
+	static void processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMap, CTransform::t_matrix const* data, unsigned maxInfluences = 0);
 	static void processSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNormals, float const* srcWeights, unsigned char const* srcBoneIndices,
 		Vec3 *dstPositions, Vec3* dstNormals,
 		size_t srcVertexStride, size_t srcWeightStride, size_t srcBoneIndexStride, size_t dstVertexStride, size_t vertexCount,
-		mutalisk::data::skin_info const& skinInfo, BoneMapT const& boneMap, CTransform::t_matrix const* matrixData);
+		mutalisk::data::skin_info const& skinInfo, BoneMapT const& boneMap, CTransform::t_matrix const* matrixData,
+		unsigned maxInfluences = 0);
+
+	// load time half of skinning, see PreparedSkin; a vertex with all its
+	// weights below pruneThreshold keeps none and is skinned to the origin
+	static void prepareSkin(PreparedSkin& skin, float const* srcWeights, unsigned char const* srcBoneIndices,
+		size_t srcWeightStride, size_t srcBoneIndexStride, size_t vertexCount,
+		mutalisk::data::skin_info const& skinInfo, float pruneThreshold = 0.001f);
+	// per frame half, groups with more than maxInfluences use their strongest
+	// weights renormalized
+	static void processPreparedSkin(Vec3 const* srcPositions, Vec3 const* srcNormals, Vec3* dstPositions, Vec3* dstNormals,
+		size_t srcVertexStride, size_t dstVertexStride, PreparedSkin const& skin,
+		BoneMapT const& boneMap, CTransform::t_matrix const* matrixData, unsigned maxInfluences = 0);
+
+	// indices of the maxCount largest of count weights, in decreasing order;
+	// returns the number picked
+	static unsigned strongestInfluences(float const* weights, unsigned count, unsigned maxCount, unsigned char* picked)
+	{
+		ASSERT(maxCount > 0);
+		unsigned n = 0;
+		for(unsigned w = 0; w < count; ++w)
+		{
+			unsigned q = (n < maxCount)? n++: n;
+			if(q == maxCount && !(weights[w] > weights[picked[q - 1]]))
+				continue;
+			if(q == maxCount)
+				--q;
+			for(; q > 0 && weights[w] > weights[picked[q - 1]]; --q)
+				picked[q] = picked[q - 1];
+			picked[q] = static_cast<unsigned char>(w);
+		}
+		return n;
+	}
+};
+
+// what a renderer keeps with a scene instance between frames, see
+// SurfaceCache in Renderer.h; it goes away with the instance
+struct RendererState
+{
+	virtual ~RendererState() {}
 };
 
+// A scene is loaded once into SharedResources, the immutable part every
+// instance of it refers to: scene data, meshes, textures, clips and material
+// versions. An instance adds what changes per copy, the animation State and
+// its own copies of the skinned meshes; see prepareInstance in the backends.
 struct RenderableScene
 {
 	struct SharedResources {
@@ -42,12 +123,47 @@ struct RenderableScene
 			AP<RenderableMesh>			renderable;
 		};
 		struct Texture {
-			AP<mutalisk::data::texture>	blueprint;
+			SharedRef<mutalisk::data::texture>	blueprint;	// shared between scenes, see ResourceCache
 			AP<RenderableTexture>		renderable;
 		};
 		mutalisk::array<Mesh>			meshes;
 		mutalisk::array<Texture>		textures;
 		AP<mutant::anim_character_set>	animCharSet;
+		std::vector<unsigned>			materialVersions;	// see RenderableScene::touchMaterials
+
+		// what setClip resolves by name, looked up once for animCharSet and
+		// reused by every instance and clip switch; see RenderableScene::bind
+		struct Bindings {
+			typedef std::pair<mutant::anim_clip const*, mutant::anim_hierarchy const*> ClipKeyT;
+			typedef std::map<ClipKeyT, CTransformBinding> ClipsT;
+
+			mutant::anim_character_set*		source;				// animCharSet the bindings were made for
+			mutant::anim_character*			character;
+			mutant::anim_hierarchy*			hierarchy;
+			std::vector<size_t>				light2XformIndex;
+			std::vector<size_t>				camera2XformIndex;
+			std::vector<size_t>				actor2XformIndex;
+			std::vector<CSkinnedAlgos::BoneMapT> bone2XformIndex;
+			ClipsT							clips;
+
+			Bindings() : source(0), character(0), hierarchy(0) {}
+
+			CTransformBinding const& clip(mutant::anim_clip const& clip, mutant::anim_hierarchy const& hierarchy)
+			{
+				CTransformBinding& binding = clips[ClipKeyT(&clip, &hierarchy)];
+				if(!binding.clip())
+					binding.create(clip, hierarchy);
+				return binding;
+			}
+		};
+		Bindings						bindings;
+
+		// frees the animation data; the bindings point into it
+		void releaseAnimation()
+		{
+			animCharSet.reset();
+			bindings = Bindings();
+		}
 	};
 	struct State {
 		float							time;
@@ -74,12 +190,81 @@ struct RenderableScene
 		typedef CSkinnedAlgos::BoneMapT	BoneMapT;
 		std::vector<BoneMapT>			bone2XformIndex;
 
+		// nodes are classified by their own curves when the clip is set; world
+		// matrices of nodes without animation in their whole parent chain are
+		// computed once, afterwards only animatedNodes are updated
+		enum NodeClass { nodeStatic, nodeConstant, nodeAnimated };
+		std::vector<unsigned char>		nodeClasses;
+		std::vector<unsigned>			animatedNodes;		// world matrix changes, parents first
+		bool							nodeCacheEnabled;
+		bool							transformsCached;
+		bool							matricesCached;
+
+		// below full rate the transforms are blended between lodFrom, the pose
+		// at lodFromTime, and lodTo evaluated ahead at lodToTime
+		AnimationLod					lod;
+		TransformsT						lodFrom;
+		TransformsT						lodTo;
+		float							lodFromTime;
+		float							lodToTime;
+		bool							lodSampled;			// lodFrom/lodTo valid, or the frozen pose evaluated
+
+		// last evaluated sample; update and process are skipped while clip and
+		// time stay the same, invalidate() forces the next frame to evaluate
+		mutant::anim_clip const*		evaluatedClip;
+		float							evaluatedTime;
+		bool							evaluated;			// transforms hold evaluatedClip at evaluatedTime
+		bool							processed;			// matrices and skinned meshes match the transforms
+
+		State() : time(0.0f), character(0), hierarchy(0), clip(0), activeCameraIndex(~0U),
+			nodeCacheEnabled(false), transformsCached(false), matricesCached(false),
+			lodFromTime(0.0f), lodToTime(0.0f), lodSampled(false),
+			evaluatedClip(0), evaluatedTime(0.0f), evaluated(false), processed(false) {}
+
+		// for writes the state cannot see: transforms, matrices or skin data
+		// changed from outside, or a clip modified in place
+		void invalidate()
+		{
+			this->evaluated = false;
+			this->processed = false;
+		}
+
+		void classifyNodes()
+		{
+			ASSERT(this->hierarchy);
+			size_t const count = this->hierarchy->size();
+			this->nodeClasses.assign(count, nodeAnimated);
+			this->animatedNodes.resize(0);
+
+			// without a clip the animator array is not rebuilt, so nothing is known
+			this->nodeCacheEnabled = (this->clip && this->xformArrayAnimator.size() >= count);
+			for(size_t q = 0; q < count; ++q)
+			{
+				if(this->nodeCacheEnabled)
+				{
+					CTransformAnimator const& animator = this->xformArrayAnimator[q];
+					if(!animator.hasSource())
+						this->nodeClasses[q] = nodeStatic;
+					else if(animator.isConstant())
+						this->nodeClasses[q] = nodeConstant;
+				}
+
+				int parent = (*this->hierarchy)[q].parent;
+				bool parentAnimated = (parent != mutant::anim_node::nparent && this->nodeClasses[parent] == nodeAnimated);
+				if(parentAnimated)
+					this->nodeClasses[q] = nodeAnimated;
+				if(this->nodeClasses[q] == nodeAnimated)
+					this->animatedNodes.push_back(q);
+			}
+		}
 
-		void setClip(mutant::anim_character_set& animCharSet, unsigned int clipIndex, bool looping)
+		// interpolateMethod picks slerp (iLINEAR) or nlerp (iNLERP, iNLERP_CORRECTED) for rotations
+		void setClip(SharedResources::Bindings& bindings, unsigned int clipIndex, bool looping,
+			CTransformAnimator::eInterpolateMethod interpolateMethod = CTransformAnimator::iLINEAR)
 		{
-			this->character = &animCharSet["scene"];
+			this->character = bindings.character;
 			ASSERT(this->character);
-			this->hierarchy = &this->character->hierarchy(mutant::sTypeNames::HIERARCHY_DEFAULT);
+			this->hierarchy = bindings.hierarchy;
 			ASSERT(this->hierarchy);
 
 			this->transforms.resize(this->hierarchy->size(), CTransform::identity());
@@ -89,15 +274,31 @@ struct RenderableScene
 			{
 				this->clip = &(*this->character)[clipIndex];
 				ASSERT(this->clip);
-				this->xformArrayAnimator.createFromClip(
-					*this->clip,
-					*this->hierarchy,
-					looping);
+				this->xformArrayAnimator.createFromBinding(
+					bindings.clip(*this->clip, *this->hierarchy),
+					looping,
+					true,
+					interpolateMethod);
 			}
 			else
 				this->clip = 0;
 
 			this->time = 0.0f;
+
+			this->transformsCached = false;
+			this->matricesCached = false;
+			this->lodSampled = false;
+			invalidate();
+			classifyNodes();
+		}
+
+		void setLod(AnimationLod const& lod)
+		{
+			if(this->lod == lod)
+				return;
+			this->lod = lod;
+			this->lodSampled = false;
+			invalidate();
 		}
 		bool hasAnimation(std::string const& actorName, std::string const& channelName) const
 		{
@@ -128,9 +329,103 @@ struct RenderableScene
 
 		void update(mutalisk::data::scene const& scene, float time)
 		{
+			MUTALISK_PROFILE_ZONE("animation");
+			float const deltaTime = time - this->time;
 			this->time = time;
-			this->xformArrayAnimator.updateTransforms(this->time,
-				this->transforms.begin(), this->transforms.end());
+			if(this->evaluated && this->evaluatedClip == this->clip && this->evaluatedTime == time)
+				return;
+			this->evaluatedClip = this->clip;
+			this->evaluatedTime = time;
+			this->evaluated = true;
+
+			if(this->lod.rate == AnimationLod::Frozen)
+			{
+				if(this->lodSampled)
+					return;
+				this->lodSampled = true;
+				this->transformsCached = false;
+			}
+			else if(this->lod.rate > AnimationLod::Full && this->nodeCacheEnabled)
+			{
+				this->processed = false;
+				updateReduced(deltaTime);
+				return;
+			}
+			this->processed = false;
+
+			if(this->transformsCached)
+				this->xformArrayAnimator.updateAnimatedTransforms(this->time,
+					this->transforms.begin(), this->transforms.end());
+			else
+			{
+				this->xformArrayAnimator.updateTransforms(this->time,
+					this->transforms.begin(), this->transforms.end());
+				this->transformsCached = this->nodeCacheEnabled;
+			}
+		}
+
+		void updateReduced(float deltaTime)
+		{
+			// the window ahead spans rate updates of the last frame length
+			float const DefaultStep = 1.0f / 60.0f;
+			float const MaxStep = 0.1f;
+			float const step = (deltaTime > 0.0f && deltaTime < MaxStep)? deltaTime: DefaultStep;
+
+			if(!this->lodSampled || this->time < this->lodFromTime || this->time > this->lodToTime + step)
+			{
+				// first update or a jump in time, both ends are evaluated
+				this->lodFrom.resize(this->transforms.size());
+				this->xformArrayAnimator.updateTransforms(this->time, this->lodFrom.begin(), this->lodFrom.end());
+				this->lodTo = this->lodFrom;
+				this->transforms = this->lodFrom;
+				this->transformsCached = true;
+				this->lodFromTime = this->time;
+				this->lodSampled = true;
+			}
+			else if(this->time >= this->lodToTime)
+			{
+				this->lodFrom.swap(this->lodTo);
+				this->lodFromTime = this->lodToTime;
+			}
+			else
+			{
+				blendLod();
+				return;
+			}
+
+			// constant nodes are equal in both poses, only animated ones are evaluated
+			this->lodToTime = this->lodFromTime + step * this->lod.rate;
+			this->xformArrayAnimator.updateAnimatedTransforms(this->lodToTime, this->lodTo.begin(), this->lodTo.end());
+			blendLod();
+		}
+
+		void blendLod()
+		{
+			float const length = this->lodToTime - this->lodFromTime;
+			float t = (length > 0.0f)? (this->time - this->lodFromTime) / length: 1.0f;
+			t = (t < 0.0f)? 0.0f: ((t > 1.0f)? 1.0f: t);
+			float const t0 = 1.0f - t;
+
+			std::vector<unsigned> const& animated = this->xformArrayAnimator.animated();
+			size_t const count = this->transforms.size();
+			for(std::vector<unsigned>::const_iterator it = animated.begin(); it != animated.end(); ++it)
+			{
+				if(!(*it < count))
+					break;
+				CTransform const& from = this->lodFrom[*it];
+				CTransform const& to = this->lodTo[*it];
+				CTransform& dst = this->transforms[*it];
+
+				dst.translation() = CTransform::t_vector(
+					from.translation().x * t0 + to.translation().x * t,
+					from.translation().y * t0 + to.translation().y * t,
+					from.translation().z * t0 + to.translation().z * t);
+				dst.scale() = CTransform::t_vector(
+					from.scale().x * t0 + to.scale().x * t,
+					from.scale().y * t0 + to.scale().y * t,
+					from.scale().z * t0 + to.scale().z * t);
+				QuatNLerp(&dst.rotation(), &from.rotation(), &to.rotation(), t);
+			}
 		}
 
 		/*CTransform::t_matrix calcProjectionMatrix(float fov, float aspect)
@@ -164,6 +459,10 @@ struct RenderableScene
 						blueprint.cameras[q].worldMatrix.data);
 				}
 
+			// hierarchy matrices were overwritten, cached ones are no longer valid
+			if(!animatedActors || !animatedCamera)
+				this->matricesCached = false;
+
 			if(this->activeCameraIndex != ~0U)
 			{
 				/*ASSERT(this->activeCameraIndex >= 0 && this->activeCameraIndex < this->camera2XformIndex.size());
@@ -187,22 +486,43 @@ struct RenderableScene
 			}
 		}
 
-		void process(mutalisk::data::scene const& blueprint, SharedResources& sharedResources)	
+		void process(mutalisk::data::scene const& blueprint, RenderableScene& scene)	
 		{
 //;;printf("process -- 0\n");
 			ASSERT(this->hierarchy);
+			// held frames and frozen poses keep matrices and skinned meshes
+			if(this->processed)
+			{
+				processActiveCamera(blueprint);
+				return;
+			}
+			this->processed = true;
 //;;printf("process -- 1\n");
-			CAnimatorAlgos::transformHierarchy(
-				this->matrices.begin(), this->matrices.end(),
-				this->transforms.begin(), *this->hierarchy );
+			{
+				MUTALISK_PROFILE_ZONE("transformHierarchy");
+				if(this->matricesCached)
+					CAnimatorAlgos::transformHierarchyNodes(
+						this->matrices.begin(), this->transforms.begin(), *this->hierarchy,
+						this->animatedNodes.begin(), this->animatedNodes.end() );
+				else
+				{
+					CAnimatorAlgos::transformHierarchy(
+						this->matrices.begin(), this->matrices.end(),
+						this->transforms.begin(), *this->hierarchy );
+					this->matricesCached = this->nodeCacheEnabled && this->transformsCached;
+				}
+			}
 //;;printf("process -- 2\n");
 
 			for(size_t q = 0; q < this->bone2XformIndex.size(); ++q)
 				if( !this->bone2XformIndex[q].empty() )
 				{
 //;;printf("process -- processSkinMesh0\n");
-					ASSERT(sharedResources.meshes[q].renderable.get());
-					CSkinnedAlgos::processSkinMesh(*sharedResources.meshes[q].renderable, this->bone2XformIndex[q], &this->matrices[0]);
+					MUTALISK_PROFILE_ZONE("processSkinMesh");
+					RenderableMesh* mesh = scene.renderableMesh(q);
+					ASSERT(mesh);
+					CSkinnedAlgos::processSkinMesh(*mesh, this->bone2XformIndex[q], &this->matrices[0],
+						this->lod.maxInfluences);
 //;;printf("process -- processSkinMesh0\n");
 				}
 //;;printf("process -- 3\n");
@@ -212,12 +532,53 @@ struct RenderableScene
 		}
 	};
 
-	RenderableScene(mutalisk::data::scene const& blueprint) : mBlueprint(blueprint) {}
+	// the first instance of a scene, resources are loaded into it by prepare
+	RenderableScene(mutalisk::data::scene const& blueprint)
+		: mBlueprint(blueprint), mSharedResources(AP<SharedResources>(new SharedResources)),
+		mResources(*mSharedResources), mMaterialVersions(mResources.materialVersions) { touchAllMaterials(); }
+	// another instance over resources loaded before
+	RenderableScene(mutalisk::data::scene const& blueprint, SharedRef<SharedResources> const& resources)
+		: mBlueprint(blueprint), mSharedResources(resources),
+		mResources(*mSharedResources), mMaterialVersions(mResources.materialVersions) {}
 
 	mutalisk::data::scene const&	mBlueprint;
-	SharedResources					mResources;
+	SharedRef<SharedResources>		mSharedResources;
+	SharedResources&				mResources;			// *mSharedResources
 	State							mState;
 
+	// copies of the skinned meshes owned by this instance, by mesh index;
+	// empty for the first instance, which skins the shared meshes
+	mutalisk::array<AP<RenderableMesh> >	mInstanceMeshes;
+
+	// version of every actor's materials, shared by all instances as the
+	// materials are; renderers keep the native surface inputs converted from
+	// them until the version changes, so whoever modifies
+	// actor.materials[].shaderInput has to call touchMaterials
+	std::vector<unsigned>&			mMaterialVersions;
+
+	// created by the renderer on the first frame drawn, one per instance
+	mutable AP<RendererState>		mRendererState;
+
+	// the mesh this instance draws and skins
+	RenderableMesh* renderableMesh(size_t meshIndex) const
+	{
+		if(meshIndex < mInstanceMeshes.size() && mInstanceMeshes[meshIndex].get())
+			return mInstanceMeshes[meshIndex].get();
+		return mResources.meshes[meshIndex].renderable.get();
+	}
+
+	void touchMaterials(size_t actorIndex)
+	{
+		ASSERT(actorIndex < mMaterialVersions.size());
+		mMaterialVersions[actorIndex] = nextMaterialVersion();
+	}
+	void touchAllMaterials()
+	{
+		mMaterialVersions.resize(mBlueprint.actors.size());
+		for(size_t q = 0; q < mMaterialVersions.size(); ++q)
+			mMaterialVersions[q] = nextMaterialVersion();
+	}
+
 	template <typename Node>
 	void mapNodesToHierarchy(mutant::anim_hierarchy const& hierarchy, Node	const* nodes, size_t nodeCount, std::vector<size_t>& node2XformIndex)
 	{
@@ -233,13 +594,10 @@ struct RenderableScene
 
 		for( size_t q = 0; q < boneCount; ++q )
 		{
-			unsigned boneId = 0;
 			std::string const& boneName = bones[q].name;
+			int boneId = hierarchy.index_by_name( boneName );
 
-			while( boneId < hierarchy.size() && hierarchy[ boneId ].name != boneName )
-				++boneId;
-
-			if( boneId == hierarchy.size() )
+			if( boneId == mutant::anim_node::nparent )
 				printf( "Couldn't find '%s' in hierarchy", boneName.c_str() );
 			else
 				bone2XformIndex.push_back( std::make_pair( (int)q, boneId ) );
@@ -247,25 +605,49 @@ struct RenderableScene
 	}
 
 
-	void setClip(unsigned int clipIndex, bool looping = true)
+	// resolves the scene character, its hierarchy and the lights, cameras,
+	// actors and bones mapped onto it; done once per animCharSet
+	SharedResources::Bindings& bind()
 	{
 		ASSERT(mResources.animCharSet.get());
-		mState.setClip(*mResources.animCharSet, clipIndex, looping);
-
-		ASSERT(mState.hierarchy);
+		SharedResources::Bindings& bindings = mResources.bindings;
+		if(bindings.source == mResources.animCharSet.get())
+			return bindings;
+
+		bindings = SharedResources::Bindings();
+		bindings.source = mResources.animCharSet.get();
+		bindings.character = &(*bindings.source)["scene"];
+		ASSERT(bindings.character);
+		bindings.hierarchy = &bindings.character->hierarchy(mutant::sTypeNames::HIERARCHY_DEFAULT);
+		ASSERT(bindings.hierarchy);
+
+		mutant::anim_hierarchy const& hierarchy = *bindings.hierarchy;
 		if(!mBlueprint.lights.empty())
-			mapNodesToHierarchy(*mState.hierarchy, &mBlueprint.lights[0], mBlueprint.lights.size(), mState.light2XformIndex);
+			mapNodesToHierarchy(hierarchy, &mBlueprint.lights[0], mBlueprint.lights.size(), bindings.light2XformIndex);
 		if(!mBlueprint.cameras.empty())
-			mapNodesToHierarchy(*mState.hierarchy, &mBlueprint.cameras[0], mBlueprint.cameras.size(), mState.camera2XformIndex);
+			mapNodesToHierarchy(hierarchy, &mBlueprint.cameras[0], mBlueprint.cameras.size(), bindings.camera2XformIndex);
 		if(!mBlueprint.actors.empty())
-			mapNodesToHierarchy(*mState.hierarchy, &mBlueprint.actors[0], mBlueprint.actors.size(), mState.actor2XformIndex);
-		
-		mState.bone2XformIndex.resize(mBlueprint.meshIds.size());
+			mapNodesToHierarchy(hierarchy, &mBlueprint.actors[0], mBlueprint.actors.size(), bindings.actor2XformIndex);
+
+		bindings.bone2XformIndex.resize(mBlueprint.meshIds.size());
 		for(size_t q = 0; q < mBlueprint.meshIds.size(); ++q)
 			if( mResources.meshes[q].blueprint->skinInfo )
-				mapBoneToHierarchy(*mState.hierarchy,
+				mapBoneToHierarchy(hierarchy,
 					&mResources.meshes[q].blueprint->skinInfo->bones[0], mResources.meshes[q].blueprint->skinInfo->bones.size(),
-					mState.bone2XformIndex[q]);
+					bindings.bone2XformIndex[q]);
+		return bindings;
+	}
+
+	void setClip(unsigned int clipIndex, bool looping = true,
+		CTransformAnimator::eInterpolateMethod interpolateMethod = CTransformAnimator::iLINEAR)
+	{
+		SharedResources::Bindings& bindings = bind();
+		mState.setClip(bindings, clipIndex, looping, interpolateMethod);
+
+		mState.light2XformIndex = bindings.light2XformIndex;
+		mState.camera2XformIndex = bindings.camera2XformIndex;
+		mState.actor2XformIndex = bindings.actor2XformIndex;
+		mState.bone2XformIndex = bindings.bone2XformIndex;
 
 		mState.activeCameraIndex = mBlueprint.defaultClipIndex;
 		mState.cameraMatrix = CTransform::identityMatrix();
@@ -276,8 +658,17 @@ struct RenderableScene
 		mState.processActiveCamera(mBlueprint);
 		return cameraIndex;
 	}
+	// level of detail for this instance, set by the demo script
+	void setAnimationLod(AnimationLod const& lod) { mState.setLod(lod); }
+	// update and process skip frames with the clip and time of the previous
+	// one; call this after changing the state or skin data directly
+	void invalidate() { mState.invalidate(); }
 	void update(float time) { mState.update(mBlueprint, time); }
-	void process() { mState.process(mBlueprint, mResources); }
+	void process() { mState.process(mBlueprint, *this); }
+
+private:
+	RenderableScene(RenderableScene const& c);
+	RenderableScene& operator= (RenderableScene const& c);
 };
 
 void setResourcePath(std::string const& path);
@@ -296,7 +687,7 @@ static AP<ResourceType> loadResource(std::string fileName)
 }
 
 template <>
-static AP<mutant::anim_character_set> loadResource(std::string fileName)
+AP<mutant::anim_character_set> loadResource(std::string fileName)
 {
 	;;printf("loadResource<anim_character_set>: $ %s\n", fileName.c_str());
 	AP<mutant::mutant_reader> reader = createFileReader(fileName);
@@ -307,7 +698,7 @@ static AP<mutant::anim_character_set> loadResource(std::string fileName)
 }
 
 template <>
-static AP<mutalisk::data::texture> loadResource(std::string fileName)
+AP<mutalisk::data::texture> loadResource(std::string fileName)
 {
 	;;printf("loadResource<mutalisk::data::texture>: $ %s\n", fileName.c_str());
 	AP<mutant::binary_input> input = AP<mutant::binary_input>(new file_input(getResourcePath() + fileName));
@@ -2,7 +2,9 @@
 #define MUTALISK__TIMELINE_H_
 
 #include "cfg.h"
+#include "Profiler.h"
 #include <vector>
+#include <algorithm>
 #include <utility>
 #include <math.h>
 
@@ -31,12 +33,61 @@ namespace mutalisk
 
 	private:
 		typedef std::vector<Item>							ScriptT;
-		typedef std::vector<std::pair<ScriptT, unsigned> >	RunningScriptsT;
 		typedef std::vector<TimelineFuncT>					TimelineFuncsT;
 
+		// script with a seek index: start frames are kept in a separate sorted
+		// array so the current item for any frame is found with a binary search.
+		// Once items are flagged when executed so that seeking forward only
+		// replays the ones that have not run yet; seeking backward clears the
+		// flags after the new position, so passing an item again runs it again
+		// as in the first pass, a load undone by a later unload included
+		struct RunningScript
+		{
+			ScriptT					items;
+			std::vector<unsigned>	startFrames;
+			std::vector<bool>		executed;
+			unsigned				current;
+
+			// index of the last item started at or before frame, -1 if none
+			unsigned seek(unsigned frame) const
+			{
+				return static_cast<unsigned>(std::upper_bound(startFrames.begin(), startFrames.end(), frame) - startFrames.begin()) - 1;
+			}
+		};
+		typedef std::vector<RunningScript>					RunningScriptsT;
+
 		RunningScriptsT	mScripts;
 		TimelineFuncsT	mGatheredFuncs;
 
+		static void call(Context& ctx, TimelineFuncT func)
+		{
+			if (func == 0)
+				printf("func is 0!!\n");
+			else
+				(ctx.*func)();
+		}
+
+		// items after current have not run as far as a later pass is concerned
+		static void rewind(RunningScript& script, unsigned current)
+		{
+			unsigned const first = (current == ~0U)? 0: current + 1;
+			if(first < script.executed.size())
+				std::fill(script.executed.begin() + first, script.executed.end(), false);
+		}
+
+		// runs Once items in (from, to] which have not been executed yet
+		static void replayOnce(Context& ctx, RunningScript& script, unsigned from, unsigned to)
+		{
+			for(unsigned q = from + 1; q <= to; ++q)
+			{
+				if (!(script.items[q].flags & Item::Once) || script.executed[q])
+					continue;
+				printf("call once (next) with startFrame = %i\n", script.items[q].startFrame);
+				script.executed[q] = true;
+				call(ctx, script.items[q].func);
+			}
+		}
+
 	public:
 		void addScript(Item items[])
 		{
@@ -46,40 +97,45 @@ namespace mutalisk
 
 			ASSERT(itemCount > 0);
 
-			ScriptT newScript(itemCount);
-			std::copy(items, items + itemCount, newScript.begin());
-			mScripts.push_back(std::make_pair(newScript, -1));
+			mScripts.push_back(RunningScript());
+			RunningScript& newScript = mScripts.back();
+			newScript.items.assign(items, items + itemCount);
+			newScript.startFrames.resize(itemCount);
+			for(unsigned q = 0; q < itemCount; ++q)
+			{
+				ASSERT(q == 0 || items[q].startFrame >= items[q-1].startFrame);
+				newScript.startFrames[q] = items[q].startFrame;
+			}
+			newScript.executed.resize(itemCount, false);
+			newScript.current = ~0U;
 			mGatheredFuncs.reserve(mScripts.size());
 		}
 
 		void update(Context& ctx, unsigned frame)
 		{
+			MUTALISK_PROFILE_ZONE("timeline");
 			gather(ctx, frame);
 			run(ctx);
 		}
 
-		void jump(Context& ctx, unsigned frame)
+		// positions every script at frame in O(log n); Once items passed over
+		// are only executed when runSkippedOnce is set
+		void jump(Context& ctx, unsigned frame, bool runSkippedOnce = false)
 		{
 			for(typename RunningScriptsT::iterator it = mScripts.begin(); it != mScripts.end(); ++it)
 			{
-				for(unsigned currScriptIt = 0; currScriptIt < it->first.size(); ++currScriptIt)
-				{
-					if(frame >= it->first[currScriptIt].startFrame)
-						it->second = currScriptIt;
-				}
+				unsigned target = it->seek(frame);
+				rewind(*it, target);
+				if(runSkippedOnce && target != ~0U)
+					replayOnce(ctx, *it, ~0U, target);
+				it->current = target;
 			}
 		}
 
 		void run(Context& ctx)
 		{
 			for(typename TimelineFuncsT::iterator it = mGatheredFuncs.begin(); it != mGatheredFuncs.end(); ++it)
-			{
-				TimelineFuncT func = *it;
-				if (func == 0)
-					printf("func is 0!!\n");
-				else
-					(ctx.*func)();
-			}
+				call(ctx, *it);
 		}
 
 		void gather(Context& ctx, unsigned frame)
@@ -87,50 +143,28 @@ namespace mutalisk
 			mGatheredFuncs.resize(0);
 			for(typename RunningScriptsT::iterator it = mScripts.begin(); it != mScripts.end(); ++it)
 			{
-				unsigned& currScriptIt = it->second;
-				if(currScriptIt == it->first.size())
-					continue;
+				unsigned& currScriptIt = it->current;
+				unsigned target = it->seek(frame);
 
-				unsigned nextScriptIt = currScriptIt;
-				if(currScriptIt == (unsigned)-1 || frame >= it->first[currScriptIt].startFrame)
+				if(currScriptIt == ~0U || (target != ~0U && target > currScriptIt))
 				{
-					++nextScriptIt;
-					if(nextScriptIt < it->first.size() && frame >= it->first[nextScriptIt].startFrame)
-					{
-						currScriptIt = nextScriptIt;
-						if (it->first[currScriptIt].flags & Item::Once)
-						{
-							printf("call once (next) with startFrame = %i\n", it->first[currScriptIt].startFrame);
-							TimelineFuncT func = it->first[currScriptIt].func;
-							if (func == 0)
-								printf("func is 0!!\n");
-							else
-								(ctx.*func)();
-						}
-					}
+					// moving forward, possibly over several items if frames were dropped
+					if(target != ~0U)
+						replayOnce(ctx, *it, currScriptIt, target);
+					currScriptIt = target;
 				}
-				else
+				else if(target != currScriptIt)
 				{
-					if(nextScriptIt > 0)
-						--nextScriptIt;
-					if(nextScriptIt != currScriptIt && frame < it->first[currScriptIt].startFrame)
-					{
-						currScriptIt = nextScriptIt;
-						if (it->first[currScriptIt].flags & Item::Once)
-						{
-							printf("call once (previous) with startFrame = %i\n", it->first[currScriptIt].startFrame);
-							TimelineFuncT func = it->first[currScriptIt].func;
-							if (func == 0)
-								printf("func is 0!!\n");
-						}
-					}
+					// moving backward never rewinds past the first item and
+					// does not execute Once items, they run again when passed
+					currScriptIt = (target == ~0U)? 0: target;
+					rewind(*it, currScriptIt);
 				}
 
-				if (currScriptIt == (unsigned)-1 || (it->first[currScriptIt].flags & Item::Once))
+				if (currScriptIt == ~0U || (it->items[currScriptIt].flags & Item::Once))
 					continue;
 
-				TimelineFuncT func = it->first[currScriptIt].func;
-				mGatheredFuncs.push_back(func);
+				mGatheredFuncs.push_back(it->items[currScriptIt].func);
 			}
 		}
 
@@ -1,6 +1,8 @@
 #include "dx9ScenePlayer.h"
+#include "../Profiler.h"
 
 #include <memory>
+#include <map>
 #include <d3d9types.h>
 #include <effects/all.h>
 #include <effects/Library.h>
@@ -111,6 +113,57 @@ std::auto_ptr<Dx9RenderableScene> prepare(RenderContext& rc, mutalisk::data::sce
 	return scene;
 }
 
+std::auto_ptr<Dx9RenderableScene> prepareInstance(RenderContext& rc, Dx9RenderableScene const& source)
+{
+	std::auto_ptr<Dx9RenderableScene> scene(new Dx9RenderableScene(
+		source.mBlueprint, source.mSharedResources, source.mNativeResources));
+
+	RenderableScene::SharedResources const& resources = source.mResources;
+	scene->mInstanceMeshes.resize(resources.meshes.size());
+	for(size_t q = 0; q < resources.meshes.size(); ++q)
+		if(resources.meshes[q].blueprint->skinInfo && resources.meshes[q].renderable.get())
+			scene->mInstanceMeshes[q] = prepareInstance(rc, *resources.meshes[q].renderable);
+
+	scene->setClip(source.mBlueprint.defaultClipIndex);
+	return scene;
+}
+
+namespace {
+	// offsets of the skinned vertex components, ~0U for a missing one
+	struct SkinOffsets
+	{
+		size_t positions;
+		size_t normals;
+		size_t weights;
+		size_t boneIndices;
+
+		SkinOffsets(DWORD fvfVertexDecl) : positions(~0U), normals(~0U), weights(~0U), boneIndices(~0U)
+		{
+			D3DVERTEXELEMENT9 dx9Declaration[MAX_FVF_DECL_SIZE];
+			D3DXDeclaratorFromFVF(fvfVertexDecl, dx9Declaration);
+			for(size_t q = 0; q < MAX_FVF_DECL_SIZE && dx9Declaration[q].Stream != 0xff; ++q)
+			{
+				size_t offset = dx9Declaration[q].Offset;
+				switch(dx9Declaration[q].Usage)
+				{
+				case D3DDECLUSAGE_POSITION:
+					positions = offset;
+					break;
+				case D3DDECLUSAGE_BLENDWEIGHT:
+					weights = offset;
+					break;
+				case D3DDECLUSAGE_BLENDINDICES:
+					boneIndices = offset;
+					break;
+				case D3DDECLUSAGE_NORMAL:
+					normals = offset;
+					break;
+				}
+			}
+		}
+	};
+}
+
 std::auto_ptr<RenderableMesh> prepare(RenderContext& rc, mutalisk::data::mesh const& data)
 {
 	std::auto_ptr<RenderableMesh> mesh(new RenderableMesh(data));
@@ -177,7 +230,28 @@ std::auto_ptr<RenderableMesh> prepare(RenderContext& rc, mutalisk::data::mesh co
 		DX_MSG("unlock index buffer") = mesh->mNative->UnlockIndexBuffer();
 	}
 
+	// after the vertex cache optimization, which reorders the vertices
+	if(data.skinInfo)
+	{
+		SkinOffsets offsets(data.fvfVertexDecl);
+		ASSERT(offsets.weights != ~0U);
+		ASSERT(offsets.boneIndices != ~0U);
+		CSkinnedAlgos::prepareSkin(mesh->mSkin,
+			reinterpret_cast<float const*>(data.vertexData + offsets.weights), data.vertexData + offsets.boneIndices,
+			data.vertexStride, data.vertexStride, data.vertexCount, *data.skinInfo);
+	}
+
+	return mesh;
+}
+
+std::auto_ptr<RenderableMesh> prepareInstance(RenderContext& rc, RenderableMesh const& source)
+{
+	std::auto_ptr<RenderableMesh> mesh(new RenderableMesh(source.mBlueprint));
+	mesh->mSource = &source;
 
+	// index and attribute buffers are copied too, D3DX meshes cannot share them
+	DX_MSG("clone mesh") = source.mNative->CloneMeshFVF(
+		source.mNative->GetOptions(), source.mBlueprint.fvfVertexDecl, rc.device, &mesh->mNative);
 	return mesh;
 }
 
@@ -255,6 +329,12 @@ namespace {
 		c.r = color.r; c.g = color.g; c.b = color.b; c.a = color.a;
 	}
 
+	void toNativeTextures(BaseEffect::Input::Surface& dst, Dx9RenderableScene const& scene, mutalisk::data::shader_fixed const& src)
+	{
+		dst.diffuseTexture = (src.diffuseTexture != ~0U)? scene.mNativeResources.textures[src.diffuseTexture] : 0;
+		dst.envmapTexture = (src.envmapTexture != ~0U)? scene.mNativeResources.textures[src.envmapTexture] : 0;
+	}
+
 	void toNative(BaseEffect::Input::Surface& dst, Dx9RenderableScene const& scene, mutalisk::data::shader_fixed const& src)
 	{
 		toNative(dst.ambient, src.ambient);
@@ -262,8 +342,7 @@ namespace {
 		toNative(dst.specular, src.specular);
 		toNative(dst.emissive, src.emissive);
 
-		dst.diffuseTexture = (src.diffuseTexture != ~0U)? scene.mNativeResources.textures[src.diffuseTexture] : 0;
-		dst.envmapTexture = (src.envmapTexture != ~0U)? scene.mNativeResources.textures[src.envmapTexture] : 0;
+		toNativeTextures(dst, scene, src);
 
 		dst.uOffset = src.uOffset;
 		dst.vOffset = src.vOffset;
@@ -761,11 +840,26 @@ void render(RenderContext& rc, Dx9RenderableScene const& scene, int maxActors)
 	visibleActors.resize(0);
 
 	RenderContext& camera = rc; // @TBD:
-	findVisibleActors(camera, 0) (scene.mBlueprint.actors, visibleActors);
-	blastInstanceInputs(scene, camera) (visibleActors, instanceInputs);
-	blastSurfaceInputs(scene, 0) (visibleActors, surfaceInputs);
-	blastRenderBlocks(scene, cameraPos) (visibleActors, bgRenderBlocks, opaqueRenderBlocks, transparentRenderBlocks, fgRenderBlocks);
-	sortRenderBlocks()(transparentRenderBlocks);
+	{
+		MUTALISK_PROFILE_ZONE("render.findVisibleActors");
+		findVisibleActors(camera, 0) (scene.mBlueprint.actors, visibleActors);
+	}
+	{
+		MUTALISK_PROFILE_ZONE("render.blastInstanceInputs");
+		blastInstanceInputs(scene, camera) (visibleActors, instanceInputs);
+	}
+	{
+		MUTALISK_PROFILE_ZONE("render.blastSurfaceInputs");
+		blastSurfaceInputs(scene, 0) (visibleActors, surfaceInputs);
+	}
+	{
+		MUTALISK_PROFILE_ZONE("render.blastRenderBlocks");
+		blastRenderBlocks(scene, cameraPos) (visibleActors, bgRenderBlocks, opaqueRenderBlocks, transparentRenderBlocks, fgRenderBlocks);
+	}
+	{
+		MUTALISK_PROFILE_ZONE("render.sortRenderBlocks");
+		sortRenderBlocks()(transparentRenderBlocks);
+	}
 	if(instanceInputs.empty() || surfaceInputs.empty())
 	{
 		ASSERT(visibleActors.empty());
@@ -807,6 +901,7 @@ void render(RenderContext& rc, Dx9RenderableScene const& scene, int maxActors)
 		foreground.zReadEnable = false;
 		foreground.zEqual = false;
 
+		MUTALISK_PROFILE_ZONE("render.drawRenderBlocks");
 		drawRenderBlocks draw(rc, scene, 
 			&instanceInputs[0], instanceInputs.size(), &surfaceInputs[0], surfaceInputs.size());
 		
@@ -843,38 +938,17 @@ void render(RenderContext& rc, Dx9RenderableScene const& scene, int maxActors)
 }
 ////////////////////////////////////////////////
 
-void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMap, CTransform::t_matrix const* matrices)
+void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMap, CTransform::t_matrix const* matrices,
+	unsigned maxInfluences)
 {		
 	ASSERT(mesh.mBlueprint.skinInfo);
 	ASSERT(!boneMap.empty());
 
-	D3DVERTEXELEMENT9 dx9Declaration[MAX_FVF_DECL_SIZE];
-	D3DXDeclaratorFromFVF(mesh.mBlueprint.fvfVertexDecl, dx9Declaration);
-
-	size_t positionsOffset = ~0U;
-	size_t normalsOffset = ~0U;
-	size_t weightsOffset = ~0U;
-	size_t boneIndicesOffset = ~0U;
-
-	for(size_t q = 0; q < MAX_FVF_DECL_SIZE && dx9Declaration[q].Stream != 0xff; ++q)
-	{
-		size_t offset = dx9Declaration[q].Offset;
-		switch(dx9Declaration[q].Usage)
-		{
-		case D3DDECLUSAGE_POSITION:
-			positionsOffset = offset;
-			break;
-		case D3DDECLUSAGE_BLENDWEIGHT:
-			weightsOffset = offset;
-			break;
-		case D3DDECLUSAGE_BLENDINDICES:
-			boneIndicesOffset = offset;
-			break;
-		case D3DDECLUSAGE_NORMAL:
-			normalsOffset = offset;
-			break;
-		}
-	}
+	SkinOffsets offsets(mesh.mBlueprint.fvfVertexDecl);
+	size_t positionsOffset = offsets.positions;
+	size_t normalsOffset = offsets.normals;
+	size_t weightsOffset = offsets.weights;
+	size_t boneIndicesOffset = offsets.boneIndices;
 
 	ASSERT(positionsOffset != ~0);
 	ASSERT(normalsOffset != ~0);
@@ -886,22 +960,31 @@ void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMa
 	unsigned char const* srcRaw = mesh.mBlueprint.vertexData;
 	memcpy(dstRaw, srcRaw, mesh.mBlueprint.vertexDataSize);
 
-	processSkinMesh(
-		reinterpret_cast<Vec3 const*>(srcRaw + positionsOffset),
-		reinterpret_cast<Vec3 const*>(srcRaw + normalsOffset),
-		reinterpret_cast<float const*>(srcRaw + weightsOffset),
-		reinterpret_cast<unsigned char const*>(srcRaw + boneIndicesOffset),
-
-		reinterpret_cast<Vec3*>(dstRaw + positionsOffset),
-		reinterpret_cast<Vec3*>(dstRaw + normalsOffset),
-
-		mesh.mBlueprint.vertexStride,											// srcVertexStride
-		mesh.mBlueprint.vertexStride,											// srcWeightStride
-		mesh.mBlueprint.vertexStride,											// srcBoneIndexStride
-		mesh.mBlueprint.vertexStride,											// dstVertexStride
-		mesh.mBlueprint.vertexCount,
-
-		*mesh.mBlueprint.skinInfo, boneMap, matrices);
+	if(gPreparedSkinning && !mesh.skin().empty())
+		processPreparedSkin(
+			reinterpret_cast<Vec3 const*>(srcRaw + positionsOffset),
+			reinterpret_cast<Vec3 const*>(srcRaw + normalsOffset),
+			reinterpret_cast<Vec3*>(dstRaw + positionsOffset),
+			reinterpret_cast<Vec3*>(dstRaw + normalsOffset),
+			mesh.mBlueprint.vertexStride, mesh.mBlueprint.vertexStride,
+			mesh.skin(), boneMap, matrices, maxInfluences);
+	else
+		processSkinMesh(
+			reinterpret_cast<Vec3 const*>(srcRaw + positionsOffset),
+			reinterpret_cast<Vec3 const*>(srcRaw + normalsOffset),
+			reinterpret_cast<float const*>(srcRaw + weightsOffset),
+			reinterpret_cast<unsigned char const*>(srcRaw + boneIndicesOffset),
+
+			reinterpret_cast<Vec3*>(dstRaw + positionsOffset),
+			reinterpret_cast<Vec3*>(dstRaw + normalsOffset),
+
+			mesh.mBlueprint.vertexStride,											// srcVertexStride
+			mesh.mBlueprint.vertexStride,											// srcWeightStride
+			mesh.mBlueprint.vertexStride,											// srcBoneIndexStride
+			mesh.mBlueprint.vertexStride,											// dstVertexStride
+			mesh.mBlueprint.vertexCount,
+
+			*mesh.mBlueprint.skinInfo, boneMap, matrices, maxInfluences);
 
 	DX_MSG("unlock vertex buffer") = mesh.mNative->UnlockVertexBuffer();
 
@@ -35,9 +35,13 @@ struct RenderContext
 
 struct RenderableMesh
 {
-	RenderableMesh(mutalisk::data::mesh const& blueprint) : mBlueprint(blueprint) {}
+	RenderableMesh(mutalisk::data::mesh const& blueprint) : mBlueprint(blueprint), mSource(0) {}
 	mutalisk::data::mesh const&			mBlueprint;
 	com_ptr<ID3DXMesh>					mNative;
+	PreparedSkin						mSkin;
+	RenderableMesh const*				mSource;		// mesh an instance copy was made from, it keeps the skin
+
+	PreparedSkin const& skin() const { return (mSource)? mSource->skin(): mSkin; }
 
 private:
 	RenderableMesh(RenderableMesh const& c);
@@ -61,17 +65,24 @@ private:
 ////////////////////////////////////////////////
 struct Dx9RenderableScene : public RenderableScene
 {
-	Dx9RenderableScene(mutalisk::data::scene const& blueprint) : RenderableScene(blueprint) {}
-
 	struct NativeSharedResources {
 		mutalisk::array<com_ptr<IDirect3DTexture9> >	textures;
 	};
 
+	Dx9RenderableScene(mutalisk::data::scene const& blueprint) : RenderableScene(blueprint) {}
+	Dx9RenderableScene(mutalisk::data::scene const& blueprint, SharedRef<SharedResources> const& resources,
+		NativeSharedResources const& nativeResources)
+		: RenderableScene(blueprint, resources), mNativeResources(nativeResources) {}
+
 	NativeSharedResources	mNativeResources;
 };
 
 AP<Dx9RenderableScene> prepare(RenderContext& rc, mutalisk::data::scene const& data);
 AP<RenderableMesh> prepare(RenderContext& rc, mutalisk::data::mesh const& data);
+// another instance of a prepared scene: only skinned meshes are copied, with
+// their own vertex buffers; everything else is shared with source
+AP<Dx9RenderableScene> prepareInstance(RenderContext& rc, Dx9RenderableScene const& source);
+AP<RenderableMesh> prepareInstance(RenderContext& rc, RenderableMesh const& source);
 //AP<RenderableTexture> prepare(RenderContext& rc, mutalisk::data::texture const& data);
 void update(Dx9RenderableScene& scene, float deltaTime);
 void process(Dx9RenderableScene& scene);
@@ -0,0 +1,29 @@
+#ifndef MUTALISK_PSP_AUDIOSTREAM_H_
+#define MUTALISK_PSP_AUDIOSTREAM_H_
+
+#include "../cfg.h"
+#include "../AudioStream.h"
+
+#include <pspiofilemgr.h>
+
+namespace mutalisk
+{
+	class IoAudioFile : public AudioFile
+	{
+	public:
+		IoAudioFile() : mFd(-1) {}
+		~IoAudioFile() { close(); }
+
+		bool open(char const* fileName) { close(); mFd = sceIoOpen(fileName, PSP_O_RDONLY, 0777); return mFd >= 0; }
+		void close() { if(mFd >= 0) sceIoClose(mFd); mFd = -1; }
+
+		virtual int read(void* dst, unsigned size) { return sceIoRead(mFd, dst, size); }
+		virtual bool seek(unsigned offset) { return sceIoLseek(mFd, offset, PSP_SEEK_SET) == (SceOff)offset; }
+
+	private:
+		SceUID mFd;
+	};
+
+} // namespace mutalisk
+
+#endif // MUTALISK_PSP_AUDIOSTREAM_H_
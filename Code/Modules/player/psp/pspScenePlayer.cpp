@@ -1,12 +1,18 @@
 #include "pspScenePlayer.h"
 #include "../ScenePlayer.h"
+#include "../Profiler.h"
+#include "../ResourceLoader.h"
 
 #include <memory>
+#include <map>
 #include <effects/all.h>
 #include <effects/Library.h>
 #include <effects/BaseEffect.h>
 
 #include "pspvfpu.h"
+#include <pspiofilemgr.h>
+#include <pspthreadman.h>
+#include <pspkernel.h>
 
 extern "C" {
 	#include <Base/Std/Std.h>
@@ -17,6 +23,7 @@ namespace mutalisk
 {
 	using namespace effects;
 	bool gDelayedTextureLoading = false;
+	PspFrameFence gFrameFence;
 	data::psp_texture gMirrorTexture;
 
 RenderContext::RenderContext()
@@ -28,6 +35,23 @@ RenderContext::RenderContext()
 	gumLoadIdentity(&viewProjMatrix);
 }
 
+////////////////////////////////////////////////
+void PspFrameFence::wait(ValueT value)
+{
+	// the list being recorded cannot be waited for
+	if(value <= mCompleted || value > mSubmitted)
+		return;
+	MUTALISK_PROFILE_ZONE("fence wait");
+	sync();
+}
+
+void PspFrameFence::sync()
+{
+	// lists run in order, once the GE is idle every submitted one is done
+	sceGuSync(0,0);
+	mCompleted = mSubmitted;
+}
+
 ////////////////////////////////////////////////
 data::psp_texture& getMirrorTexture()
 {
@@ -40,15 +64,112 @@ std::auto_ptr<RenderableTexture> prepare(RenderContext& rc, mutalisk::data::text
 	return texture;
 }
 ////////////////////////////////////////////////
+SharedRef<data::texture> acquireTexture(data::MtxHeader* mtx, unsigned size)
+{
+	return acquireTexture(mtx, size, contentHash(mtx, size));
+}
+
+SharedRef<data::texture> acquireTexture(data::MtxHeader* mtx, unsigned size, unsigned hash)
+{
+	typedef ResourceCache<data::texture> CacheT;
+	SharedRef<data::texture> texture = CacheT::getInstance().find(hash, size);
+	if(texture.get())
+	{
+		free(mtx);
+		return texture;
+	}
+
+	std::auto_ptr<data::texture> resource(new data::texture);
+	resource->patchupTextureFromMemory(mtx);
+	return CacheT::getInstance().insert(hash, size, resource);
+}
+
+SharedRef<data::texture> loadTexture(std::string const& fileName)
+{
+	u32 startTime = sceKernelGetSystemTimeLow();
+	unsigned size = 0;
+	data::MtxHeader* mtx = (data::MtxHeader*)readFile(getResourcePath() + fileName, size, sizeof(data::MtxHeader));
+	if(!mtx)
+		return SharedRef<data::texture>();
+
+	SharedRef<data::texture> texture = acquireTexture(mtx, size);
+	ResourceCache<data::texture>::getInstance().addLoadTime(sceKernelGetSystemTimeLow() - startTime);
+	return texture;
+}
+
+void printResourceStats()
+{
+	ResourceCache<data::texture>::Stats const& stats = ResourceCache<data::texture>::getInstance().stats();
+	printf("textures: %u requests, %u shared, %u live\n", stats.requests, stats.hits, (unsigned)ResourceCache<data::texture>::getInstance().size());
+	printf("textures: %u KB loaded, %u KB deduplicated, %u ms\n", stats.loadedBytes / 1024, stats.dedupBytes / 1024, stats.loadTime / 1000);
+}
+
+////////////////////////////////////////////////
+namespace {
+	// reads and hashes a texture on a loader worker, the ResourceCache lookup
+	// is left to the caller
+	struct TextureJob : public ResourceLoader::Job
+	{
+		explicit TextureJob(std::string const& fullName) : fullName(fullName), mtx(0), size(0), hash(0), loadTime(0) {}
+
+		virtual void run()
+		{
+			u32 startTime = sceKernelGetSystemTimeLow();
+			mtx = (data::MtxHeader*)readFile(fullName, size, sizeof(data::MtxHeader));
+			if(mtx)
+				hash = contentHash(mtx, size);
+			loadTime = sceKernelGetSystemTimeLow() - startTime;
+		}
+
+		std::string			fullName;
+		data::MtxHeader*	mtx;		// handed to acquireTexture
+		unsigned			size;
+		unsigned			hash;
+		u32					loadTime;
+	};
+}
+
 std::auto_ptr<RenderableScene> prepare(RenderContext& rc, mutalisk::data::scene const& data, std::string const& pathPrefix)
 {
+	typedef LoadJob<mutalisk::data::mesh> MeshJob;
+	typedef LoadJob<mutant::anim_character_set> AnimJob;
+
 	std::auto_ptr<RenderableScene> scene(new RenderableScene(data));
 
+	// every file of the scene is read and parsed on the loader workers, the
+	// results are published below in the order of the serial load
+	std::string const fullPrefix = getResourcePath() + pathPrefix;
+	mutalisk::array<std::auto_ptr<MeshJob> > meshJobs;
+	mutalisk::array<std::auto_ptr<TextureJob> > textureJobs;
+	AnimJob animJob(fullPrefix + data.animCharId);
+	ResourceLoader loader;
+
+	// animations take longest to parse, started first the reads of the other
+	// files hide them
+	loader.add(animJob);
+	meshJobs.resize(data.meshIds.size());
+	for(size_t q = 0; q < data.meshIds.size(); ++q)
+	{
+		meshJobs[q] = std::auto_ptr<MeshJob>(new MeshJob(fullPrefix + data.meshIds[q]));
+		loader.add(*meshJobs[q]);
+	}
+	if (!gDelayedTextureLoading)
+	{
+		textureJobs.resize(data.textureIds.size());
+		for(size_t q = 0; q < data.textureIds.size(); ++q)
+		{
+			textureJobs[q] = std::auto_ptr<TextureJob>(new TextureJob(fullPrefix + data.textureIds[q]));
+			loader.add(*textureJobs[q]);
+		}
+	}
+
 	// load shared resources
 	scene->mResources.meshes.resize(data.meshIds.size());
 	for(size_t q = 0; q < data.meshIds.size(); ++q)
 	{
-		scene->mResources.meshes[q].blueprint = loadResource<mutalisk::data::mesh>(pathPrefix + data.meshIds[q]);
+		loader.wait(*meshJobs[q]);
+		scene->mResources.meshes[q].blueprint = meshJobs[q]->resource;
+		ASSERT(scene->mResources.meshes[q].blueprint.get());
 		scene->mResources.meshes[q].renderable = prepare(rc, *scene->mResources.meshes[q].blueprint);
 		if (data.meshIds[q].find("_sprite") != std::string::npos)
 		{
@@ -61,15 +182,24 @@ std::auto_ptr<RenderableScene> prepare(RenderContext& rc, mutalisk::data::scene
 		scene->mResources.textures.resize(data.textureIds.size());
 		for(size_t q = 0; q < data.textureIds.size(); ++q)
 		{
-			scene->mResources.textures[q].blueprint = loadResource<mutalisk::data::texture>(pathPrefix + data.textureIds[q]);
-			scene->mResources.textures[q].renderable = prepare(rc, *scene->mResources.textures[q].blueprint);
+			TextureJob& job = *textureJobs[q];
+			loader.wait(job);
+			if(job.mtx)
+			{
+				scene->mResources.textures[q].blueprint = acquireTexture(job.mtx, job.size, job.hash);
+				ResourceCache<data::texture>::getInstance().addLoadTime(job.loadTime);
+				scene->mResources.textures[q].renderable = prepare(rc, *scene->mResources.textures[q].blueprint);
+			}
+			else
+				printf("%s : texture %s missing\n", __FUNCTION__, data.textureIds[q].c_str());
 		}
 		for(size_t q = 0; q < data.textureIds.size(); ++q)
 		{
 			printf(" texture = %x\n", (unsigned)scene->mResources.textures[q].blueprint.get());
 		}
 	}
-	scene->mResources.animCharSet = loadResource<mutant::anim_character_set>(pathPrefix + data.animCharId);
+	loader.wait(animJob);
+	scene->mResources.animCharSet = animJob.resource;
 
 	// setup scene
 	scene->setClip(data.defaultClipIndex);
@@ -109,6 +239,20 @@ std::auto_ptr<RenderableScene> prepare(RenderContext& rc, mutalisk::data::scene
 	return scene;
 }
 
+std::auto_ptr<RenderableScene> prepareInstance(RenderContext& rc, RenderableScene const& source)
+{
+	std::auto_ptr<RenderableScene> scene(new RenderableScene(source.mBlueprint, source.mSharedResources));
+
+	RenderableScene::SharedResources const& resources = source.mResources;
+	scene->mInstanceMeshes.resize(resources.meshes.size());
+	for(size_t q = 0; q < resources.meshes.size(); ++q)
+		if(resources.meshes[q].blueprint->skinInfo && resources.meshes[q].renderable.get())
+			scene->mInstanceMeshes[q] = prepareInstance(rc, *resources.meshes[q].renderable);
+
+	scene->setClip(source.mBlueprint.defaultClipIndex);
+	return scene;
+}
+
 namespace {
 	size_t singleWeightSize(unsigned int vertexDecl)
 	{
@@ -126,6 +270,64 @@ namespace {
 		//MUTALISK_NOT_IMPLEMENTED("vertexElementInfo");
 		return 0;
 	}
+
+	// offset of float positions in a vertex; elements come in GE order, each
+	// aligned to its component size. False for other position formats and for
+	// weighted or morphed vertices
+	bool floatPositionOffset(unsigned int vertexDecl, size_t& offset)
+	{
+		if((vertexDecl & GU_VERTEX_BITS) != GU_VERTEX_32BITF ||
+			(vertexDecl & (GU_WEIGHTS_BITS|GU_WEIGHT_BITS|GU_VERTICES_BITS)))
+			return false;
+
+		static size_t const componentSize[] = { 0, 1, 2, 4 };
+		static size_t const colorSize[] = { 0, 0, 0, 0, 2, 2, 2, 4 };
+		offset = 0;
+		size_t size = componentSize[vertexDecl & GU_TEXTURE_BITS];
+		if(size)
+			offset = (offset + size - 1) / size * size + 2 * size;
+		size = colorSize[(vertexDecl & GU_COLOR_BITS) >> 2];
+		if(size)
+			offset = (offset + size - 1) / size * size + size;
+		size = componentSize[(vertexDecl & GU_NORMAL_BITS) >> 5];
+		if(size)
+			offset = (offset + size - 1) / size * size + 3 * size;
+		offset = (offset + 3) & ~3U;
+		return true;
+	}
+
+	// sphere around the box of the bind positions, skinned meshes move away
+	// from them and stay without bounds
+	void calcBounds(RenderableMesh& mesh)
+	{
+		mutalisk::data::mesh const& data = mesh.mBlueprint;
+		size_t offset = 0;
+		if(!data.vertexCount || data.skinInfo || !floatPositionOffset(data.vertexDecl, offset))
+			return;
+
+		Vec3 lo = *reinterpret_cast<Vec3 const*>(data.vertexData + offset);
+		Vec3 hi = lo;
+		for(size_t q = 1; q < data.vertexCount; ++q)
+		{
+			Vec3 const& p = *reinterpret_cast<Vec3 const*>(data.vertexData + q * data.vertexStride + offset);
+			lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+			lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+			lo.z = std::min(lo.z, p.z); hi.z = std::max(hi.z, p.z);
+		}
+
+		Vec3& center = mesh.mBoundCenter;
+		center.x = (lo.x + hi.x) * 0.5f;
+		center.y = (lo.y + hi.y) * 0.5f;
+		center.z = (lo.z + hi.z) * 0.5f;
+		float radiusSq = 0.0f;
+		for(size_t q = 0; q < data.vertexCount; ++q)
+		{
+			Vec3 d = *reinterpret_cast<Vec3 const*>(data.vertexData + q * data.vertexStride + offset);
+			Vec3_sub(&d, &d, &center);
+			radiusSq = std::max(radiusSq, Vec3_dot(&d, &d));
+		}
+		mesh.mBoundRadius = sqrtf(radiusSq);
+	}
 }
 
 std::auto_ptr<RenderableMesh> prepare(RenderContext& rc, mutalisk::data::mesh const& data)
@@ -152,12 +354,48 @@ std::auto_ptr<RenderableMesh> prepare(RenderContext& rc, mutalisk::data::mesh co
 			src += data.vertexStride;
 		}
 
-		mesh->mAmplifiedVertexData[1] = new unsigned char[newVertexStride * data.vertexCount];
-		memcpy(mesh->mAmplifiedVertexData[1], mesh->mAmplifiedVertexData[0], newVertexStride * data.vertexCount);
-		mesh->mAmplifiedBufferIndex = 0;
+		// the GE draws the previous frame while the next one is skinned
+		mesh->mAmplifiedRotation.reset(MUTALISK_SKINNED_BUFFERS);
+		for(unsigned q = 1; q < mesh->mAmplifiedRotation.count(); ++q)
+		{
+			mesh->mAmplifiedVertexData[q] = new unsigned char[newVertexStride * data.vertexCount];
+			memcpy(mesh->mAmplifiedVertexData[q], mesh->mAmplifiedVertexData[0], newVertexStride * data.vertexCount);
+		}
+		mesh->mAmplifiedBufferIndex = mesh->mAmplifiedRotation.current();
+		sceKernelDcacheWritebackAll();
+
+		CSkinnedAlgos::prepareSkin(mesh->mSkin,
+			reinterpret_cast<float const*>(data.weightData), data.boneIndexData,
+			data.weightStride, data.boneIndexStride, data.vertexCount, *data.skinInfo);
+		;;printf("skin prepared: %u groups, %u weights pruned\n", (unsigned)mesh->mSkin.groups.size(), mesh->mSkin.prunedWeights);
 
 		;;printf("skinInfo processed\n");
 	}
+	calcBounds(*mesh);
+	return mesh;
+}
+
+std::auto_ptr<RenderableMesh> prepareInstance(RenderContext& rc, RenderableMesh const& source)
+{
+	std::auto_ptr<RenderableMesh> mesh(new RenderableMesh(source.mBlueprint));
+	mesh->mSource = &source;
+	mesh->mBoundCenter = source.mBoundCenter;
+	mesh->mBoundRadius = source.mBoundRadius;
+	if(!source.mAmplifiedVertexData[0])
+		return mesh;
+
+	// attributes skinning does not write come from the source buffers
+	size_t size = source.mAmplifiedVertexStride * source.mBlueprint.vertexCount;
+	mesh->mAmplifiedVertexDecl = source.mAmplifiedVertexDecl;
+	mesh->mAmplifiedVertexStride = source.mAmplifiedVertexStride;
+	mesh->mAmplifiedRotation.reset(source.mAmplifiedRotation.count());
+	for(unsigned q = 0; q < mesh->mAmplifiedRotation.count(); ++q)
+	{
+		mesh->mAmplifiedVertexData[q] = new unsigned char[size];
+		memcpy(mesh->mAmplifiedVertexData[q], source.mAmplifiedVertexData[0], size);
+	}
+	mesh->mAmplifiedBufferIndex = mesh->mAmplifiedRotation.current();
+	sceKernelDcacheWritebackAll();
 	return mesh;
 }
 
@@ -211,6 +449,17 @@ namespace {
 //;;printf("!toNative\n");
 	}
 
+	void toNativeTextures(BaseEffect::Input::Surface& dst, RenderableScene const& scene, mutalisk::data::shader_fixed const& src)
+	{
+		dst.diffuseTexture = 0;
+		dst.envmapTexture = 0;
+		// textures that failed to load have no renderable and are left out
+		if(src.diffuseTexture != ~0U && scene.mResources.textures[src.diffuseTexture].renderable.get())
+			dst.diffuseTexture = &scene.mResources.textures[src.diffuseTexture].renderable->mBlueprint;
+		if(src.envmapTexture != ~0U && scene.mResources.textures[src.envmapTexture].renderable.get())
+			dst.envmapTexture = &scene.mResources.textures[src.envmapTexture].renderable->mBlueprint;
+	}
+
 	void toNative(BaseEffect::Input::Surface& dst, RenderableScene const& scene, mutalisk::data::shader_fixed const& src)
 	{
 //;;printf("$blastSurfaceInputs -- toNative(%d, %d, %d)\n", (int)&dst, (int)&scene, (int)&src);
@@ -224,12 +473,7 @@ namespace {
 
 //		printf(" src.diffuseTexture = %x\n", src.diffuseTexture);
 
-		dst.diffuseTexture = 0;
-		dst.envmapTexture = 0;
-		if(src.diffuseTexture != ~0U)
-			dst.diffuseTexture = &scene.mResources.textures[src.diffuseTexture].renderable->mBlueprint;
-		if(src.envmapTexture != ~0U)
-			dst.envmapTexture = &scene.mResources.textures[src.envmapTexture].renderable->mBlueprint;
+		toNativeTextures(dst, scene, src);
 //		printf(" dst.diffuseTexture = %x\n", dst.diffuseTexture);
 
 //		dst.diffuseTexture = (src.diffuseTexture != ~0U)? scene.mResources.textures[src.diffuseTexture] : 0;
@@ -360,6 +604,8 @@ namespace {
 		{
 			vertexData = mesh.mAmplifiedVertexData[mesh.mAmplifiedBufferIndex];
 			vertexFlag = mesh.mAmplifiedVertexDecl;
+			if(mesh.mBlueprint.skinInfo)
+				mesh.mAmplifiedRotation.markDrawn(gFrameFence);
 		}
 
 		int indexCount = 0;
@@ -385,69 +631,119 @@ typedef RenderableScene	RenderableSceneT;
 typedef RenderContext		RenderContextT;
 #include "../Renderer.h"
 
-void render(RenderContext& rc, RenderableScene const& scene, int maxActors)
-{
-	static bool animatedActors = true;//gSettings.forceAnimatedActors;
-	static bool animatedCamera = true;//gSettings.forceAnimatedCamera;
+bool gReuseMirrorLists = true;
 
-//;;printf("$render\n");
-	Vec3 cameraPos; cameraPos.x = cameraPos.y = cameraPos.z = 0.0f;
-	if(scene.mState.activeCameraIndex != ~0U)
+namespace {
+	// what a pass builds for its visible actors; render() keeps the lists of
+	// its last pass, a mirror pass of the same scene and frame starts from them
+	struct PassLists
 	{
-		MatrixT nativeMatrix;
-		toNative(nativeMatrix, scene.mState.cameraMatrix);
+		PassLists() : scene(0), frame(0) {}
 
-		ASSERT(scene.mState.activeCameraIndex >= 0 && scene.mState.activeCameraIndex < scene.mBlueprint.cameras.size());
-		setProjection(rc,
-			scene.mBlueprint.cameras[scene.mState.activeCameraIndex].fov,
-			scene.mBlueprint.cameras[scene.mState.activeCameraIndex].aspect);
-		setCameraMatrix(rc, nativeMatrix);
+		void clear(RenderableScene const* scene_)
+		{
+			scene = scene_;
+			frame = gFrameFence.pending();
+			visibleActors.resize(0);
+			instanceInputs.resize(0);
+			surfaceInputs.resize(0);
+			bgRenderBlocks.resize(0); fgRenderBlocks.resize(0);
+			opaqueRenderBlocks.resize(0); transparentRenderBlocks.resize(0);
+		}
 
-		cameraPos = scene.mState.cameraMatrix.Move;
-	}
-/*	{
-		MatrixT nativeCameraMatrix;
-		MatrixT nativeProjMatrix;
-		toNative(nativeCameraMatrix, scene.mState.cameraMatrix);
-		toNative(nativeProjMatrix, scene.mState.projMatrix);
+		RenderableScene const*							scene;
+		GpuFence::ValueT								frame;
+		std::vector<mutalisk::data::scene::Actor const*> visibleActors;
+		std::vector<InstanceInput>						instanceInputs;
+		std::vector<BaseEffect::Input::Surface>			surfaceInputs;
+		std::vector<RenderBlock>						bgRenderBlocks, opaqueRenderBlocks, transparentRenderBlocks, fgRenderBlocks;
+	};
+	PassLists gMainPass;
+	PassLists gMirrorPass;
+
+	struct ReflectionStats
+	{
+		ReflectionStats() : culled(0) { frames[0] = frames[1] = 0; time[0] = time[1] = 0; }
+		unsigned frames[2];		// [full pass, reused lists]
+		unsigned time[2];		// microseconds
+		unsigned culled;		// actors behind the mirror plane
+	};
+	ReflectionStats gReflectionStats;
+
+	// returns the camera position
+	Vec3 setCamera(RenderContext& rc, RenderableScene const& scene, CTransform::t_matrix const& cameraMatrix)
+	{
+		Vec3 cameraPos; cameraPos.x = cameraPos.y = cameraPos.z = 0.0f;
+		if(scene.mState.activeCameraIndex != ~0U)
+		{
+			MatrixT nativeMatrix;
+			toNative(nativeMatrix, cameraMatrix);
 
-		setProjectionMatrix(rc, nativeMatrix);
-		setCameraMatrix(rc, nativeMatrix);
+			ASSERT(scene.mState.activeCameraIndex >= 0 && scene.mState.activeCameraIndex < scene.mBlueprint.cameras.size());
+			setProjection(rc,
+				scene.mBlueprint.cameras[scene.mState.activeCameraIndex].fov,
+				scene.mBlueprint.cameras[scene.mState.activeCameraIndex].aspect);
+			setCameraMatrix(rc, nativeMatrix);
 
-		cameraPos = scene.mState.cameraMatrix.Move;
+			cameraPos = cameraMatrix.Move;
+		}
+		return cameraPos;
 	}
-*/
-//;;printf(" render -- 1\n");
-
-	static std::vector<InstanceInput> instanceInputs;
-	static std::vector<BaseEffect::Input::Surface> surfaceInputs;
-	static std::vector<RenderBlock> bgRenderBlocks, opaqueRenderBlocks, transparentRenderBlocks, fgRenderBlocks;
 
-	instanceInputs.resize(0);
-	surfaceInputs.resize(0); 
-	bgRenderBlocks.resize(0); fgRenderBlocks.resize(0); 
-	opaqueRenderBlocks.resize(0); transparentRenderBlocks.resize(0); 
-
-	static std::vector<mutalisk::data::scene::Actor const*> visibleActors;
-	visibleActors.resize(0);
-
-	RenderContext& camera = rc; // @TBD:
-	findVisibleActors(camera, 0) (scene.mBlueprint.actors, visibleActors);
-//;;printf(" render -- findVisibleActors\n");
-	blastInstanceInputs(scene, camera) (visibleActors, instanceInputs);
-//;;printf(" render -- blastInstanceInputs\n");
-	blastSurfaceInputs(scene, 0) (visibleActors, surfaceInputs);
-//;;printf(" render -- blastSurfaceInputs\n");
-	blastRenderBlocks(scene, cameraPos) (visibleActors, bgRenderBlocks, opaqueRenderBlocks, transparentRenderBlocks, fgRenderBlocks);
-//;;printf(" render -- blastRenderBlocks\n");
-	sortRenderBlocks()(transparentRenderBlocks);
-//;;printf(" render -- sortRenderBlocks\n");
-	if(instanceInputs.empty() || surfaceInputs.empty())
+	// actorIndex limits the pass to one actor, ~0U takes all active ones
+	void collect(RenderContext& rc, RenderableScene const& scene, Vec3 const& cameraPos, PassLists& lists, unsigned actorIndex = ~0U)
 	{
-		ASSERT(visibleActors.empty());
+		lists.clear(&scene);
+
+		RenderContext& camera = rc; // @TBD:
+		{
+			MUTALISK_PROFILE_ZONE("render.findVisibleActors");
+			findVisibleActors(camera, 0) (scene.mBlueprint.actors, lists.visibleActors);
+			if(actorIndex != ~0U)
+			{
+				size_t kept = 0;
+				for(size_t q = 0; q < lists.visibleActors.size(); ++q)
+					if(lists.visibleActors[q] == &scene.mBlueprint.actors[actorIndex])
+						lists.visibleActors[kept++] = lists.visibleActors[q];
+				lists.visibleActors.resize(kept);
+			}
+		}
+	//;;printf(" render -- findVisibleActors\n");
+		{
+			MUTALISK_PROFILE_ZONE("render.blastInstanceInputs");
+			blastInstanceInputs(scene, camera) (lists.visibleActors, lists.instanceInputs);
+		}
+	//;;printf(" render -- blastInstanceInputs\n");
+		{
+			MUTALISK_PROFILE_ZONE("render.blastSurfaceInputs");
+			unsigned surfaceStartTime = sceKernelGetSystemTimeLow();
+			blastSurfaceInputs(scene, 0) (lists.visibleActors, lists.surfaceInputs);
+			SurfaceCache::get(scene).stats.time += sceKernelGetSystemTimeLow() - surfaceStartTime;
+		}
+	//;;printf(" render -- blastSurfaceInputs\n");
+		{
+			MUTALISK_PROFILE_ZONE("render.blastRenderBlocks");
+			blastRenderBlocks(scene, cameraPos) (lists.visibleActors,
+				lists.bgRenderBlocks, lists.opaqueRenderBlocks, lists.transparentRenderBlocks, lists.fgRenderBlocks);
+		}
+	//;;printf(" render -- blastRenderBlocks\n");
+		{
+			MUTALISK_PROFILE_ZONE("render.sortRenderBlocks");
+			sortRenderBlocks()(lists.transparentRenderBlocks);
+		}
+	//;;printf(" render -- sortRenderBlocks\n");
 	}
-	else
+
+	// surfaces may come from another pass, blocks index into them
+	void draw(RenderContext& rc, RenderableScene const& scene, PassLists const& lists,
+		std::vector<BaseEffect::Input::Surface> const& surfaceInputs)
 	{
+		if(lists.instanceInputs.empty() || surfaceInputs.empty())
+		{
+			ASSERT(lists.instanceInputs.empty());
+			return;
+		}
+
 		BaseEffect::Input::BufferControl background;
 		background.colorWriteEnable = true;
 		background.zWriteEnable = false;
@@ -478,22 +774,186 @@ void render(RenderContext& rc, RenderableScene const& scene, int maxActors)
 		foreground.zReadEnable = false;
 		foreground.zEqual = false;
 
+		MUTALISK_PROFILE_ZONE("render.drawRenderBlocks");
 		drawRenderBlocks draw(rc, scene, 
-			&instanceInputs[0], instanceInputs.size(), &surfaceInputs[0], surfaceInputs.size());
+			&lists.instanceInputs[0], lists.instanceInputs.size(), &surfaceInputs[0], surfaceInputs.size());
 		
-//;;printf(" render -- drawRenderBlocks\n");
-		draw(opaqueRenderBlocks,		opaque[0], opaque[1]);
-//;;printf(" render -- draw 1\n");
-		draw(bgRenderBlocks,			background, background);
-//;;printf(" render -- draw 2\n");
-		draw(transparentRenderBlocks,	transparent[0], transparent[1]);
-//;;printf(" render -- draw 3\n");
-//		draw(fgRenderBlocks,			foreground, foreground);
-//;;printf(" render -- draw 4\n");
+	//;;printf(" render -- drawRenderBlocks\n");
+		draw(lists.opaqueRenderBlocks,		opaque[0], opaque[1]);
+	//;;printf(" render -- draw 1\n");
+		draw(lists.bgRenderBlocks,			background, background);
+	//;;printf(" render -- draw 2\n");
+		draw(lists.transparentRenderBlocks,	transparent[0], transparent[1]);
+	//;;printf(" render -- draw 3\n");
+	//	draw(lists.fgRenderBlocks,			foreground, foreground);
+	//;;printf(" render -- draw 4\n");
+	}
+
+	// signed distance of the bounding sphere center to the plane, false when
+	// the mesh has no bounds or draws vertices written on the cpu (skinning,
+	// sprite and character renderers)
+	bool planeDistance(float& distance, float& radius, RenderableMesh const* mesh, MatrixT const& world,
+		Vec3 const& planePoint, Vec3 const& planeNormal)
+	{
+		if(!mesh || mesh->mBoundRadius < 0.0f || mesh->mAmplifiedVertexData[mesh->mAmplifiedBufferIndex])
+			return false;
+
+		Vec3 const& c = mesh->mBoundCenter;
+		Vec3 center;
+		center.x = world.x.x * c.x + world.y.x * c.y + world.z.x * c.z + world.w.x - planePoint.x;
+		center.y = world.x.y * c.x + world.y.y * c.y + world.z.y * c.z + world.w.y - planePoint.y;
+		center.z = world.x.z * c.x + world.y.z * c.y + world.z.z * c.z + world.w.z - planePoint.z;
+		distance = Vec3_dot(&center, const_cast<Vec3*>(&planeNormal));
+
+		float scaleSq = 0.0f;
+		ScePspFVector4 const* axes[] = { &world.x, &world.y, &world.z };
+		for(int q = 0; q < 3; ++q)
+		{
+			float lengthSq = axes[q]->x * axes[q]->x + axes[q]->y * axes[q]->y + axes[q]->z * axes[q]->z;
+			if(lengthSq > scaleSq)
+				scaleSq = lengthSq;
+		}
+		radius = mesh->mBoundRadius * sqrtf(scaleSq);
+		return true;
+	}
+
+	void copyReflectedBlocks(std::vector<RenderBlock> const& src, std::vector<RenderBlock>& dst, std::vector<unsigned> const& instanceMap)
+	{
+		for(size_t q = 0; q < src.size(); ++q)
+			if(instanceMap[src[q].instanceIndex] != ~0U)
+			{
+				dst.push_back(src[q]);
+				dst.back().instanceIndex = instanceMap[src[q].instanceIndex];
+			}
+	}
+}
+
+void render(RenderContext& rc, RenderableScene const& scene, int maxActors)
+{
+	static bool animatedActors = true;//gSettings.forceAnimatedActors;
+	static bool animatedCamera = true;//gSettings.forceAnimatedCamera;
+
+//;;printf("$render\n");
+	Vec3 cameraPos = setCamera(rc, scene, scene.mState.cameraMatrix);
+/*	{
+		MatrixT nativeCameraMatrix;
+		MatrixT nativeProjMatrix;
+		toNative(nativeCameraMatrix, scene.mState.cameraMatrix);
+		toNative(nativeProjMatrix, scene.mState.projMatrix);
+
+		setProjectionMatrix(rc, nativeMatrix);
+		setCameraMatrix(rc, nativeMatrix);
+
+		cameraPos = scene.mState.cameraMatrix.Move;
 	}
+*/
+//;;printf(" render -- 1\n");
+
+	collect(rc, scene, cameraPos, gMainPass);
+	draw(rc, scene, gMainPass, gMainPass.surfaceInputs);
 //;;printf("!render\n");
 }
 
+void renderReflection(RenderContext& rc, RenderableScene const& scene, Mat34 const& reflection,
+	Vec3 const& planePoint, Vec3 const& planeNormal, unsigned actorIndex)
+{
+	MUTALISK_PROFILE_ZONE("render.reflection");
+	unsigned startTime = sceKernelGetSystemTimeLow();
+
+	CTransform::t_matrix cameraMatrix;
+	Mat34_mul(&cameraMatrix, const_cast<Mat34*>(&reflection), const_cast<CTransform::t_matrix*>(&scene.mState.cameraMatrix));
+	RenderContext mirror = rc;
+
+	if(!gReuseMirrorLists)
+	{
+		// the whole pipeline again with the reflected camera
+		Vec3 cameraPos = setCamera(mirror, scene, cameraMatrix);
+		collect(mirror, scene, cameraPos, gMirrorPass, actorIndex);
+		draw(mirror, scene, gMirrorPass, gMirrorPass.surfaceInputs);
+
+		++gReflectionStats.frames[0];
+		gReflectionStats.time[0] += sceKernelGetSystemTimeLow() - startTime;
+		return;
+	}
+
+	if(gMainPass.scene != &scene || gMainPass.frame != gFrameFence.pending())
+	{
+		// the scene was not drawn this frame, its lists are built undrawn
+		Vec3 cameraPos = setCamera(mirror, scene, scene.mState.cameraMatrix);
+		collect(mirror, scene, cameraPos, gMainPass);
+	}
+	Vec3 cameraPos = setCamera(mirror, scene, cameraMatrix);
+
+	// the camera side of the plane is the one reflected
+	Vec3 cameraOffset;
+	Vec3_sub(&cameraOffset, const_cast<Vec3*>(&scene.mState.cameraMatrix.Move), const_cast<Vec3*>(&planePoint));
+	float const cameraSide = (Vec3_dot(&cameraOffset, const_cast<Vec3*>(&planeNormal)) < 0.0f)? -1.0f: 1.0f;
+
+	// instances keep their world matrices, only the view changes
+	static std::vector<unsigned> instanceMap;
+	static std::vector<Vec3> instancePositions;
+	instanceMap.assign(gMainPass.visibleActors.size(), ~0U);
+	instancePositions.resize(0);
+	gMirrorPass.clear(&scene);
+	{
+		MUTALISK_PROFILE_ZONE("render.reflectInstances");
+		for(size_t q = 0; q < gMainPass.visibleActors.size(); ++q)
+		{
+			mutalisk::data::scene::Actor const& actor = *gMainPass.visibleActors[q];
+			if(actorIndex != ~0U && &actor != &scene.mBlueprint.actors[actorIndex])
+				continue;
+
+			MatrixT const& world = gMainPass.instanceInputs[q].geometryMatrices[BaseEffect::WorldMatrix];
+			float distance, radius;
+			if(planeDistance(distance, radius, scene.renderableMesh(actor.meshIndex), world, planePoint, planeNormal) &&
+				distance * cameraSide < -radius)
+			{
+				++gReflectionStats.culled;
+				continue;
+			}
+
+			instanceMap[q] = gMirrorPass.instanceInputs.size();
+			gMirrorPass.visibleActors.push_back(&actor);
+			gMirrorPass.instanceInputs.resize(gMirrorPass.instanceInputs.size() + 1);
+			setWorldMatrix(gMirrorPass.instanceInputs.back().geometryMatrices, mirror, world);
+			instancePositions.resize(instancePositions.size() + 1);
+			getTranslation(instancePositions.back(), world);
+		}
+	}
+	{
+		MUTALISK_PROFILE_ZONE("render.reflectRenderBlocks");
+		copyReflectedBlocks(gMainPass.bgRenderBlocks, gMirrorPass.bgRenderBlocks, instanceMap);
+		copyReflectedBlocks(gMainPass.opaqueRenderBlocks, gMirrorPass.opaqueRenderBlocks, instanceMap);
+		copyReflectedBlocks(gMainPass.transparentRenderBlocks, gMirrorPass.transparentRenderBlocks, instanceMap);
+		if(!instancePositions.empty())
+			rekeyRenderBlocks(cameraPos, &instancePositions[0])(gMirrorPass.transparentRenderBlocks);
+	}
+
+	draw(mirror, scene, gMirrorPass, gMainPass.surfaceInputs);
+
+	++gReflectionStats.frames[1];
+	gReflectionStats.time[1] += sceKernelGetSystemTimeLow() - startTime;
+}
+
+void printReflectionStats()
+{
+	ReflectionStats const& stats = gReflectionStats;
+	for(int reused = 0; reused < 2; ++reused)
+		if(stats.frames[reused])
+			printf("mirror pass, %s: %u frames, %.3f ms per frame\n", reused? "reused lists": "full pass",
+				stats.frames[reused], stats.time[reused] / (1000.0f * stats.frames[reused]));
+	if(stats.frames[1])
+		printf("mirror pass: %u actors culled behind the plane\n", stats.culled);
+}
+
+void printSurfaceStats(RenderableScene const& scene, char const* name)
+{
+	SurfaceCache::Stats const& stats = SurfaceCache::get(scene).stats;
+	float frames = (stats.frames > 0)? stats.frames: 1.0f;
+	printf("%s surfaces: %u frames, %.2f conversions/frame, %.2f cached/frame, %.3f ms/frame\n", name, stats.frames,
+		stats.conversions / frames, stats.reuses / frames, stats.time / (frames * 1000.0f));
+}
+
 ////////////////////////////////////////////////
 namespace {
 struct pspvfpu_context *sp_vfpucontext;
@@ -602,6 +1062,25 @@ inline void xformPosNormal_fn(ScePspFMatrix4 const* boneMatrix, float weight)
 	   "vadd.t C110, C110, C200\n"
 	   :: "m"(*boneMatrix), "r"(weight));
 }
+// single bone with weight 1, in place of xformPosNormal_fn
+inline void xformPosNormal_single(ScePspFMatrix4 const* boneMatrix)
+{
+	__asm__ volatile (
+       "lv.q   C000, 0  + %0\n"
+       "lv.q   C010, 16 + %0\n"
+       "lv.q   C020, 32 + %0\n"
+       "lv.q   C030, 48 + %0\n"
+
+       "vdot.t S100, R000, C120\n"
+       "vdot.t S101, R001, C120\n"
+       "vdot.t S102, R002, C120\n"
+	   "vadd.t C100, C030, C100\n"
+
+       "vdot.t S110, R000, C130\n"
+       "vdot.t S111, R001, C130\n"
+       "vdot.t S112, R002, C130\n"
+	   :: "m"(*boneMatrix));
+}
 inline void xformPosNormal_end(ScePspFVector4* pos, ScePspFVector4* normal)
 {
 	__asm__ volatile (
@@ -617,7 +1096,8 @@ static ScePspFVector4 accumN3 = {0.0f, 0.0f, 0.0f, 0.0f};
 void nativeProcessSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNormals, float const* srcWeights, unsigned char const* srcBoneIndices,
 	Vec3 *dstPositions, Vec3* dstNormals, size_t srcVertexStride, size_t srcWeightStride, size_t srcBoneIndexStride,
 	size_t dstVertexStride, size_t vertexCount,
-	mutalisk::data::skin_info const& skinInfo, CSkinnedAlgos::BoneMapT const& boneMap, CTransform::t_matrix const* matrices)
+	mutalisk::data::skin_info const& skinInfo, CSkinnedAlgos::BoneMapT const& boneMap, CTransform::t_matrix const* matrices,
+	unsigned maxInfluences)
 {
 	if (sp_vfpucontext == NULL)
 		sp_vfpucontext = pspvfpu_initcontext();
@@ -651,6 +1131,13 @@ void nativeProcessSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNormals, flo
 
 	unsigned char* dstPositionsRaw = reinterpret_cast<unsigned char*>(dstPositions);
 	unsigned char* dstNormalsRaw = reinterpret_cast<unsigned char*>(dstNormals);
+
+	// reduced influences go through a list of picked weights, all of them otherwise
+	enum { MaxWeights = 8 };
+	unsigned char picked[MaxWeights];
+	unsigned const keep = (maxInfluences < MaxWeights)? maxInfluences: MaxWeights;
+	bool const reduced = (keep > 0 && keep < skinInfo.weightsPerVertex);
+
 	for( size_t q = 0; q < vertexCount; ++q )
 	{
 		ScePspFVector3 const* pos3 = reinterpret_cast<ScePspFVector3 const*>(srcPositionsRaw);
@@ -658,14 +1145,29 @@ void nativeProcessSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNormals, flo
 
 		float const* weights = reinterpret_cast<float const*>(srcWeightsRaw);
 		unsigned char const* boneIndices = srcBoneIndicesRaw;
+
+		size_t influences = skinInfo.weightsPerVertex;
+		float weightScale = 1.0f;
+		if( reduced )
+		{
+			// the dropped weight is spread over the kept ones
+			influences = CSkinnedAlgos::strongestInfluences( weights, skinInfo.weightsPerVertex, keep, picked );
+			float total = 0.0f, kept = 0.0f;
+			for( size_t w = 0; w < skinInfo.weightsPerVertex; ++w )
+				total += weights[w];
+			for( size_t w = 0; w < influences; ++w )
+				kept += weights[picked[w]];
+			weightScale = (kept > 0.0f)? total / kept: 0.0f;
+		}
 		
 		pspvfpu_use_matrices(0, 0, 0);
 		xformPosNormal_begin(pos3, nrm3);
-		for( size_t w = 0; w < skinInfo.weightsPerVertex; ++w )
+		for( size_t k = 0; k < influences; ++k )
 		{
+			size_t w = reduced? picked[k]: k;
 			unsigned char boneId = boneIndices[w];
 			ASSERT(boneId < worldMatrices.size());
-			float boneWeight = weights[w];
+			float boneWeight = weights[w] * weightScale;
 
 			if(boneWeight < 0.001f)
 				continue;
@@ -697,10 +1199,80 @@ void nativeProcessSkinMesh(Vec3 const* srcPositions, Vec3 const* srcNormals, flo
 		dstNormalsRaw += dstVertexStride;
 	}
 }
+
+void nativeProcessPreparedSkin(Vec3 const* srcPositions, Vec3 const* srcNormals, Vec3* dstPositions, Vec3* dstNormals,
+	size_t srcVertexStride, size_t dstVertexStride, PreparedSkin const& skin,
+	CSkinnedAlgos::BoneMapT const& boneMap, CTransform::t_matrix const* matrices, unsigned maxInfluences)
+{
+	if (sp_vfpucontext == NULL)
+		sp_vfpucontext = pspvfpu_initcontext();
+
+	static std::vector<ScePspFMatrix4> worldMatrices;
+	worldMatrices.resize(boneMap.size());
+	for( size_t i = 0; i < boneMap.size(); ++i )
+		toNative(worldMatrices[i], matrices[ boneMap[i].second ] * skin.inverseBindMatrices[ boneMap[i].first ]);
+
+	unsigned char const* srcPositionsRaw = reinterpret_cast<unsigned char const*>(srcPositions);
+	unsigned char const* srcNormalsRaw = reinterpret_cast<unsigned char const*>(srcNormals);
+	unsigned char* dstPositionsRaw = reinterpret_cast<unsigned char*>(dstPositions);
+	unsigned char* dstNormalsRaw = reinterpret_cast<unsigned char*>(dstNormals);
+
+	for( size_t g = 0; g < skin.groups.size(); ++g )
+	{
+		PreparedSkin::Group const& group = skin.groups[g];
+		unsigned const stride = group.influences;
+		unsigned const n = (maxInfluences > 0 && maxInfluences < stride)? maxInfluences: stride;
+		bool const single = (stride == 1);
+		bool const renormalize = (n < stride);
+
+		size_t const vertexCount = group.vertices.size();
+		for( size_t q = 0; q < vertexCount; ++q )
+		{
+			size_t const v = group.vertices[q];
+			if( stride == 0 )
+			{ // no influences, see prepareSkin
+				float* dstPos = reinterpret_cast<float*>(dstPositionsRaw + v * dstVertexStride);
+				float* dstNrm = reinterpret_cast<float*>(dstNormalsRaw + v * dstVertexStride);
+				dstPos[0] = dstPos[1] = dstPos[2] = 0.0f;
+				dstNrm[0] = dstNrm[1] = dstNrm[2] = 0.0f;
+				continue;
+			}
+			ScePspFVector3 const* pos3 = reinterpret_cast<ScePspFVector3 const*>(srcPositionsRaw + v * srcVertexStride);
+			ScePspFVector3 const* nrm3 = reinterpret_cast<ScePspFVector3 const*>(srcNormalsRaw + v * srcVertexStride);
+			unsigned char const* boneIds = &group.boneIds[q * stride];
+			float const* weights = &group.weights[q * stride];
+
+			float scale = 1.0f;
+			if( renormalize )
+			{
+				float kept = 0.0f;
+				for( unsigned w = 0; w < n; ++w )
+					kept += weights[w];
+				scale = (kept > 0.0f)? 1.0f / kept: 0.0f;
+			}
+
+			pspvfpu_use_matrices(0, 0, 0);
+			xformPosNormal_begin(pos3, nrm3);
+			if( single )
+				xformPosNormal_single(&worldMatrices[boneIds[0]]);
+			else
+				for( unsigned w = 0; w < n; ++w )
+					xformPosNormal_fn(&worldMatrices[boneIds[w]], weights[w] * scale);
+			pspvfpu_use_matrices(0, 0, 0);
+			xformPosNormal_end(&accumP3, &accumN3);
+
+			float* dstPos = reinterpret_cast<float*>(dstPositionsRaw + v * dstVertexStride);
+			float* dstNrm = reinterpret_cast<float*>(dstNormalsRaw + v * dstVertexStride);
+			dstPos[0] = accumP3.x; dstPos[1] = accumP3.y; dstPos[2] = accumP3.z;
+			dstNrm[0] = accumN3.x; dstNrm[1] = accumN3.y; dstNrm[2] = accumN3.z;
+		}
+	}
+}
 }
 
 
-void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMap, CTransform::t_matrix const* matrices)
+void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMap, CTransform::t_matrix const* matrices,
+	unsigned maxInfluences)
 {
 	assert(mesh.mBlueprint.skinInfo);
 	assert(!boneMap.empty());
@@ -716,12 +1288,25 @@ void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMa
 	size_t weightsOffset = 0U;
 	size_t boneIndicesOffset = 0U;
 
-	mesh.mAmplifiedBufferIndex = 1 - mesh.mAmplifiedBufferIndex;
+	mesh.mAmplifiedBufferIndex = mesh.mAmplifiedRotation.acquire(gFrameFence);
 	unsigned char* dstRaw = mesh.mAmplifiedVertexData[mesh.mAmplifiedBufferIndex];
 	unsigned char const* srcRaw = mesh.mBlueprint.vertexData;
 	unsigned char const* srcBoneWeights = mesh.mBlueprint.weightData;
 	unsigned char const* srcBoneIndices = mesh.mBlueprint.boneIndexData;
 
+	if(gPreparedSkinning && !mesh.skin().empty())
+	{
+		nativeProcessPreparedSkin(
+			reinterpret_cast<Vec3 const*>(srcRaw + positionsOffset),
+			reinterpret_cast<Vec3 const*>(srcRaw + normalsOffset),
+			reinterpret_cast<Vec3*>(dstRaw + positionsOffset),
+			reinterpret_cast<Vec3*>(dstRaw + normalsOffset),
+			mesh.mBlueprint.vertexStride, mesh.mAmplifiedVertexStride,
+			mesh.skin(), boneMap, matrices, maxInfluences);
+		sceKernelDcacheWritebackRange(dstRaw, mesh.mAmplifiedVertexStride * mesh.mBlueprint.vertexCount);
+		return;
+	}
+
 //	processSkinMesh(
 	nativeProcessSkinMesh(
 		reinterpret_cast<Vec3 const*>(srcRaw + positionsOffset),
@@ -739,7 +1324,9 @@ void CSkinnedAlgos::processSkinMesh(RenderableMesh& mesh, BoneMapT const& boneMa
 		mesh.mAmplifiedVertexStride,											// dstVertexStride
 		mesh.mBlueprint.vertexCount,
 
-		*mesh.mBlueprint.skinInfo, boneMap, matrices);
+		*mesh.mBlueprint.skinInfo, boneMap, matrices, maxInfluences);
+	// the GE reads memory, not the cache
+	sceKernelDcacheWritebackRange(dstRaw, mesh.mAmplifiedVertexStride * mesh.mBlueprint.vertexCount);
 }
 
 } // namespace mutalisk
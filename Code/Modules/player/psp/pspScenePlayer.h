@@ -12,11 +12,49 @@
 
 #include "../Animators.h"
 #include "../AnimatorAlgos.h"
+#include "../ResourceCache.h"
+#include "../PreparedSkin.h"
+#include "../BufferRotation.h"
 
 namespace mutalisk
 {
 	extern bool gDelayedTextureLoading;
 
+#ifndef MUTALISK_SKINNED_BUFFERS
+#define MUTALISK_SKINNED_BUFFERS 2
+#endif
+
+	// Fence over the display lists of the main loop. The loop reports every
+	// list it closes and every sceGuSync, dynamic buffers use it to know which
+	// frames the GE may still read:
+	//
+	//	update		-- skinning acquires buffers
+	//	sync()		-- replaces sceGuSync(0,0)
+	//	sceGuStart
+	//	render		-- draws mark buffers with pending()
+	//	sceGuFinish
+	//	submit()
+	//
+	// A loop that reports nothing keeps every buffer in use by a list that is
+	// never submitted; waits return at once and buffers rotate as before.
+	class PspFrameFence : public GpuFence
+	{
+	public:
+		PspFrameFence() : mSubmitted(0), mCompleted(0) {}
+
+		virtual ValueT pending() const { return mSubmitted + 1; }
+		virtual ValueT completed() const { return mCompleted; }
+		virtual void wait(ValueT value);
+
+		void submit() { ++mSubmitted; }
+		void sync();
+
+	private:
+		ValueT	mSubmitted;
+		ValueT	mCompleted;
+	};
+	extern PspFrameFence gFrameFence;
+
 #ifndef AP
 #define AP_DEFINED_LOCALY
 #define AP std::auto_ptr
@@ -40,19 +78,27 @@ struct RenderContext
 struct RenderableMesh
 {
 	RenderableMesh(mutalisk::data::mesh const& blueprint)
-		: mBlueprint(blueprint), mAmplifiedVertexDecl(0), mAmplifiedBufferIndex(0), mUserData(0) {
-		mAmplifiedVertexData[0] = 0;
-		mAmplifiedVertexData[1] = 0; }
+		: mBlueprint(blueprint), mAmplifiedVertexDecl(0), mAmplifiedBufferIndex(0), mUserData(0), mSource(0), mBoundRadius(-1.0f) {
+		for(unsigned q = 0; q < BufferRotation::MaxBuffers; ++q)
+			mAmplifiedVertexData[q] = 0;
+		mBoundCenter.x = mBoundCenter.y = mBoundCenter.z = 0.0f; }
 	~RenderableMesh() {
-		delete[] mAmplifiedVertexData[0];
-		delete[] mAmplifiedVertexData[1];
+		for(unsigned q = 0; q < BufferRotation::MaxBuffers; ++q)
+			delete[] mAmplifiedVertexData[q];
 		delete[] mUserData; }
 	mutalisk::data::mesh const&			mBlueprint;
-	unsigned char*						mAmplifiedVertexData[2];
+	unsigned char*						mAmplifiedVertexData[BufferRotation::MaxBuffers];
 	int									mAmplifiedVertexDecl;
 	unsigned							mAmplifiedVertexStride;
 	unsigned							mAmplifiedBufferIndex;
+	BufferRotation						mAmplifiedRotation;		// of skinned output, owners that toggle mAmplifiedBufferIndex themselves leave it alone
 	unsigned char*						mUserData;
+	PreparedSkin						mSkin;
+	RenderableMesh const*				mSource;				// mesh an instance copy was made from, it keeps the skin
+	Vec3								mBoundCenter;			// bounding sphere in mesh space, used to cull
+	float								mBoundRadius;			// negative when unknown: skinned or not float positions
+
+	PreparedSkin const& skin() const { return (mSource)? mSource->skin(): mSkin; }
 
 private:
 	RenderableMesh(RenderableMesh const& c);
@@ -77,8 +123,31 @@ struct RenderableScene;
 AP<RenderableScene> prepare(RenderContext& rc, mutalisk::data::scene const& data, std::string const& pathPrefix = "");
 AP<RenderableMesh> prepare(RenderContext& rc, mutalisk::data::mesh const& data);
 AP<RenderableTexture> prepare(RenderContext& rc, mutalisk::data::texture const& data);
+// another instance of a prepared scene: only skinned meshes are copied, with
+// their own vertex buffers; everything else is shared with source
+AP<RenderableScene> prepareInstance(RenderContext& rc, RenderableScene const& source);
+AP<RenderableMesh> prepareInstance(RenderContext& rc, RenderableMesh const& source);
+
+// textures are shared between all scenes through ResourceCache<data::texture>
+SharedRef<mutalisk::data::texture> loadTexture(std::string const& fileName);
+SharedRef<mutalisk::data::texture> acquireTexture(mutalisk::data::MtxHeader* mtx, unsigned size);
+SharedRef<mutalisk::data::texture> acquireTexture(mutalisk::data::MtxHeader* mtx, unsigned size, unsigned hash);
+void printResourceStats();
 
 void render(RenderContext& rc, RenderableScene const& scene, int maxActors = -1);
+// Draws the scene once more as seen in a mirror, from the lists of its last
+// render() in this frame: instances are transformed by the reflected camera,
+// surfaces are reused and transparent blocks are re-keyed by distance to it.
+// Actors wholly behind the mirror plane are culled; actorIndex limits the
+// pass to one actor, ~0U draws all visible ones. The caller flips culling.
+void renderReflection(RenderContext& rc, RenderableScene const& scene, Mat34 const& reflection,
+	Vec3 const& planePoint, Vec3 const& planeNormal, unsigned actorIndex = ~0U);
+// mirror pass time with reused lists against full passes, see gReuseMirrorLists
+void printReflectionStats();
+// mirror passes go through a full render() when cleared, only to measure
+extern bool gReuseMirrorLists;
+// materials converted to native surface inputs versus served from the cache
+void printSurfaceStats(RenderableScene const& scene, char const* name);
 //	bool animatedActors = true, bool animatedLights = true, int maxActors = -1, int maxLights = -1);
 
 // @HACK: mirror
@@ -0,0 +1,202 @@
+// Checks the Base/Math batch routines and fast approximations against the
+// scalar reference and times both. Exits with 1 when a result is outside
+// its documented bound.
+
+#include <sys/time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// after the system headers, Base/Common/Config.h defines inline away
+extern "C" {
+	#include <Base/Std/Std.h>
+	#include <Base/Math/Math.h>
+	#include <Base/Math/LinInline.h>
+}
+#undef bool
+
+namespace
+{
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+
+	float frand(float lo, float hi) { return lo + (hi - lo) * (rand() / (float)RAND_MAX); }
+
+	Vec3 randomVec3(float range)
+	{
+		Vec3 v;
+		Vec3_setXYZ(&v, frand(-range, range), frand(-range, range), frand(-range, range));
+		return v;
+	}
+
+	double maxDiff(Vec3 const& a, Vec3 const& b)
+	{
+		double d = fabs(a.x - b.x);
+		if(fabs(a.y - b.y) > d) d = fabs(a.y - b.y);
+		if(fabs(a.z - b.z) > d) d = fabs(a.z - b.z);
+		return d;
+	}
+
+	int failures = 0;
+
+	void report(char const* name, double error, double bound, double refTime, double newTime, double n)
+	{
+		bool ok = error <= bound;
+		printf("%-22s err %10.3g (bound %8.3g) %s   ref %8.2f  new %8.2f M/s  x%.2f\n",
+			name, error, bound, ok? "ok  ": "FAIL", n / refTime * 1e-6, n / newTime * 1e-6, refTime / newTime);
+		if(!ok)
+			++failures;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int const count = 100000;
+	int const repeats = 20;
+	double const n = (double)count * repeats;
+
+	std::vector<Vec3> src(count), ref(count), out(count);
+	for(int q = 0; q < count; ++q)
+		src[q] = randomVec3(100.0f);
+
+	// a rotation with exact float entries
+	Mat34 m;
+	Vec3_setXYZ(&m.Move, 3.0f, -2.0f, 5.0f);
+	m.Rot.Row[0].x = 0.36f; m.Rot.Row[0].y = 0.48f; m.Rot.Row[0].z = -0.8f;
+	m.Rot.Row[1].x = -0.8f; m.Rot.Row[1].y = 0.6f; m.Rot.Row[1].z = 0.0f;
+	m.Rot.Row[2].x = 0.48f; m.Rot.Row[2].y = 0.64f; m.Rot.Row[2].z = 0.6f;
+
+	// transform N points by one Mat34
+	double start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			Vec3_setMat34MulVec3(&ref[q], &m, &src[q]);
+	double refTime = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		Vec3_setMat34MulVec3Array(&out[0], &m, &src[0], count);
+	double newTime = seconds() - start;
+	double error = 0.0;
+	for(int q = 0; q < count; ++q)
+		if(maxDiff(ref[q], out[q]) > error) error = maxDiff(ref[q], out[q]);
+	report("Vec3_setMat34MulVec3", error, 1e-4, refTime, newTime, n);
+
+	// normalize N vectors
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			Vec3_normalize(&ref[q], &src[q]);
+	refTime = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		Vec3_normalizeArray(&out[0], &src[0], count);
+	newTime = seconds() - start;
+	error = 0.0;
+	for(int q = 0; q < count; ++q)
+		if(maxDiff(ref[q], out[q]) > error) error = maxDiff(ref[q], out[q]);
+	report("Vec3_normalize", error, 1e-5, refTime, newTime, n);
+
+	// multiply N matrix pairs
+	int const matrices = count / 10;
+	std::vector<Mat34> m0(matrices), m1(matrices), mref(matrices), mout(matrices);
+	for(int q = 0; q < matrices; ++q)
+	{
+		Mat34_setIdentity(&m0[q]);
+		Mat34_setIdentity(&m1[q]);
+		for(int row = 0; row < 3; ++row)
+		{
+			m0[q].Rot.Row[row] = randomVec3(1.0f);
+			m1[q].Rot.Row[row] = randomVec3(1.0f);
+		}
+		m0[q].Move = randomVec3(10.0f);
+		m1[q].Move = randomVec3(10.0f);
+	}
+	start = seconds();
+	for(int r = 0; r < repeats * 10; ++r)
+		for(int q = 0; q < matrices; ++q)
+			Mat34_mul(&mref[q], &m0[q], &m1[q]);
+	refTime = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repeats * 10; ++r)
+		Mat34_mulArray(&mout[0], &m0[0], &m1[0], matrices);
+	newTime = seconds() - start;
+	error = 0.0;
+	for(int q = 0; q < matrices; ++q)
+	{
+		for(int row = 0; row < 3; ++row)
+			if(maxDiff(mref[q].Rot.Row[row], mout[q].Rot.Row[row]) > error) error = maxDiff(mref[q].Rot.Row[row], mout[q].Rot.Row[row]);
+		if(maxDiff(mref[q].Move, mout[q].Move) > error) error = maxDiff(mref[q].Move, mout[q].Move);
+	}
+	report("Mat34_mul", error, 1e-5, refTime, newTime, n);
+
+	// sin and cos over the documented range
+	std::vector<float> angles(count), fref(count), fout(count);
+	for(int q = 0; q < count; ++q)
+		angles[q] = frand(-1000.0f, 1000.0f);
+	angles[0] = 0.0f; angles[1] = 1.5707964f; angles[2] = -3.1415927f;
+
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			fref[q] = mathSin(angles[q]);
+	refTime = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			fout[q] = mathSinFast(angles[q]);
+	newTime = seconds() - start;
+	error = 0.0;
+	for(int q = 0; q < count; ++q)
+	{
+		double e = fabs(sin((double)angles[q]) - fout[q]);
+		if(e > error) error = e;
+	}
+	report("mathSin", error, 1e-6, refTime, newTime, n);
+
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			fref[q] = mathCos(angles[q]);
+	refTime = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			fout[q] = mathCosFast(angles[q]);
+	newTime = seconds() - start;
+	error = 0.0;
+	for(int q = 0; q < count; ++q)
+	{
+		double e = fabs(cos((double)angles[q]) - fout[q]);
+		if(e > error) error = e;
+	}
+	report("mathCos", error, 1e-6, refTime, newTime, n);
+
+	// 1/sqrt relative error from tiny to huge arguments
+	for(int q = 0; q < count; ++q)
+		angles[q] = powf(10.0f, frand(-30.0f, 30.0f));
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			fref[q] = 1.0f / mathSqrt(angles[q]);
+	refTime = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			fout[q] = mathRSqrtFast(angles[q]);
+	newTime = seconds() - start;
+	error = 0.0;
+	for(int q = 0; q < count; ++q)
+	{
+		double exact = 1.0 / sqrt((double)angles[q]);
+		double e = fabs(fout[q] - exact) / exact;
+		if(e > error) error = e;
+	}
+	report("mathRSqrt", error, 5e-6, refTime, newTime, n);
+
+	return failures? 1: 0;
+}
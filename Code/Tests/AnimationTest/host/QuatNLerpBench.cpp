@@ -0,0 +1,126 @@
+// Compares QuatNLerpArray (plain and corrected) with QuatSLinearCombine:
+// worst angular error against slerp for key pairs a given angle apart, and
+// throughput when interpolating a large batch of key pairs.
+
+#include <sys/time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// after the system headers, Base/Common/Config.h defines inline away
+extern "C" {
+	#include <Base/Std/Std.h>
+	#include <Base/Math/Math.h>
+	#include <Base/Math/Quat.h>
+}
+#undef bool
+
+namespace
+{
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+
+	float frand() { return rand() / (float)RAND_MAX; }
+
+	Quat randomQuat()
+	{
+		Quat q;
+		q.x = frand() * 2.0f - 1.0f; q.y = frand() * 2.0f - 1.0f;
+		q.z = frand() * 2.0f - 1.0f; q.w = frand() * 2.0f - 1.0f;
+		QuatNormalize(&q, &q);
+		return q;
+	}
+
+	// rotates q by angle radians around a random axis
+	Quat rotatedBy(Quat q, float angle)
+	{
+		Quat axis = randomQuat();
+		float l = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+		Quat r;
+		r.x = axis.x / l * sinf(angle * 0.5f);
+		r.y = axis.y / l * sinf(angle * 0.5f);
+		r.z = axis.z / l * sinf(angle * 0.5f);
+		r.w = cosf(angle * 0.5f);
+		Quat out;
+		QuatMul(&out, &r, &q);
+		return out;
+	}
+
+	// rotation angle between two unit quaternions, in degrees; from the chord
+	// length, acos of the dot product is too imprecise for small angles
+	double angleBetween(Quat const& a, Quat const& b)
+	{
+		double s = ((double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z + (double)a.w * b.w < 0.0)? -1.0: 1.0;
+		double dx = a.x - s * b.x, dy = a.y - s * b.y, dz = a.z - s * b.z, dw = a.w - s * b.w;
+		double chord = sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+		return 4.0 * asin((chord < 2.0)? chord * 0.5: 1.0) * 180.0 / M_PI;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// accuracy
+	float const anglesDeg[] = { 5.0f, 15.0f, 30.0f, 60.0f, 90.0f, 150.0f };
+	printf("%10s %16s %16s\n", "key angle", "nlerp err deg", "corrected deg");
+	for(unsigned a = 0; a < sizeof(anglesDeg) / sizeof(anglesDeg[0]); ++a)
+	{
+		double maxPlain = 0.0, maxCorrected = 0.0;
+		for(int pair = 0; pair < 200; ++pair)
+		{
+			Quat q0 = randomQuat();
+			Quat q1 = rotatedBy(q0, anglesDeg[a] * (float)M_PI / 180.0f);
+			for(int step = 0; step <= 64; ++step)
+			{
+				float t = step / 64.0f;
+				Quat slerp, plain, corrected;
+				QuatSLinearCombine(&slerp, &q0, &q1, t);
+				QuatNLerpArray(&plain, &q0, &q1, &t, 1, 0);
+				QuatNLerpArray(&corrected, &q0, &q1, &t, 1, 1);
+				double e0 = angleBetween(slerp, plain), e1 = angleBetween(slerp, corrected);
+				if(e0 > maxPlain) maxPlain = e0;
+				if(e1 > maxCorrected) maxCorrected = e1;
+			}
+		}
+		printf("%10.0f %16.5f %16.5f\n", anglesDeg[a], maxPlain, maxCorrected);
+	}
+
+	// throughput, key pairs up to 30 degrees apart like a densely sampled curve
+	int const count = 100000;
+	int const repeats = 20;
+	std::vector<Quat> q0(count), q1(count), out(count);
+	std::vector<float> t(count);
+	for(int q = 0; q < count; ++q)
+	{
+		q0[q] = randomQuat();
+		q1[q] = rotatedBy(q0[q], frand() * 30.0f * (float)M_PI / 180.0f);
+		t[q] = frand();
+	}
+
+	double start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		for(int q = 0; q < count; ++q)
+			QuatSLinearCombine(&out[q], &q0[q], &q1[q], t[q]);
+	double slerpTime = seconds() - start;
+
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		QuatNLerpArray(&out[0], &q0[0], &q1[0], &t[0], count, 0);
+	double nlerpTime = seconds() - start;
+
+	start = seconds();
+	for(int r = 0; r < repeats; ++r)
+		QuatNLerpArray(&out[0], &q0[0], &q1[0], &t[0], count, 1);
+	double correctedTime = seconds() - start;
+
+	double n = (double)count * repeats;
+	printf("\n%d quaternions x %d\n", count, repeats);
+	printf("slerp      %8.2f Mquat/s\n", n / slerpTime * 1e-6);
+	printf("nlerp      %8.2f Mquat/s\n", n / nlerpTime * 1e-6);
+	printf("corrected  %8.2f Mquat/s\n", n / correctedTime * 1e-6);
+	return 0;
+}
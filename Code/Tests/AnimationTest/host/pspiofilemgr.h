@@ -0,0 +1,20 @@
+// host stand-in for the PSP file calls, mutant's psp file_input reads with them
+#ifndef HOST_PSPIOFILEMGR_H
+#define HOST_PSPIOFILEMGR_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "psptypes.h"
+
+#define PSP_O_RDONLY	O_RDONLY
+#define PSP_SEEK_SET	SEEK_SET
+
+typedef int SceUID;
+typedef s64 SceOff;
+
+static SceUID sceIoOpen(char const* file, int flags, int mode) { return open(file, flags, mode); }
+static int sceIoClose(SceUID fd) { return close(fd); }
+static int sceIoRead(SceUID fd, void* data, u32 size) { return static_cast<int>(read(fd, data, size)); }
+static SceOff sceIoLseek(SceUID fd, SceOff offset, int whence) { return lseek(fd, offset, whence); }
+
+#endif
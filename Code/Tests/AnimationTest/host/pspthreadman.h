@@ -0,0 +1,15 @@
+// host stand-in for the PSP kernel timer, player code reads it with __psp__
+#ifndef HOST_PSPTHREADMAN_H
+#define HOST_PSPTHREADMAN_H
+
+#include <time.h>
+#include "psptypes.h"
+
+static u32 sceKernelGetSystemTimeLow()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<u32>(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+#endif
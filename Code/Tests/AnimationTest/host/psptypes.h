@@ -0,0 +1,14 @@
+// host stand-in for the PSP SDK types, Base headers expect them with __psp__
+#ifndef HOST_PSPTYPES_H
+#define HOST_PSPTYPES_H
+
+typedef signed char s8;
+typedef short s16;
+typedef int s32;
+typedef long long s64;
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+
+#endif
@@ -0,0 +1,250 @@
+// Runs the registered benchmarks, writes their statistics as JSON and
+// optionally compares the medians against a baseline written by an earlier
+// run. Exits with 1 when a benchmark got slower than the baseline by more
+// than the threshold, with 2 on bad arguments or unreadable files.
+//
+// BenchRunner [--filter substring] [--warmup n] [--reps n]
+//             [--json results.json] [--baseline baseline.json] [--threshold 0.10]
+//             [--trace trace.json]
+//
+// --trace writes the profiler zones of the measured repetitions as a Chrome
+// trace, each repetition is a zone named after its benchmark.
+
+#include "Bench.h"
+
+#include <player/Profiler.h>
+
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+
+using namespace bench;
+
+////////////////////////////////////////////////
+Benchmark::Benchmark(char const* name)
+:	mName(name)
+{
+	registry().push_back(this);
+}
+
+std::vector<Benchmark*>& bench::registry()
+{
+	// function static, benchmarks in other units may register before main
+	static std::vector<Benchmark*> benchmarks;
+	return benchmarks;
+}
+
+namespace
+{
+	void const* volatile sSinkPtr;
+	float volatile sSinkFloat;
+}
+
+void bench::consume(void const* p) { sSinkPtr = p; }
+void bench::consume(float f) { sSinkFloat = f; }
+
+namespace
+{
+	double microseconds()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+	}
+
+	struct Result
+	{
+		std::string	name;
+		int			reps;
+		double		min, median, mean, stddev;	// microseconds per run
+		double		itemsPerSecond;
+	};
+
+	enum { MinRepetitionTime = 2000 };	// microseconds
+
+	Result measure(Benchmark& b, int warmup, int reps)
+	{
+		b.setup();
+		for(int q = 0; q < warmup; ++q)
+			b.run();
+
+		// short benchmarks run several times per repetition, so that the
+		// timer resolution stays well below the measured time
+		int runs = 1;
+		for(;;)
+		{
+			double start = microseconds();
+			for(int q = 0; q < runs; ++q)
+				b.run();
+			if(microseconds() - start >= MinRepetitionTime || runs >= (1 << 20))
+				break;
+			runs *= 2;
+		}
+
+		std::vector<double> times(reps);
+		for(int q = 0; q < reps; ++q)
+		{
+			MUTALISK_PROFILE_ZONE(b.name());
+			double start = microseconds();
+			for(int w = 0; w < runs; ++w)
+				b.run();
+			times[q] = (microseconds() - start) / runs;
+		}
+		std::sort(times.begin(), times.end());
+
+		Result r;
+		r.name = b.name();
+		r.reps = reps;
+		r.min = times[0];
+		r.median = (reps % 2)? times[reps / 2]: 0.5 * (times[reps / 2 - 1] + times[reps / 2]);
+		r.mean = 0.0;
+		for(int q = 0; q < reps; ++q)
+			r.mean += times[q];
+		r.mean /= reps;
+		r.stddev = 0.0;
+		for(int q = 0; q < reps; ++q)
+			r.stddev += (times[q] - r.mean) * (times[q] - r.mean);
+		r.stddev = sqrt(r.stddev / reps);
+		r.itemsPerSecond = (r.median > 0.0)? b.items() * 1e6 / r.median: 0.0;
+		return r;
+	}
+
+	bool writeJson(char const* path, std::vector<Result> const& results)
+	{
+		FILE* f = fopen(path, "w");
+		if(!f)
+			return false;
+		fprintf(f, "{\n\t\"benchmarks\": [\n");
+		for(size_t q = 0; q < results.size(); ++q)
+		{
+			Result const& r = results[q];
+			fprintf(f, "\t\t{ \"name\": \"%s\", \"reps\": %d, \"min_us\": %.3f, \"median_us\": %.3f, "
+				"\"mean_us\": %.3f, \"stddev_us\": %.3f, \"items_per_second\": %.1f }%s\n",
+				r.name.c_str(), r.reps, r.min, r.median, r.mean, r.stddev, r.itemsPerSecond,
+				(q + 1 < results.size())? ",": "");
+		}
+		fprintf(f, "\t]\n}\n");
+		return fclose(f) == 0;
+	}
+
+	// reads back the medians of a file written by writeJson; names never
+	// contain quotes, so scanning for the two keys is enough
+	bool readBaseline(char const* path, std::map<std::string, double>& medians)
+	{
+		FILE* f = fopen(path, "rb");
+		if(!f)
+			return false;
+		std::string text;
+		char buffer[4096];
+		size_t n;
+		while((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+			text.append(buffer, n);
+		fclose(f);
+
+		char const nameKey[] = "\"name\": \"";
+		char const medianKey[] = "\"median_us\": ";
+		size_t pos = 0;
+		while((pos = text.find(nameKey, pos)) != std::string::npos)
+		{
+			pos += sizeof(nameKey) - 1;
+			size_t end = text.find('"', pos);
+			size_t median = text.find(medianKey, end);
+			if(end == std::string::npos || median == std::string::npos)
+				return false;
+			medians[text.substr(pos, end - pos)] = atof(text.c_str() + median + sizeof(medianKey) - 1);
+			pos = median;
+		}
+		return true;
+	}
+
+	int usage()
+	{
+		fprintf(stderr, "usage: BenchRunner [--filter substring] [--warmup n] [--reps n]\n"
+			"                   [--json results.json] [--baseline baseline.json] [--threshold 0.10]\n"
+			"                   [--trace trace.json]\n");
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	char const* filter = 0;
+	char const* jsonPath = 0;
+	char const* baselinePath = 0;
+	char const* tracePath = 0;
+	int warmup = 3;
+	int reps = 15;
+	double threshold = 0.10;
+
+	for(int q = 1; q < argc; ++q)
+	{
+		if(q + 1 >= argc)
+			return usage();
+		if(!strcmp(argv[q], "--filter")) filter = argv[++q];
+		else if(!strcmp(argv[q], "--warmup")) warmup = atoi(argv[++q]);
+		else if(!strcmp(argv[q], "--reps")) reps = atoi(argv[++q]);
+		else if(!strcmp(argv[q], "--json")) jsonPath = argv[++q];
+		else if(!strcmp(argv[q], "--baseline")) baselinePath = argv[++q];
+		else if(!strcmp(argv[q], "--threshold")) threshold = atof(argv[++q]);
+		else if(!strcmp(argv[q], "--trace")) tracePath = argv[++q];
+		else return usage();
+	}
+	if(reps < 1 || warmup < 0 || threshold < 0.0)
+		return usage();
+
+	std::map<std::string, double> baseline;
+	if(baselinePath && !readBaseline(baselinePath, baseline))
+	{
+		fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+		return 2;
+	}
+
+	std::vector<Result> results;
+	int regressions = 0;
+	printf("%-32s %12s %12s %10s %14s\n", "benchmark", "median us", "min us", "stddev", "items/s");
+	for(size_t q = 0; q < registry().size(); ++q)
+	{
+		Benchmark& b = *registry()[q];
+		if(filter && !strstr(b.name(), filter))
+			continue;
+
+		Result r = measure(b, warmup, reps);
+		results.push_back(r);
+		printf("%-32s %12.1f %12.1f %10.1f %14.4g", r.name.c_str(), r.median, r.min, r.stddev, r.itemsPerSecond);
+
+		std::map<std::string, double>::const_iterator base = baseline.find(r.name);
+		if(base != baseline.end() && base->second > 0.0)
+		{
+			double change = r.median / base->second - 1.0;
+			bool regressed = change > threshold;
+			printf("  %+6.1f%%%s", change * 100.0, regressed? "  REGRESSION": "");
+			if(regressed)
+				++regressions;
+		}
+		printf("\n");
+	}
+
+	if(jsonPath && !writeJson(jsonPath, results))
+	{
+		fprintf(stderr, "cannot write %s\n", jsonPath);
+		return 2;
+	}
+#if defined(MUTALISK_PROFILER)
+	if(tracePath && !mutalisk::profiler::writeChromeTrace(tracePath))
+	{
+		fprintf(stderr, "cannot write %s\n", tracePath);
+		return 2;
+	}
+#else
+	if(tracePath)
+		fprintf(stderr, "built without MUTALISK_PROFILER, no trace written\n");
+#endif
+	if(regressions)
+		printf("%d of %d benchmarks regressed by more than %.0f%%\n", regressions, (int)results.size(), threshold * 100.0);
+	return regressions? 1: 0;
+}
@@ -0,0 +1,37 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <vector>
+
+namespace bench
+{
+	// A benchmark prepares its data in setup() and does one measured unit of
+	// work per run(). The runner calls setup() once, run() a number of warmup
+	// times and then times each of the repetitions separately. items() is the
+	// number of elements processed by one run(), for a throughput figure.
+	class Benchmark
+	{
+	public:
+		Benchmark(char const* name);
+		virtual ~Benchmark() {}
+
+		char const* name() const { return mName; }
+
+		virtual void setup() {}
+		virtual void run() = 0;
+		virtual double items() const { return 1.0; }
+
+	private:
+		char const* mName;
+	};
+
+	// benchmarks register themselves on construction, define them as statics:
+	//	namespace { struct MyBench : bench::Benchmark { ... } sMyBench; }
+	std::vector<Benchmark*>& registry();
+
+	// keeps results alive so the compiler cannot drop the measured work
+	void consume(void const* p);
+	void consume(float f);
+}
+
+#endif // BENCH_BENCH_H
@@ -0,0 +1,128 @@
+// Lua loading and garbage collection through LuaPlayer, as ImportScene and a
+// script driven player use it. Built only when the Makefile is given a Lua 5.1
+// source tree, see LUA there.
+//
+// The load entries compile the largest .props of the demo data from source
+// and from the bytecode cache, one chunk per run. The frame entries build a
+// frame's worth of property tables and leave them to the collector, either
+// running on its own or stepped with a budget; a collection cycle shows in
+// the worst frame and not in the median, so the worst frame of each is
+// printed when the runner exits.
+
+#include "Bench.h"
+
+#include <lua/LuaPlayer.h>
+
+extern "C" {
+	#include <lua/lauxlib.h>
+}
+
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace mutalisk::lua;
+
+namespace
+{
+	char const* const PropsPath = "../../../Data/DemoTest/exgirl1/exgirl1.props";
+	char const* const CacheDir = "lua_cache";
+
+	double microseconds()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+	}
+
+	struct LoadProps : bench::Benchmark
+	{
+		LoadProps(char const* name, bool cached) : bench::Benchmark(name), cached(cached) {}
+
+		void setup()
+		{
+			LuaPlayer& player = LuaPlayer::getInstance();
+			player.garbageCollect();
+			if(cached)
+				mkdir(CacheDir, 0777);
+			player.setBytecodeCache(cached? CacheDir: "");
+			// the first load of the cached entry compiles and writes the cache
+			status = player.loadChunk(PropsPath);
+			lua_pop(player.luaState(), 1);
+			if(status)
+				fprintf(stderr, "%s: cannot load %s\n", name(), PropsPath);
+		}
+
+		void run()
+		{
+			lua_State* L = LuaPlayer::getInstance().luaState();
+			status = LuaPlayer::getInstance().loadChunk(PropsPath);
+			lua_pop(L, 1);	// the chunk or the error message
+		}
+
+		bool	cached;
+		int		status;
+	};
+	LoadProps sLoadPropsSource("lua/load props source", false);
+	LoadProps sLoadPropsCached("lua/load props bytecode cache", true);
+
+	// property tables like the .props build, rebuilt every frame
+	char const* const FrameScript =
+		"function frame(n)\n"
+		"	local scene = {}\n"
+		"	for i = 1, n do\n"
+		"		scene[i] = { blendOp = 'Lerp', shader = 'lambert', diffuse = {1,1,1}, slice = i }\n"
+		"	end\n"
+		"	return #scene\n"
+		"end\n";
+
+	struct Frame : bench::Benchmark
+	{
+		enum { Tables = 500 };
+
+		Frame(char const* name, unsigned budget) : bench::Benchmark(name), budget(budget), frames(0), worst(0.0) {}
+
+		~Frame()
+		{
+			if(frames)
+				printf("%-32s worst frame %.1f us of %u\n", name(), worst, frames);
+		}
+
+		void setup()
+		{
+			// a fresh state, the collector back in automatic mode
+			LuaPlayer& player = LuaPlayer::getInstance();
+			player.garbageCollect();
+			lua_State* L = player.luaState();
+			if(luaL_loadbuffer(L, FrameScript, strlen(FrameScript), "frame") || lua_pcall(L, 0, 0, 0))
+				fprintf(stderr, "%s: %s\n", name(), lua_tostring(L, -1));
+		}
+
+		void run()
+		{
+			double start = microseconds();
+			LuaPlayer& player = LuaPlayer::getInstance();
+			lua_State* L = player.luaState();
+			lua_getglobal(L, "frame");
+			lua_pushinteger(L, Tables);
+			lua_pcall(L, 1, 1, 0);
+			lua_pop(L, 1);
+			if(budget)
+				player.gcStep(budget);
+
+			double time = microseconds() - start;
+			if(time > worst)
+				worst = time;
+			++frames;
+		}
+
+		double items() const { return Tables; }
+
+		unsigned	budget;		// microseconds, 0 leaves the collector automatic
+		unsigned	frames;
+		double		worst;
+	};
+	Frame sFrameGcAuto("lua/frame gc automatic", 0);
+	Frame sFrameGcStep("lua/frame gc step 200us", 200);
+}
@@ -0,0 +1,116 @@
+// Base/Math batch routines against their one call per element counterparts.
+
+#include "Bench.h"
+
+#include <stdlib.h>
+
+// after the system headers, Base/Common/Config.h defines inline away
+extern "C" {
+	#include <Base/Std/Std.h>
+	#include <Base/Math/Math.h>
+	#include <Base/Math/Quat.h>
+}
+#undef bool
+
+namespace
+{
+	enum { Count = 10000 };
+
+	float frand() { return rand() / (float)RAND_MAX * 2.0f - 1.0f; }
+
+	struct QuatData
+	{
+		void setup()
+		{
+			srand(5);
+			q0.resize(Count); q1.resize(Count); out.resize(Count); t.resize(Count);
+			for(int q = 0; q < Count; ++q)
+			{
+				q0[q].x = frand(); q0[q].y = frand(); q0[q].z = frand(); q0[q].w = frand();
+				q1[q].x = frand(); q1[q].y = frand(); q1[q].z = frand(); q1[q].w = frand();
+				QuatNormalize(&q0[q], &q0[q]);
+				QuatNormalize(&q1[q], &q1[q]);
+				t[q] = frand() * 0.5f + 0.5f;
+			}
+		}
+
+		std::vector<Quat>	q0, q1, out;
+		std::vector<float>	t;
+	};
+
+	struct QuatSlerp : bench::Benchmark, QuatData
+	{
+		QuatSlerp() : bench::Benchmark("math/QuatSLinearCombine") {}
+		void setup() { QuatData::setup(); }
+		void run()
+		{
+			for(int q = 0; q < Count; ++q)
+				QuatSLinearCombine(&out[q], &q0[q], &q1[q], t[q]);
+			bench::consume(&out[0]);
+		}
+		double items() const { return Count; }
+	} sQuatSlerp;
+
+	struct QuatNLerpBatch : bench::Benchmark, QuatData
+	{
+		QuatNLerpBatch() : bench::Benchmark("math/QuatNLerpArray") {}
+		void setup() { QuatData::setup(); }
+		void run()
+		{
+			QuatNLerpArray(&out[0], &q0[0], &q1[0], &t[0], Count, 0);
+			bench::consume(&out[0]);
+		}
+		double items() const { return Count; }
+	} sQuatNLerpBatch;
+
+	struct TransformPoints : bench::Benchmark
+	{
+		TransformPoints() : bench::Benchmark("math/Vec3_setMat34MulVec3Array") {}
+
+		void setup()
+		{
+			srand(6);
+			src.resize(Count); dst.resize(Count);
+			for(int q = 0; q < Count; ++q)
+				Vec3_setXYZ(&src[q], frand(), frand(), frand());
+			Mat34_setIdentity(&m);
+			Vec3_setXYZ(&m.Move, 1.0f, 2.0f, 3.0f);
+		}
+
+		void run()
+		{
+			Vec3_setMat34MulVec3Array(&dst[0], &m, &src[0], Count);
+			bench::consume(&dst[0]);
+		}
+
+		double items() const { return Count; }
+
+		Mat34				m;
+		std::vector<Vec3>	src, dst;
+	} sTransformPoints;
+
+	struct SinFast : bench::Benchmark
+	{
+		SinFast() : bench::Benchmark("math/mathSinFast") {}
+
+		void setup()
+		{
+			srand(7);
+			angles.resize(Count);
+			for(int q = 0; q < Count; ++q)
+				angles[q] = frand() * 100.0f;
+		}
+
+		void run()
+		{
+			float sum = 0.0f;
+			for(int q = 0; q < Count; ++q)
+				sum += mathSinFast(angles[q]);
+			bench::consume(sum);
+		}
+
+		double items() const { return Count; }
+
+		std::vector<float>	angles;
+	} sSinFast;
+}
@@ -0,0 +1,121 @@
+// player module code that runs on the cpu every frame.
+
+#include "Bench.h"
+
+#include <player/CpuPostProcess.h>
+#include <player/Timeline.h>
+
+#include <stdlib.h>
+
+using namespace mutalisk;
+
+namespace
+{
+	// full screen bloom with the settings of the demo's glow parts
+	struct CpuBloom : bench::Benchmark
+	{
+		enum { Width = 480, Height = 272 };
+
+		CpuBloom() : bench::Benchmark("player/cpu::bloom 480x272") {}
+
+		void setup()
+		{
+			srand(4);
+			source.resize(Width * Height);
+			for(size_t q = 0; q < source.size(); ++q)
+				source[q] = (unsigned)rand() ^ ((unsigned)rand() << 16);
+			pixels.resize(source.size() * 3);
+		}
+
+		void run()
+		{
+			std::copy(source.begin(), source.end(), pixels.begin());
+			cpu::Image target = image(0), scratch0 = image(1), scratch1 = image(2);
+			cpu::bloom(target, scratch0, scratch1, 1.0f, 96, 200, 255, 3);
+			bench::consume(&pixels[0]);
+		}
+
+		double items() const { return Width * Height; }
+
+		cpu::Image image(int index)
+		{
+			cpu::Image i = { &pixels[index * Width * Height], Width, Height, Width };
+			return i;
+		}
+
+		std::vector<unsigned>	source;
+		std::vector<unsigned>	pixels;
+	} sCpuBloom;
+
+	// timeline seeks across a demo length script; the main script of TestDemo
+	// has 42 items, 18 of them Once loads, and quits at 557s
+	struct SeekContext
+	{
+		void frame() {}
+		void load() {}
+	};
+
+	typedef Timeline<SeekContext> SeekTimeline;
+
+	struct TimelineSeek : bench::Benchmark
+	{
+		enum { Items = 42, OnceItems = 18, Jumps = 256 };
+
+		TimelineSeek(char const* name) : bench::Benchmark(name) {}
+
+		void setup()
+		{
+			srand(7);
+			unsigned const lastFrame = timeToFrame(557.0f);
+			script.resize(Items + 1);
+			for(unsigned q = 0; q < Items; ++q)
+			{
+				bool const once = (q * OnceItems) % Items < OnceItems;
+				script[q] = SeekTimeline::Item(0.0f, q * lastFrame / Items,
+					once? &SeekContext::load: &SeekContext::frame, once? SeekTimeline::Item::Once: SeekTimeline::Item::Default);
+			}
+			script[Items] = SeekTimeline::Item();
+			timeline.addScript(&script[0]);
+
+			frames.resize(Jumps);
+			for(unsigned q = 0; q < Jumps; ++q)
+				frames[q] = rand() % lastFrame;
+		}
+
+		double items() const { return Jumps; }
+
+		std::vector<SeekTimeline::Item>	script;
+		std::vector<unsigned>			frames;
+		SeekTimeline					timeline;
+		SeekContext						context;
+	};
+
+	struct TimelineJump : TimelineSeek
+	{
+		TimelineJump() : TimelineSeek("player/timeline::jump x256") {}
+
+		void run()
+		{
+			for(unsigned q = 0; q < Jumps; ++q)
+				timeline.jump(context, frames[q]);
+		}
+	} sTimelineJump;
+
+	// the jump before the seek index: a scan over every item of the script
+	struct TimelineJumpLinear : TimelineSeek
+	{
+		TimelineJumpLinear() : TimelineSeek("player/timeline::jump linear scan x256") {}
+
+		void run()
+		{
+			unsigned current = ~0U;
+			for(unsigned q = 0; q < Jumps; ++q)
+			{
+				for(unsigned item = 0; item < Items; ++item)
+					if(frames[q] >= script[item].startFrame)
+						current = item;
+				bench::consume(&current);
+			}
+		}
+	} sTimelineJumpLinear;
+}
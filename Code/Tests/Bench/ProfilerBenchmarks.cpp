@@ -0,0 +1,26 @@
+// Cost of an empty MUTALISK_PROFILE_ZONE: 1e9 / items per second gives the
+// nanoseconds per zone, timer reads and the ring buffer write included.
+
+#include "Bench.h"
+
+#include <player/Profiler.h>
+
+namespace
+{
+	struct ProfilerZone : bench::Benchmark
+	{
+		enum { Zones = 1000 };
+
+		ProfilerZone() : bench::Benchmark("profiler/zone") {}
+
+		void run()
+		{
+			for(int q = 0; q < Zones; ++q)
+			{
+				MUTALISK_PROFILE_ZONE("empty");
+			}
+		}
+
+		double items() const { return Zones; }
+	} sProfilerZone;
+}
@@ -0,0 +1,219 @@
+// texture codec throughput, items are pixels. The "pixel loop" entries are
+// the per-pixel code the conversion tools used, for comparison.
+
+#include "Bench.h"
+
+#include <mutalisk/texture_codec.h>
+
+#include <stdlib.h>
+
+using namespace mutalisk::data;
+
+namespace
+{
+	enum { Width = 512, Height = 512, Pixels = Width * Height };
+
+	unsigned randomPixel()
+	{
+		return (unsigned)rand() ^ ((unsigned)rand() << 16);
+	}
+
+	struct Swizzle : bench::Benchmark
+	{
+		Swizzle(char const* name, unsigned bytesPerPixel, bool unswizzle, bool pixelLoop)
+		:	bench::Benchmark(name), bytesPerPixel(bytesPerPixel), unswizzle(unswizzle), pixelLoop(pixelLoop) {}
+
+		void setup()
+		{
+			srand(5);
+			source.resize(Pixels * bytesPerPixel);
+			for(size_t q = 0; q < source.size(); ++q)
+				source[q] = (unsigned char)rand();
+			target.resize(source.size());
+		}
+
+		void run()
+		{
+			unsigned const widthBytes = Width * bytesPerPixel;
+			if(pixelLoop)
+				swizzleBytes(&target[0], &source[0], widthBytes, Height);
+			else if(unswizzle)
+				unswizzleTexture(&target[0], &source[0], widthBytes, Height);
+			else
+				swizzleTexture(&target[0], &source[0], widthBytes, Height);
+			bench::consume(&target[0]);
+		}
+
+		double items() const { return Pixels; }
+
+		// block address of every byte
+		static void swizzleBytes(unsigned char* dest, unsigned char const* src, unsigned widthBytes, unsigned height)
+		{
+			for(unsigned y = 0; y < height; ++y)
+				for(unsigned x = 0; x < widthBytes; ++x)
+					dest[((y / 8) * (widthBytes / 16) + x / 16) * 128 + (y % 8) * 16 + x % 16] = src[y * widthBytes + x];
+		}
+
+		unsigned						bytesPerPixel;
+		bool							unswizzle;
+		bool							pixelLoop;
+		std::vector<unsigned char>		source;
+		std::vector<unsigned char>		target;
+	};
+	Swizzle sSwizzle16("texture/swizzle 512x512 16bit", 2, false, false);
+	Swizzle sUnswizzle16("texture/unswizzle 512x512 16bit", 2, true, false);
+	Swizzle sSwizzle32("texture/swizzle 512x512 8888", 4, false, false);
+	Swizzle sSwizzleLoop16("texture/swizzle 512x512 16bit pixel loop", 2, false, true);
+
+	struct To16 : bench::Benchmark
+	{
+		To16(char const* name, int format, bool pixelLoop) : bench::Benchmark(name), format(format), pixelLoop(pixelLoop) {}
+
+		void setup()
+		{
+			srand(6);
+			source.resize(Pixels);
+			for(size_t q = 0; q < source.size(); ++q)
+				source[q] = randomPixel();
+			target.resize(Pixels);
+		}
+
+		void run()
+		{
+			if(pixelLoop)
+			{
+				// truncating 5650, one channel at a time
+				for(size_t q = 0; q < source.size(); ++q)
+				{
+					unsigned p = source[q];
+					target[q] = (unsigned short)(((p & 0xff) >> 3) | (((p >> 10) & 0x3f) << 5) | (((p >> 19) & 0x1f) << 11));
+				}
+			}
+			else
+				convert8888To16(&target[0], &source[0], Pixels, format);
+			bench::consume(&target[0]);
+		}
+
+		double items() const { return Pixels; }
+
+		int							format;
+		bool						pixelLoop;
+		std::vector<unsigned>		source;
+		std::vector<unsigned short>	target;
+	};
+	To16 s8888To5650("texture/8888 -> 5650 512x512", TextureFormat_5650, false);
+	To16 s8888To5551("texture/8888 -> 5551 512x512", TextureFormat_5551, false);
+	To16 s8888To4444("texture/8888 -> 4444 512x512", TextureFormat_4444, false);
+	To16 s8888To5650Loop("texture/8888 -> 5650 512x512 pixel loop", TextureFormat_5650, true);
+
+	struct To8888 : bench::Benchmark
+	{
+		To8888(char const* name, int format) : bench::Benchmark(name), format(format) {}
+
+		void setup()
+		{
+			srand(7);
+			source.resize(Pixels);
+			for(size_t q = 0; q < source.size(); ++q)
+				source[q] = (unsigned short)rand();
+			target.resize(Pixels);
+		}
+
+		void run()
+		{
+			convert16To8888(&target[0], &source[0], Pixels, format);
+			bench::consume(&target[0]);
+		}
+
+		double items() const { return Pixels; }
+
+		int							format;
+		std::vector<unsigned short>	source;
+		std::vector<unsigned>		target;
+	};
+	To8888 s5650To8888("texture/5650 -> 8888 512x512", TextureFormat_5650);
+	To8888 s4444To8888("texture/4444 -> 8888 512x512", TextureFormat_4444);
+
+	struct ExpandClut : bench::Benchmark
+	{
+		ExpandClut(char const* name, unsigned bits) : bench::Benchmark(name), bits(bits) {}
+
+		void setup()
+		{
+			srand(8);
+			for(unsigned q = 0; q < 256; ++q)
+				clut[q] = randomPixel();
+			source.resize(Pixels * bits / 8);
+			for(size_t q = 0; q < source.size(); ++q)
+				source[q] = (unsigned char)rand();
+			target.resize(Pixels);
+		}
+
+		void run()
+		{
+			if(bits == 4)
+				expandClut4(&target[0], &source[0], Pixels, clut);
+			else
+				expandClut8(&target[0], &source[0], Pixels, clut);
+			bench::consume(&target[0]);
+		}
+
+		double items() const { return Pixels; }
+
+		unsigned					bits;
+		unsigned					clut[256];
+		std::vector<unsigned char>	source;
+		std::vector<unsigned>		target;
+	};
+	ExpandClut sExpandClut4("texture/clut4 -> 8888 512x512", 4);
+	ExpandClut sExpandClut8("texture/clut8 -> 8888 512x512", 8);
+
+	// smooth gradients with noise, every pixel a new color: the worst case
+	// for the nearest entry search
+	struct Quantize : bench::Benchmark
+	{
+		enum { Size = 128 };
+
+		Quantize(char const* name, unsigned colors, bool build) : bench::Benchmark(name), colors(colors), build(build) {}
+
+		void setup()
+		{
+			srand(9);
+			source.resize(Size * Size);
+			for(unsigned y = 0; y < Size; ++y)
+				for(unsigned x = 0; x < Size; ++x)
+				{
+					unsigned r = x * 2 + rand() % 4, g = y * 2 + rand() % 4, b = (x + y) + rand() % 4;
+					source[y * Size + x] = r | (g << 8) | (b << 16) | 0xff000000;
+				}
+			entries = buildClut(clut, colors, &source[0], Size * Size);
+			indices.resize(Size * Size);
+		}
+
+		void run()
+		{
+			if(build)
+			{
+				entries = buildClut(clut, colors, &source[0], Size * Size);
+				bench::consume(clut);
+			}
+			else
+			{
+				quantizeToClut(&indices[0], &source[0], Size * Size, clut, entries);
+				bench::consume(&indices[0]);
+			}
+		}
+
+		double items() const { return Size * Size; }
+
+		unsigned					colors;
+		bool						build;
+		unsigned					clut[256];
+		unsigned					entries;
+		std::vector<unsigned>		source;
+		std::vector<unsigned char>	indices;
+	};
+	Quantize sBuildClut256("texture/median cut 256 128x128", 256, true);
+	Quantize sQuantize256("texture/quantize clut8 128x128", 256, false);
+	Quantize sQuantize16("texture/quantize clut4 128x128", 16, false);
+}
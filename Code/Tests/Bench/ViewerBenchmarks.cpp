@@ -0,0 +1,106 @@
+// MutaliskViewer helpers: intro quad batching, ball depth sort and intro
+// frame unpacking, at the sizes a frame of the demo uses them.
+
+#include "Bench.h"
+
+#include <SpriteBatch.h>
+#include <DepthSort.h>
+#include <IntroAnimCodec.h>
+
+#include <stdlib.h>
+
+namespace
+{
+	struct SpriteBatchBuild : bench::Benchmark
+	{
+		enum { Sprites = 10000, States = 24 };
+
+		SpriteBatchBuild() : bench::Benchmark("viewer/SpriteBatch.build") {}
+
+		void setup()
+		{
+			srand(1);
+			for(int q = 0; q < States; ++q)
+			{
+				states[q].texture = &textures[q % 8];
+				states[q].srcFix = states[q].dstFix = q / 8;
+			}
+			stateOf.resize(Sprites);
+			for(int q = 0; q < Sprites; ++q)
+				stateOf[q] = rand() % States;
+			vertices.resize(Sprites * 2);
+		}
+
+		void run()
+		{
+			batch.clear();
+			for(int q = 0; q < Sprites; ++q)
+				batch.add(states[stateOf[q]], q % 480, (q / 480) % 272, 16, 16, q);
+			bench::consume(&batch.build(&vertices[0]));
+		}
+
+		double items() const { return Sprites; }
+
+		int									textures[8];
+		mutalisk::SpriteBatch::State		states[States];
+		std::vector<int>					stateOf;
+		std::vector<mutalisk::SpriteBatch::Vertex>	vertices;
+		mutalisk::SpriteBatch				batch;
+	} sSpriteBatchBuild;
+
+	// depths drift a little every run, like balls seen from a moving camera
+	struct CoherentDepthSortBench : bench::Benchmark
+	{
+		enum { Balls = 4096 };
+
+		CoherentDepthSortBench() : bench::Benchmark("viewer/CoherentDepthSort.sort") {}
+
+		void setup()
+		{
+			srand(2);
+			depth.resize(Balls);
+			for(int q = 0; q < Balls; ++q)
+				depth[q] = rand() / (float)RAND_MAX * 100.0f;
+			sorter.sort(&depth[0], Balls);
+		}
+
+		void run()
+		{
+			for(int q = 0; q < Balls; ++q)
+				depth[q] += (rand() / (float)RAND_MAX - 0.5f) * 0.05f;
+			bench::consume(sorter.sort(&depth[0], Balls));
+		}
+
+		double items() const { return Balls; }
+
+		std::vector<float>				depth;
+		mutalisk::CoherentDepthSort		sorter;
+	} sCoherentDepthSortBench;
+
+	struct IntroFrameUnpack : bench::Benchmark
+	{
+		enum { Width = 128, Height = 128, Words = Width * Height / 16 };
+
+		IntroFrameUnpack() : bench::Benchmark("viewer/uncompressFrame") {}
+
+		void setup()
+		{
+			srand(3);
+			packed.resize(Words);
+			for(int q = 0; q < Words; ++q)
+				packed[q] = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+			pixels.resize(Words * 4);
+		}
+
+		void run()
+		{
+			uncompressFrame(&packed[0], &pixels[0], Words);
+			bench::consume(&pixels[0]);
+		}
+
+		double items() const { return Width * Height; }
+
+		std::vector<uint32_t>	packed;
+		std::vector<uint32_t>	pixels;
+	} sIntroFrameUnpack;
+}
@@ -0,0 +1,245 @@
+// Host side checks of mutalisk::cpu::bloom. The packed implementation is
+// compared bit for bit against a straightforward per channel reference (the
+// golden image) for several sizes, settings and thread counts, then the
+// throughput of both is reported in Mpixel/s.
+
+#include <player/CpuPostProcess.h>
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace mutalisk;
+
+namespace
+{
+	////////////////////////////////////////////////
+	// reference implementation, one channel at a time
+	int clampIndex(int i, int last) { return (i < 0)? 0: (i > last)? last: i; }
+	unsigned channel(unsigned c, int q) { return (c >> (q * 8)) & 0xff; }
+
+	void refThreshold(cpu::Image const& src, cpu::Image& dst, unsigned t)
+	{
+		for(int y = 0; y < src.height; ++y)
+			for(int x = 0; x < src.width; ++x)
+			{
+				unsigned c = 0;
+				for(int q = 0; q < 4; ++q)
+				{
+					int v = (int)channel(src.row(y)[x], q) - (int)t;
+					c |= (v > 0? v: 0) << (q * 8);
+				}
+				dst.row(y)[x] = c;
+			}
+	}
+
+	void refBlur(cpu::Image const& src, cpu::Image& dst, int radius, bool horizontal)
+	{
+		unsigned taps = 2 * radius + 1;
+		unsigned inverse = (65536 + taps - 1) / taps;
+		for(int y = 0; y < src.height; ++y)
+			for(int x = 0; x < src.width; ++x)
+			{
+				unsigned c = 0;
+				for(int q = 0; q < 4; ++q)
+				{
+					unsigned sum = 0;
+					for(int k = -radius; k <= radius; ++k)
+					{
+						unsigned p = (horizontal)?
+							src.row(y)[clampIndex(x + k, src.width - 1)]:
+							src.row(clampIndex(y + k, src.height - 1))[x];
+						sum += channel(p, q);
+					}
+					c |= ((sum * inverse) >> 16) << (q * 8);
+				}
+				dst.row(y)[x] = c;
+			}
+	}
+
+	void refComposite(cpu::Image& target, cpu::Image const& bloom, unsigned srcModifier, unsigned dstModifier)
+	{
+		unsigned sm = srcModifier + (srcModifier >> 7);
+		unsigned dm = dstModifier + (dstModifier >> 7);
+		for(int y = 0; y < target.height; ++y)
+			for(int x = 0; x < target.width; ++x)
+			{
+				unsigned d = target.row(y)[x];
+				unsigned s = bloom.row(y)[x];
+				unsigned c = d & 0xff000000;
+				for(int q = 0; q < 3; ++q)
+				{
+					unsigned v = ((channel(d, q) * dm) >> 8) + ((channel(s, q) * sm) >> 8);
+					c |= (v > 255? 255: v) << (q * 8);
+				}
+				target.row(y)[x] = c;
+			}
+	}
+
+	void refBloom(cpu::Image& target, cpu::Image& scratch0, cpu::Image& scratch1,
+		float strength, unsigned threshold, unsigned srcModifier, unsigned dstModifier, unsigned quality)
+	{
+		int radius = cpu::blurRadius(strength, quality);
+		refThreshold(target, scratch0, threshold);
+		for(int q = 0; q < 2 && radius > 0; ++q)
+		{
+			refBlur(scratch0, scratch1, radius, true);
+			refBlur(scratch1, scratch0, radius, false);
+		}
+		refComposite(target, scratch0, srcModifier, dstModifier);
+	}
+
+	////////////////////////////////////////////////
+	// static split of a job range over worker threads
+	int gThreadCount = 1;
+
+	struct Range
+	{
+		cpu::JobT	job;
+		void*		ctx;
+		int			first;
+		int			count;
+	};
+
+	void* runRange(void* arg)
+	{
+		Range& range = *static_cast<Range*>(arg);
+		range.job(range.ctx, range.first, range.count);
+		return 0;
+	}
+
+	void parallelFor(cpu::JobT job, void* ctx, int count)
+	{
+		std::vector<pthread_t> threads(gThreadCount);
+		std::vector<Range> ranges(gThreadCount);
+		for(int q = 0; q < gThreadCount; ++q)
+		{
+			ranges[q].job = job;
+			ranges[q].ctx = ctx;
+			ranges[q].first = count * q / gThreadCount;
+			ranges[q].count = count * (q + 1) / gThreadCount - ranges[q].first;
+			if(q > 0)
+				pthread_create(&threads[q], 0, runRange, &ranges[q]);
+		}
+		runRange(&ranges[0]);
+		for(int q = 1; q < gThreadCount; ++q)
+			pthread_join(threads[q], 0);
+	}
+
+	////////////////////////////////////////////////
+	struct Surface
+	{
+		Surface(int width, int height, int stride) : pixels(stride * height)
+		{
+			image.data = &pixels[0];
+			image.width = width;
+			image.height = height;
+			image.stride = stride;
+		}
+		std::vector<unsigned> pixels;
+		cpu::Image image;
+	};
+
+	void fillTestImage(Surface& s, unsigned seed)
+	{
+		srand(seed);
+		for(int y = 0; y < s.image.height; ++y)
+			for(int x = 0; x < s.image.width; ++x)
+			{
+				// gradients with random highlights so that the threshold matters
+				unsigned r = (x * 255) / s.image.width;
+				unsigned g = (y * 255) / s.image.height;
+				unsigned b = (rand() % 16 == 0)? 255: (rand() & 0x7f);
+				s.image.row(y)[x] = 0xff000000 | (b << 16) | (g << 8) | r;
+			}
+	}
+
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+
+	struct Settings
+	{
+		float strength;
+		unsigned threshold, srcModifier, dstModifier, quality;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	int maxThreads = (argc > 1)? atoi(argv[1]): 4;
+	if(maxThreads < 1)
+		maxThreads = 1;
+
+	// settings used by TestDemo plus extremes
+	Settings const settings[] = {
+		{ 0.2f, 114, 200, 160, 3 },
+		{ 0.1f,   0, 200, 160, 2 },
+		{ 1.0f,  64, 255, 255, 4 },
+		{ 4.0f, 200, 128,  64, 2 },
+	};
+	int const sizes[][3] = { { 480, 272, 512 }, { 61, 37, 64 }, { 1, 1, 1 }, { 960, 544, 960 } };
+
+	int failures = 0;
+	for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+		for(unsigned p = 0; p < sizeof(settings) / sizeof(settings[0]); ++p)
+		{
+			Settings const& c = settings[p];
+			int w = sizes[s][0], h = sizes[s][1], stride = sizes[s][2];
+
+			Surface golden(w, h, stride), g0(w, h, stride), g1(w, h, stride);
+			fillTestImage(golden, s * 17 + p);
+			refBloom(golden.image, g0.image, g1.image, c.strength, c.threshold, c.srcModifier, c.dstModifier, c.quality);
+
+			for(gThreadCount = 1; gThreadCount <= maxThreads; ++gThreadCount)
+			{
+				Surface target(w, h, stride), s0(w, h, stride), s1(w, h, stride);
+				fillTestImage(target, s * 17 + p);
+				cpu::bloom(target.image, s0.image, s1.image, c.strength, c.threshold, c.srcModifier, c.dstModifier, c.quality, parallelFor);
+
+				bool same = true;
+				for(int y = 0; y < h && same; ++y)
+					same = memcmp(target.image.row(y), golden.image.row(y), w * sizeof(unsigned)) == 0;
+				if(!same)
+				{
+					printf("FAILED: %dx%d, settings %u, threads %d\n", w, h, p, gThreadCount);
+					++failures;
+				}
+			}
+		}
+	printf("golden image checks: %s\n", failures? "FAILED": "passed");
+
+	int const benchSizes[][2] = { { 480, 272 }, { 960, 544 }, { 1920, 1080 } };
+	Settings const& c = settings[0];
+	for(unsigned s = 0; s < sizeof(benchSizes) / sizeof(benchSizes[0]); ++s)
+	{
+		int w = benchSizes[s][0], h = benchSizes[s][1];
+		Surface target(w, h, w), s0(w, h, w), s1(w, h, w);
+		fillTestImage(target, 1);
+		double pixels = double(w) * h;
+
+		int const refRuns = 3;
+		double start = seconds();
+		for(int q = 0; q < refRuns; ++q)
+			refBloom(target.image, s0.image, s1.image, c.strength, c.threshold, c.srcModifier, c.dstModifier, c.quality);
+		printf("%4dx%-4d reference: %8.1f Mpixel/s", w, h, pixels * refRuns / (seconds() - start) / 1e6);
+
+		for(gThreadCount = 1; gThreadCount <= maxThreads; gThreadCount *= 2)
+		{
+			int const runs = 20;
+			start = seconds();
+			for(int q = 0; q < runs; ++q)
+				cpu::bloom(target.image, s0.image, s1.image, c.strength, c.threshold, c.srcModifier, c.dstModifier, c.quality, parallelFor);
+			printf(", %d thread(s): %8.1f", gThreadCount, pixels * runs / (seconds() - start) / 1e6);
+		}
+		printf("\n");
+	}
+
+	return failures? 1: 0;
+}
@@ -1,4 +1,5 @@
 #include "BallRenderer.h"
+#include "DepthSort.h"
 /////////////////////////////////////////////////////////////////////////////
 namespace mutalisk
 {
@@ -7,6 +8,8 @@ namespace mutalisk
 		Vec3 pos;
 		float area;
 		u32 displace;
+		u32 color;
+		Vec3 normal;
 	};
 	struct Ball
 	{
@@ -25,6 +28,18 @@ namespace mutalisk
 
 namespace
 {
+	// balls are drawn back to front without depth test, the order follows the camera;
+	// the previous frame order lives in the mesh user data, after the balls, and goes
+	// with the mesh, the sorter only keeps scratch buffers
+	CoherentDepthSort sorter;
+	std::vector<float> depths;
+	std::vector<unsigned> slots;
+
+	unsigned* ballOrder(mutalisk::RenderableMesh& mesh)
+	{
+		return (unsigned*)(mesh.mUserData + sizeof(Data) * mesh.mBlueprint.vertexCount);
+	}
+
 	void prepareBalls(mutalisk::RenderableMesh* mesh)
 	{
 		ASSERT(mesh);
@@ -135,7 +150,7 @@ namespace
 		mesh->mAmplifiedVertexData[0] = new unsigned char[vertexStride * vertexCount];
 		mesh->mAmplifiedVertexDecl = GU_VERTEX_32BITF | GU_NORMAL_32BITF | GU_TEXTURE_32BITF | GU_COLOR_8888;
 		mesh->mAmplifiedVertexStride = vertexStride;
-		mesh->mUserData = new unsigned char[sizeof(Data) * vertexCount];
+		mesh->mUserData = new unsigned char[sizeof(Data) * vertexCount + sizeof(unsigned) * balls.size()];
 
 		std::vector<unsigned> random;
 		random.resize(balls.size());
@@ -170,6 +185,8 @@ namespace
 			data.pos = ball.pos;
 			data.area = ball.area;
 			data.displace = *rnd++;
+			data.color = ball.color;
+			data.normal = ball.normal;
 			*dst++ = v0;
 			*dst++ = v1;
 			*out++ = data;
@@ -184,6 +201,10 @@ namespace
 		memcpy(mesh->mAmplifiedVertexData[1], mesh->mAmplifiedVertexData[0], vertexStride * vertexCount);
 		mesh->mAmplifiedBufferIndex = 0;
 
+		unsigned* order = ballOrder(*mesh);
+		for (size_t i = 0 ; i < balls.size(); ++i)
+			order[i] = i;
+
 		;;printf("done processing \"ball render\"(tm) technique\n");
 	}
 }
@@ -220,11 +241,26 @@ namespace
 				Vec3 normal;
 				Vec3 pos;
 			};
+
+			// view depth along the camera axis in object space, previous frame order is reused
+			Data* data = (Data*)mesh.mUserData;
+			size_t primCount = mesh.mBlueprint.vertexCount / 2;
+			Vec3 unitZ = {0.f, 0.f, 1.f};
+			Vec3 axisZ;
+			Vec3_setMat33MulVec3(&axisZ, &cw, &unitZ);
+			depths.resize(primCount);
+			slots.resize(primCount);
+			for (size_t j = 0; j < primCount; ++j)
+				depths[j] = Vec3_dot(&data[j].pos, &axisZ);
+			if (primCount > 0)
+			{
+				unsigned const* order = sorter.sort(&depths[0], primCount, ballOrder(mesh));
+				for (size_t j = 0; j < primCount; ++j)
+					slots[order[j]] = j;
+			}
 again:
 			mesh.mAmplifiedBufferIndex = 1 - mesh.mAmplifiedBufferIndex;
 			Vertex* vertexData = (Vertex*)mesh.mAmplifiedVertexData[mesh.mAmplifiedBufferIndex];
-			Data* data = (Data*)mesh.mUserData;
-			size_t primCount = mesh.mBlueprint.vertexCount / 2;
 			Vec3 p0, p1, v;
 
 			float t = scene.mState.time;
@@ -260,8 +296,11 @@ again:
 
 				Vec3_sub(&p0, &d.pos, &v);
 				Vec3_add(&p1, &d.pos, &v);
-				vertexData[displace*2+0].pos = p0;
-				vertexData[displace*2+1].pos = p1;
+				Vertex* sprite = vertexData + slots[displace]*2;
+				sprite[0].pos = p0;
+				sprite[1].pos = p1;
+				sprite[0].color = sprite[1].color = d.color;
+				sprite[0].normal = sprite[1].normal = d.normal;
 			}
 			if (firstTime)
 			{
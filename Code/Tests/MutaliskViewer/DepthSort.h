@@ -0,0 +1,141 @@
+#ifndef DEPTHSORT_H
+#define DEPTHSORT_H
+
+#include <vector>
+#include <algorithm>
+
+namespace mutalisk
+{
+	// Sorts indices by ascending depth, reusing the permutation of the previous
+	// call: with a moving camera the order barely changes between frames, so an
+	// insertion sort repairs it in close to linear time. When the insertion sort
+	// exceeds its budget of moves the order is rebuilt with a radix sort on
+	// 16bit quantized depth, followed by an insertion pass fixing the order
+	// within quantization buckets.
+	class CoherentDepthSort
+	{
+	public:
+		struct Stats
+		{
+			Stats() : insertionSorts(0), radixSorts(0), moves(0) {}
+			unsigned insertionSorts;
+			unsigned radixSorts;
+			unsigned moves;
+		};
+
+		CoherentDepthSort() : mMoveBudget(8) {}
+
+		// allowed element moves per element before falling back to radix sort
+		void setMoveBudget(unsigned movesPerElement) { mMoveBudget = movesPerElement; }
+
+		unsigned const* sort(float const* depth, unsigned count)
+		{
+			if(mOrder.size() != count)
+			{
+				mOrder.resize(count);
+				for(unsigned q = 0; q < count; ++q)
+					mOrder[q] = q;
+				rebuild(depth, order(), count);
+				return order();
+			}
+			return sort(depth, count, order());
+		}
+
+		// the same over a permutation kept by the caller, which then owns the
+		// frame to frame state and the sorter only lends its scratch buffers;
+		// order must hold a permutation of count indices, identity at first
+		unsigned const* sort(float const* depth, unsigned count, unsigned* order)
+		{
+			if(insertionSort(depth, order, count, count * mMoveBudget))
+				++mStats.insertionSorts;
+			else
+				rebuild(depth, order, count);
+			return (count > 0)? order: 0;
+		}
+
+		unsigned const* order() const { return mOrder.empty()? 0: &mOrder[0]; }
+		unsigned* order() { return mOrder.empty()? 0: &mOrder[0]; }
+		Stats const& stats() const { return mStats; }
+
+	private:
+		void rebuild(float const* depth, unsigned* order, unsigned count)
+		{
+			radixSort(depth, order, count);
+			insertionSort(depth, order, count, ~0U);
+		}
+
+		bool insertionSort(float const* depth, unsigned* order, unsigned count, unsigned budget)
+		{
+			unsigned moves = 0;
+
+			for(unsigned q = 1; q < count; ++q)
+			{
+				unsigned index = order[q];
+				float key = depth[index];
+				unsigned w = q;
+				for(; w > 0 && depth[order[w - 1]] > key; --w)
+					order[w] = order[w - 1];
+				order[w] = index;
+
+				moves += q - w;
+				if(moves > budget)
+				{
+					// order is still a valid permutation, radix sort takes it from here
+					mStats.moves += moves;
+					return false;
+				}
+			}
+
+			mStats.moves += moves;
+			return true;
+		}
+
+		void radixSort(float const* depth, unsigned* order, unsigned count)
+		{
+			if(count == 0)
+				return;
+
+			float minDepth = depth[0], maxDepth = depth[0];
+			for(unsigned q = 1; q < count; ++q)
+			{
+				if(depth[q] < minDepth) minDepth = depth[q];
+				if(depth[q] > maxDepth) maxDepth = depth[q];
+			}
+			float scale = (maxDepth > minDepth)? 65535.0f / (maxDepth - minDepth): 0.0f;
+
+			mKeys.resize(count);
+			for(unsigned q = 0; q < count; ++q)
+				mKeys[q] = static_cast<unsigned short>((depth[q] - minDepth) * scale);
+
+			// two stable 8bit passes, low byte first
+			mTemp.resize(count);
+			unsigned* src = order;
+			unsigned* dst = &mTemp[0];
+			for(unsigned shift = 0; shift < 16; shift += 8)
+			{
+				unsigned offsets[256] = { 0 };
+				for(unsigned q = 0; q < count; ++q)
+					++offsets[(mKeys[src[q]] >> shift) & 0xff];
+				for(unsigned q = 0, sum = 0; q < 256; ++q)
+				{
+					unsigned c = offsets[q];
+					offsets[q] = sum;
+					sum += c;
+				}
+				for(unsigned q = 0; q < count; ++q)
+					dst[offsets[(mKeys[src[q]] >> shift) & 0xff]++] = src[q];
+				std::swap(src, dst);
+			}
+			// even number of passes, result is back in order
+			++mStats.radixSorts;
+		}
+
+		std::vector<unsigned>		mOrder;
+		std::vector<unsigned>		mTemp;
+		std::vector<unsigned short>	mKeys;
+		unsigned					mMoveBudget;
+		Stats						mStats;
+	};
+}
+
+#endif // DEPTHSORT_H
@@ -0,0 +1,88 @@
+#ifndef __intro_anim_codec_h
+#define __intro_anim_codec_h
+
+#include <stdint.h>
+
+/*
+	Intro animation frames, 2 bits per pixel (4 grey levels of a T8 clut).
+
+	plain (loop*.bin):
+		frames, width, height
+		frames * (width * height / 4) bytes of packed pixels
+
+	delta (loop*.dlt):
+		INTRO_DELTA_MAGIC, frames, width, height
+		per frame: token word count, tokens
+		packed words are xor-ed with the previous frame (frame 0 with zeros),
+		a token is (count << 1) | literal: skip tokens leave count words of the
+		frame unchanged, literal tokens are followed by count xor words; a trailing
+		skip is omitted.
+		Decoding is done in place on the previous packed frame.
+*/
+
+enum
+{
+	INTRO_DELTA_MAGIC = 0x314c5244		// DRL1
+};
+
+inline void uncompressFrame(const uint32_t* in, uint32_t* out, int size)
+{
+/*
+	original: 000000aa 000000bb 000000cc 000000dd
+	compress: aabbccdd eeffgghh iijjkkll mmnnoopp
+	swizzled: aaeeiimm bbffjjnn ccggkkoo ddhhllpp
+	decomprs: 0aa00000 0bb00000 0cc00000 0dd00000
+*/
+	// 32 pixels per iteration, the two loads are issued before the first store
+	for(; size >= 2; size -= 2)
+	{
+		uint32_t input0 = in[0];
+		uint32_t input1 = in[1];
+		in += 2;
+		out[0] = ((input0 & 0xc0c0c0c0) >> 6);
+		out[1] = ((input0 & 0x30303030) >> 4);
+		out[2] = ((input0 & 0x0c0c0c0c) >> 2);
+		out[3] = ((input0 & 0x03030303));
+		out[4] = ((input1 & 0xc0c0c0c0) >> 6);
+		out[5] = ((input1 & 0x30303030) >> 4);
+		out[6] = ((input1 & 0x0c0c0c0c) >> 2);
+		out[7] = ((input1 & 0x03030303));
+		out += 8;
+	}
+	if(size)
+	{
+		uint32_t input = *in;
+		out[0] = ((input & 0xc0c0c0c0) >> 6);
+		out[1] = ((input & 0x30303030) >> 4);
+		out[2] = ((input & 0x0c0c0c0c) >> 2);
+		out[3] = ((input & 0x03030303));
+	}
+}
+
+// applies one delta frame on top of the previous packed frame, words past the
+// last token are unchanged; returns false if the tokens run past the frame
+inline bool applyFrameDelta(const uint32_t* tokens, int tokenWords, uint32_t* frame, int frameWords)
+{
+	const uint32_t* end = tokens + tokenWords;
+	int pos = 0;
+	while(tokens < end)
+	{
+		uint32_t token = *tokens++;
+		int count = (int)(token >> 1);
+		if(pos + count > frameWords)
+			return false;
+
+		if(token & 1)
+		{
+			if(tokens + count > end)
+				return false;
+			for(int i = 0; i < count; ++i)
+				frame[pos + i] ^= tokens[i];
+			tokens += count;
+		}
+		pos += count;
+	}
+	return true;
+}
+
+#endif
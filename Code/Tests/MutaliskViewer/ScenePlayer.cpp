@@ -176,11 +176,14 @@ void updateAnimatedProperties(mutalisk::RenderableScene const& scene)
 		float v = scene.mState.sampleAnimation(actor.nodeName, "UVScroll", time, 0.5f);
 		float fadeOut = scene.mState.sampleAnimation(actor.nodeName, "Fadeout", time, 0.0f);
 		float fadeIn = scene.mState.sampleAnimation(actor.nodeName, "Fadein", time, 1.0f);
+		bool changed = false;
 		for(size_t w = 0; w < actor.materials.size(); ++w)
 		{
-			actor.materials[w].shaderInput.vOffset = 1.0f - v*2.0f;
-			actor.materials[w].shaderInput.transparency = 1.0f - ((1.0f - fadeOut) * fadeIn);
+			changed |= mutalisk::setIfChanged(actor.materials[w].shaderInput.vOffset, 1.0f - v*2.0f);
+			changed |= mutalisk::setIfChanged(actor.materials[w].shaderInput.transparency, 1.0f - ((1.0f - fadeOut) * fadeIn));
 		}
+		if(changed)
+			const_cast<mutalisk::RenderableScene&>(scene).touchMaterials(q);
 		//actor.active = (scene.mState.sampleAnimation(actor.nodeName, "Fadein", time+1.0f, 1.0f) > 0.0f);
 	}
 }
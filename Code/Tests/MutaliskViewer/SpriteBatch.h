@@ -0,0 +1,131 @@
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include <vector>
+#include <stdint.h>
+
+namespace mutalisk
+{
+	// Collects screen space sprites and groups them into one GU_SPRITES vertex
+	// stream per (texture, blend) state, so a frame needs one draw per state
+	// instead of one per sprite. Sprites keep their submission order within a
+	// state; sprites of different states are assumed not to depend on each
+	// other's draw order.
+	class SpriteBatch
+	{
+	public:
+		// GU_TEXTURE_32BITF|GU_COLOR_8888|GU_VERTEX_16BIT|GU_TRANSFORM_2D
+		struct Vertex
+		{
+			float		u, v;
+			uint32_t	color;
+			int16_t		x, y, z;
+			int16_t		pad;
+		};
+
+		struct State
+		{
+			void const*	texture;
+			uint32_t	srcFix;
+			uint32_t	dstFix;
+
+			bool operator== (State const& s) const { return texture == s.texture && srcFix == s.srcFix && dstFix == s.dstFix; }
+		};
+
+		struct Batch
+		{
+			State		state;
+			unsigned	firstVertex;
+			unsigned	vertexCount;
+		};
+
+		void clear()
+		{
+			mSprites.resize(0);
+			mStates.resize(0);
+			mBatches.resize(0);
+		}
+
+		// texel size w x h drawn at x, y
+		void add(State const& state, int x, int y, int w, int h, uint32_t color)
+		{
+			Sprite sprite;
+			sprite.x = (int16_t)x;
+			sprite.y = (int16_t)y;
+			sprite.w = (int16_t)w;
+			sprite.h = (int16_t)h;
+			sprite.color = color;
+			sprite.state = stateIndex(state);
+			mSprites.push_back(sprite);
+		}
+
+		unsigned vertexCount() const { return mSprites.size() * 2; }
+		unsigned spriteCount() const { return mSprites.size(); }
+
+		// writes vertexCount() vertices grouped by state and returns the batches,
+		// dst is usually display list memory so the vertices are built in place
+		std::vector<Batch> const& build(Vertex* dst)
+		{
+			// counting sort by state keeps the submission order within a state
+			mBatches.resize(mStates.size());
+			for(unsigned q = 0; q < mStates.size(); ++q)
+			{
+				mBatches[q].state = mStates[q];
+				mBatches[q].vertexCount = 0;
+			}
+			for(unsigned q = 0; q < mSprites.size(); ++q)
+				mBatches[mSprites[q].state].vertexCount += 2;
+
+			mCursor.resize(mBatches.size());
+			for(unsigned q = 0, first = 0; q < mBatches.size(); ++q)
+			{
+				mBatches[q].firstVertex = first;
+				mCursor[q] = first;
+				first += mBatches[q].vertexCount;
+			}
+
+			for(unsigned q = 0; q < mSprites.size(); ++q)
+			{
+				Sprite const& s = mSprites[q];
+				Vertex* v = dst + mCursor[s.state];
+				mCursor[s.state] += 2;
+
+				v[0].u = 0.f;			v[0].v = 0.f;
+				v[0].color = s.color;
+				v[0].x = s.x;			v[0].y = s.y;			v[0].z = 0;
+				v[1].u = (float)s.w;	v[1].v = (float)s.h;
+				v[1].color = s.color;
+				v[1].x = s.x + s.w;		v[1].y = s.y + s.h;		v[1].z = 0;
+			}
+			return mBatches;
+		}
+
+	private:
+		struct Sprite
+		{
+			int16_t		x, y, w, h;
+			uint32_t	color;
+			uint32_t	state;
+		};
+
+		// a frame uses a handful of states, the last one is the likely match
+		unsigned stateIndex(State const& state)
+		{
+			unsigned count = mStates.size();
+			if(count > 0 && mStates[count - 1] == state)
+				return count - 1;
+			for(unsigned q = 0; q < count; ++q)
+				if(mStates[q] == state)
+					return q;
+			mStates.push_back(state);
+			return count;
+		}
+
+		std::vector<Sprite>		mSprites;
+		std::vector<State>		mStates;
+		std::vector<Batch>		mBatches;
+		std::vector<unsigned>	mCursor;
+	};
+}
+
+#endif // SPRITEBATCH_H
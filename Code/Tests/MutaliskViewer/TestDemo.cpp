@@ -5,6 +5,10 @@
 #include "BlinkyBlinky.h"
 
 #include <effects/library/Mirror.h>
+#if defined(MUTALISK_BENCHMARKS)
+#include "TimeBlock.h"
+#include <malloc.h>
+#endif
 
 extern "C"
 {
@@ -209,13 +213,6 @@ void TestDemo::drawMirrorFrame(Scene const& scene, unsigned mirrorActorId, unsig
 		sceGuDisable(GU_BLEND);
 #endif
 
-		CTransform::t_matrix cameraMatrix = scene.renderable->mState.cameraMatrix;
-		CTransform::t_matrix prevCameraMatrix = cameraMatrix;
-
-		for(size_t q = 0; q < scene.blueprint->actors.size(); ++q)
-			if(q != reflectedActorId)
-				scene.blueprint->actors[q].active = false;
-
 		CTransform::t_matrix const& mirrorMatrix = 
 			scene.renderable->mState.matrices[
 				scene.renderable->mState.actor2XformIndex[mirrorActorId]];
@@ -263,17 +260,16 @@ void TestDemo::drawMirrorFrame(Scene const& scene, unsigned mirrorActorId, unsig
 		reflMatrix.Move.y = -2 * P.b * P.d;
 		reflMatrix.Move.z = -2 * P.c * P.d;
 
-		CTransform::t_matrix m = cameraMatrix;
-		Mat34_mul(&m, &reflMatrix, &cameraMatrix);
-		scene.renderable->mState.cameraMatrix = m;
+		// alternates full mirror passes with ones reusing the lists of the
+		// scene's pass, quitDemo prints the time of both
+		static bool compareMirrorPasses = false;
+		if(compareMirrorPasses)
+			mutalisk::gReuseMirrorLists = !mutalisk::gReuseMirrorLists;
 
 		renderContext.znear = scene.znear;
 		renderContext.zfar = scene.zfar;
-		mutalisk::render(renderContext, *scene.renderable);
-
-		scene.renderable->mState.cameraMatrix = prevCameraMatrix;
-		for(size_t q = 0; q < scene.blueprint->actors.size(); ++q)
-			scene.blueprint->actors[q].active = true;
+		if(reflectedActorId != ~0U)
+			mutalisk::renderReflection(renderContext, *scene.renderable, reflMatrix, point, normal, reflectedActorId);
 
 #if defined(MUTALISK_DX9)
 // -- disabled
@@ -295,6 +291,272 @@ namespace
 	{
 		return static_cast<int>(round(static_cast<float>(v) * 0.3f));
 	}
+
+	// the main script quits here
+	float const DemoEndSeconds = 557.0f;
+
+#if defined(MUTALISK_BENCHMARKS)
+	// Measurements printed at startup, on the loaded scenes and with their
+	// state restored afterwards; built with BUILD_BENCHMARKS=1 only, as they
+	// slow down the start and load extra copies of scenes on the heap.
+
+	// full hierarchy update against the cached one, which only touches animated nodes
+	void benchmarkHierarchy(mutalisk::BaseDemoPlayer::Scene const& scene, char const* name)
+	{
+		typedef mutalisk::RenderableScene::State State;
+		State& state = scene.renderable->mState;
+		if(!state.hierarchy || state.matrices.empty())
+			return;
+
+		unsigned classes[3] = { 0, 0, 0 };
+		for(size_t q = 0; q < state.nodeClasses.size(); ++q)
+			++classes[state.nodeClasses[q]];
+
+		enum { Iterations = 64 };
+		mutalisk::TimeBlock time;
+		time.peek();
+		for(int q = 0; q < Iterations; ++q)
+		{
+			state.xformArrayAnimator.updateTransforms(state.time, state.transforms.begin(), state.transforms.end());
+			CAnimatorAlgos::transformHierarchy(state.matrices.begin(), state.matrices.end(), state.transforms.begin(), *state.hierarchy);
+		}
+		time.peek();
+		float fullMs = time.ms() / Iterations;
+
+		time.peek();
+		for(int q = 0; q < Iterations; ++q)
+		{
+			state.xformArrayAnimator.updateAnimatedTransforms(state.time, state.transforms.begin(), state.transforms.end());
+			CAnimatorAlgos::transformHierarchyNodes(state.matrices.begin(), state.transforms.begin(), *state.hierarchy,
+				state.animatedNodes.begin(), state.animatedNodes.end());
+		}
+		time.peek();
+		float cachedMs = time.ms() / Iterations;
+
+		unsigned const nodes = state.nodeClasses.size();
+		printf("%s hierarchy: %u nodes, %u static, %u constant, %u animated; %.0f%% skipped, %.3f ms -> %.3f ms per frame\n",
+			name, nodes, classes[State::nodeStatic], classes[State::nodeConstant], classes[State::nodeAnimated],
+			100.0f * (nodes - state.animatedNodes.size()) / (nodes? nodes: 1), fullMs, cachedMs);
+	}
+
+	// animation levels of detail over a run of frames against full rate: update
+	// and process time, skinning included, and the distance of every node from
+	// its full rate world position
+	void benchmarkAnimationLod(mutalisk::BaseDemoPlayer::Scene const& scene, char const* name)
+	{
+		typedef mutalisk::RenderableScene::State State;
+		using mutalisk::AnimationLod;
+		State& state = scene.renderable->mState;
+		if(!state.hierarchy || state.matrices.empty())
+			return;
+
+		enum { Frames = 120 };
+		float const FrameTime = 1.0f / 30.0f;
+		float const startTime = state.time;
+		size_t const nodes = state.matrices.size();
+
+		AnimationLod const lods[] = {
+			AnimationLod(AnimationLod::Full), AnimationLod(2), AnimationLod(4),
+			AnimationLod(4, 2), AnimationLod(AnimationLod::Frozen, 1) };
+		std::vector<Vec3> reference(Frames * nodes);
+		float fullMs = 0.0f;
+		for(size_t l = 0; l < sizeof(lods) / sizeof(lods[0]); ++l)
+		{
+			scene.renderable->setAnimationLod(lods[l]);
+			mutalisk::TimeBlock time;
+			float lodMs = 0.0f, maxError = 0.0f, sumError = 0.0f;
+			for(int f = 0; f < Frames; ++f)
+			{
+				time.peek();
+				scene.renderable->update(startTime + f * FrameTime);
+				scene.renderable->process();
+				time.peek();
+				lodMs += time.ms();
+
+				for(size_t q = 0; q < nodes; ++q)
+				{
+					Vec3& ref = reference[f * nodes + q];
+					if(l == 0)
+					{
+						ref = state.matrices[q].Move;
+						continue;
+					}
+					Vec3 d;
+					Vec3_sub(&d, &state.matrices[q].Move, &ref);
+					float error = Vec3_length(&d);
+					sumError += error;
+					maxError = (error > maxError)? error: maxError;
+				}
+			}
+			lodMs /= Frames;
+			if(l == 0)
+				fullMs = lodMs;
+
+			printf("%s animation lod rate %u, %u influences: %.3f ms per frame, %.0f%% saved; node error max %.4f mean %.5f\n",
+				name, lods[l].rate, lods[l].maxInfluences, lodMs, (fullMs > 0.0f)? 100.0f * (1.0f - lodMs / fullMs): 0.0f,
+				maxError, sumError / (Frames * nodes));
+		}
+
+		scene.renderable->setAnimationLod(AnimationLod());
+		scene.renderable->update(startTime);
+		scene.renderable->process();
+	}
+
+	// a frame repeating the previous sample time against one that evaluates
+	// animation, hierarchy and skinning at it
+	void benchmarkHeldFrame(mutalisk::BaseDemoPlayer::Scene const& scene, char const* name)
+	{
+		typedef mutalisk::RenderableScene::State State;
+		State& state = scene.renderable->mState;
+		if(!state.hierarchy || state.matrices.empty())
+			return;
+
+		enum { Iterations = 64 };
+		float const time = state.time;
+		mutalisk::TimeBlock timer;
+		timer.peek();
+		for(int q = 0; q < Iterations; ++q)
+		{
+			scene.renderable->invalidate();
+			scene.renderable->update(time);
+			scene.renderable->process();
+		}
+		timer.peek();
+		float evaluatedMs = timer.ms() / Iterations;
+
+		timer.peek();
+		for(int q = 0; q < Iterations; ++q)
+		{
+			scene.renderable->update(time);
+			scene.renderable->process();
+		}
+		timer.peek();
+		float heldMs = timer.ms() / Iterations;
+
+		printf("%s held frame: %.4f ms, evaluated frame %.3f ms\n", name, heldMs, evaluatedMs);
+	}
+
+	// skinning of all skinned meshes in a frame, unprepared against PreparedSkin
+	void benchmarkSkinning(mutalisk::BaseDemoPlayer::Scene const& scene, char const* name)
+	{
+		typedef mutalisk::RenderableScene::State State;
+		State& state = scene.renderable->mState;
+		mutalisk::RenderableScene::SharedResources& resources = scene.renderable->mResources;
+		if(!state.hierarchy || state.matrices.empty())
+			return;
+
+		enum { Iterations = 32 };
+		float ms[2] = { 0.0f, 0.0f };
+		unsigned meshes = 0, vertices = 0, pruned = 0;
+		for(int prepared = 0; prepared < 2; ++prepared)
+		{
+			mutalisk::gPreparedSkinning = (prepared != 0);
+			mutalisk::TimeBlock timer;
+			timer.peek();
+			for(int q = 0; q < Iterations; ++q)
+				for(size_t w = 0; w < state.bone2XformIndex.size(); ++w)
+					if(!state.bone2XformIndex[w].empty())
+						mutalisk::CSkinnedAlgos::processSkinMesh(*resources.meshes[w].renderable, state.bone2XformIndex[w], &state.matrices[0]);
+			timer.peek();
+			ms[prepared] = timer.ms() / Iterations;
+		}
+		mutalisk::gPreparedSkinning = true;
+
+		for(size_t w = 0; w < state.bone2XformIndex.size(); ++w)
+			if(!state.bone2XformIndex[w].empty())
+			{
+				++meshes;
+				vertices += resources.meshes[w].blueprint->vertexCount;
+				pruned += resources.meshes[w].renderable->mSkin.prunedWeights;
+			}
+		if(meshes)
+			printf("%s skinning: %u meshes, %u vertices, %u weights pruned; %.3f ms -> %.3f ms per frame\n",
+				name, meshes, vertices, pruned, ms[0], ms[1]);
+	}
+
+	unsigned heapUsed()
+	{
+		return mallinfo().uordblks;
+	}
+
+	// memory and time of 1..32 instances of a loaded scene against loading
+	// another copy of it; textures are shared through ResourceCache either way
+	void benchmarkInstancing(mutalisk::BaseDemoPlayer& demo, mutalisk::BaseDemoPlayer::Scene const& source,
+		char const* sceneName, char const* name)
+	{
+		typedef mutalisk::BaseDemoPlayer::Scene Scene;
+		mutalisk::TimeBlock timer;
+
+		Scene copy;
+		unsigned heap = heapUsed();
+		timer.peek();
+		demo.load(copy, sceneName);
+		timer.peek();
+		printf("%s load: %u KB, %.2f ms\n", name, (heapUsed() - heap) / 1024, timer.ms());
+		delete copy.renderable;
+
+		enum { MaxInstances = 32 };
+		std::vector<Scene> instances(MaxInstances);
+		heap = heapUsed();
+		float ms = 0.0f;
+		for(unsigned q = 0; q < MaxInstances; ++q)
+		{
+			timer.peek();
+			demo.instance(instances[q], source);
+			timer.peek();
+			ms += timer.ms();
+
+			unsigned count = q + 1;
+			if((count & (count - 1)) == 0)
+				printf("%s %2u instances: %u KB, %.2f ms\n", name, count, (heapUsed() - heap) / 1024, ms);
+		}
+		for(unsigned q = 0; q < MaxInstances; ++q)
+			delete instances[q].renderable;
+	}
+
+	// setClip over every clip of a large hierarchy with the name bindings
+	// resolved each time, as before they were cached, against cached ones
+	void benchmarkSetClip(mutalisk::BaseDemoPlayer::Scene const& scene, char const* name)
+	{
+		typedef mutalisk::RenderableScene::State State;
+		typedef mutalisk::RenderableScene::SharedResources SharedResources;
+		mutalisk::RenderableScene& renderable = *scene.renderable;
+		State& state = renderable.mState;
+		if(!state.character || !state.hierarchy || state.hierarchy->size() < 60 || state.character->size() == 0)
+			return;
+
+		unsigned const clips = state.character->size();
+		unsigned current = ~0U;
+		for(unsigned q = 0; q < clips; ++q)
+			if(&(*state.character)[q] == state.clip)
+				current = q;
+
+		enum { Iterations = 16 };
+		mutalisk::TimeBlock timer;
+		timer.peek();
+		for(int q = 0; q < Iterations; ++q)
+			for(unsigned w = 0; w < clips; ++w)
+			{
+				renderable.mResources.bindings = SharedResources::Bindings();
+				renderable.setClip(w);
+			}
+		timer.peek();
+		float resolvedMs = timer.ms() / (Iterations * clips);
+
+		timer.peek();
+		for(int q = 0; q < Iterations; ++q)
+			for(unsigned w = 0; w < clips; ++w)
+				renderable.setClip(w);
+		timer.peek();
+		float cachedMs = timer.ms() / (Iterations * clips);
+
+		// a clip set from outside the character has no index to go back to
+		if(current != ~0U)
+			renderable.setClip(current);
+		printf("%s setClip: %u nodes, %u clips, %.3f ms -> %.3f ms per call\n",
+			name, (unsigned)state.hierarchy->size(), clips, resolvedMs, cachedMs);
+	}
+#endif
 }
 void TestDemo::onStart()
 {
@@ -408,6 +670,25 @@ void TestDemo::onStart()
 	prepareBalls(*scn.face.renderable);
 
 	load(scn.spiral,	"snake\\psp\\snake.msk");
+
+#if defined(MUTALISK_BENCHMARKS)
+	benchmarkHierarchy(scn.walk, "walk");
+	benchmarkHierarchy(scn.logo, "logo");
+	benchmarkHierarchy(scn.flower, "flower");
+	benchmarkHierarchy(scn.face, "face");
+	benchmarkHierarchy(scn.spiral, "spiral");
+	benchmarkAnimationLod(scn.walk, "walk");
+	benchmarkAnimationLod(scn.face, "face");
+	benchmarkHeldFrame(scn.walk, "walk");
+	benchmarkHeldFrame(scn.face, "face");
+	benchmarkSkinning(scn.walk, "walk");
+	benchmarkSkinning(scn.face, "face");
+	benchmarkSkinning(scn.spiral, "spiral");
+	benchmarkInstancing(*this, scn.walk, "walk\\psp\\walk.msk", "walk");
+	benchmarkSetClip(scn.walk, "walk");
+	benchmarkSetClip(scn.face, "face");
+	benchmarkSetClip(scn.spiral, "spiral");
+#endif
 	
 __skipUntilPhone:
 	load(scn.phone1,	"telephone_s1\\psp\\telephone_s1.msk");
@@ -418,6 +699,15 @@ __skipUntilPhone:
 	prepareSprites(*scn.phone1.renderable);
 	prepareSprites(*scn.phone2.renderable);
 	prepareSprites(*scn.phone3.renderable);
+#if defined(MUTALISK_BENCHMARKS)
+	benchmarkHierarchy(scn.phone1, "phone1");
+	benchmarkHierarchy(scn.phone2, "phone2");
+	benchmarkHierarchy(scn.phone3, "phone3");
+	benchmarkAnimationLod(scn.phone1, "phone1");
+	benchmarkHeldFrame(scn.phone1, "phone1");
+	benchmarkSkinning(scn.phone1, "phone1");
+	benchmarkSetClip(scn.phone1, "phone1");
+#endif
 
 	phone2MirrorActorId = findActor(scn.phone2, "mirror");
 	phone2ReflectorActorId = findActor(scn.phone2, "dfs");
@@ -514,7 +804,7 @@ __skipUntilWindow:
  			Item(238,	ms(20),		S_FUNC(loadEnd),	Item::Once),
 // 			Item(250,	ms(20),		S_FUNC(loadEndScenes),	Item::Once),
 
-			Item(557,	ms(0),		S_FUNC(quitDemo),	Item::Once),
+			Item(DemoEndSeconds,	ms(0),		S_FUNC(quitDemo),	Item::Once),
 
 			Item()
 		};
@@ -533,6 +823,11 @@ __skipUntilWindow:
 
 namespace {
 float gVScale = 1.0f;
+void touchMaterials(mutalisk::RenderableScene const& scene, size_t actorIndex)
+{
+	const_cast<mutalisk::RenderableScene&>(scene).touchMaterials(actorIndex);
+}
+
 void updateAnimatedVisibility(mutalisk::RenderableScene const& scene)
 {
 	const mutalisk::array<mutalisk::data::scene::Actor>& actors = scene.mBlueprint.actors;
@@ -562,15 +857,19 @@ void updateAnimatedProperties(mutalisk::RenderableScene const& scene)
 		float v = scene.mState.sampleAnimation(actor.nodeName, "UVScroll", time);
 		float fadeOut = scene.mState.sampleAnimation(actor.nodeName, "Fadeout", time, 0.0f);
 		float fadeIn = scene.mState.sampleAnimation(actor.nodeName, "Fadein", time, 1.0f);
+		bool changed = false;
 		for(size_t w = 0; w < actor.materials.size(); ++w)
 		{
+			mutalisk::data::shader_fixed& input = actor.materials[w].shaderInput;
 			if(hasUVScroll)
 			{
-				actor.materials[w].shaderInput.vOffset = 1.0f - v*(vScale + 1.0f);
-				actor.materials[w].shaderInput.vScale = vScale;
+				changed |= mutalisk::setIfChanged(input.vOffset, 1.0f - v*(vScale + 1.0f));
+				changed |= mutalisk::setIfChanged(input.vScale, vScale);
 			}
-			actor.materials[w].shaderInput.transparency = 1.0f - ((1.0f - fadeOut) * fadeIn);
+			changed |= mutalisk::setIfChanged(input.transparency, 1.0f - ((1.0f - fadeOut) * fadeIn));
 		}
+		if(changed)
+			touchMaterials(scene, q);
 		//actor.active = (scene.mState.sampleAnimation(actor.nodeName, "Fadein", time+1.0f, 1.0f) > 0.0f);
 	}
 }
@@ -591,17 +890,21 @@ void updateAnimatedProperties2(mutalisk::RenderableScene const& scene)
 		float v = scene.mState.sampleAnimation(actor.nodeName, "UVScroll", time);
 		float fadeOut = scene.mState.sampleAnimation(actor.nodeName, "Fadeout", time, 0.0f);
 		float fadeIn = scene.mState.sampleAnimation(actor.nodeName, "Fadein", time, 1.0f);
+		bool changed = false;
 		for(size_t w = 0; w < actor.materials.size(); ++w)
 		{
+			mutalisk::data::shader_fixed& input = actor.materials[w].shaderInput;
 			if(hasUVScroll)
 			{
-				actor.materials[w].shaderInput.vOffset = (vScale + 1.0f) - v*(vScale + 1.0f);//- v*2.0f;
-				actor.materials[w].shaderInput.vScale = -vScale;
+				changed |= mutalisk::setIfChanged(input.vOffset, (vScale + 1.0f) - v*(vScale + 1.0f));//- v*2.0f;
+				changed |= mutalisk::setIfChanged(input.vScale, -vScale);
 				//actor.materials[w].shaderInput.vOffset = 1.0f - v*(vScale + 1.0f);
 				//actor.materials[w].shaderInput.vScale = vScale;
 			}
-			actor.materials[w].shaderInput.transparency = 1.0f - ((1.0f - fadeOut) * fadeIn);
+			changed |= mutalisk::setIfChanged(input.transparency, 1.0f - ((1.0f - fadeOut) * fadeIn));
 		}
+		if(changed)
+			touchMaterials(scene, q);
 		//actor.active = (scene.mState.sampleAnimation(actor.nodeName, "Fadein", time+1.0f, 1.0f) > 0.0f);
 	}
 }
@@ -616,12 +919,16 @@ void updateAnimatedProperties3(mutalisk::RenderableScene const& scene)
 		float f = std::min(time * 0.4f, 1.0f);
 
 		mutalisk::data::scene::Actor& actor = const_cast<mutalisk::data::scene::Actor&>(actors[q]);
+		bool changed = false;
 		for(size_t w = 0; w < actor.materials.size(); ++w)
 		{
-			actor.materials[w].shaderInput.diffuse.r = f;
-			actor.materials[w].shaderInput.diffuse.g = f;
-			actor.materials[w].shaderInput.diffuse.b = f;
+			mutalisk::data::shader_fixed& input = actor.materials[w].shaderInput;
+			changed |= mutalisk::setIfChanged(input.diffuse.r, f);
+			changed |= mutalisk::setIfChanged(input.diffuse.g, f);
+			changed |= mutalisk::setIfChanged(input.diffuse.b, f);
 		}
+		if(changed)
+			touchMaterials(scene, q);
 	}
 }
 
@@ -636,12 +943,16 @@ void updateAnimatedProperties4(mutalisk::RenderableScene const& scene)
 		float f = std::max(std::min(8.0f - time, 1.0f), 0.0f);
 
 		mutalisk::data::scene::Actor& actor = const_cast<mutalisk::data::scene::Actor&>(actors[q]);
+		bool changed = false;
 		for(size_t w = 0; w < actor.materials.size(); ++w)
 		{
-			actor.materials[w].shaderInput.diffuse.r = f;
-			actor.materials[w].shaderInput.diffuse.g = f;
-			actor.materials[w].shaderInput.diffuse.b = f;
+			mutalisk::data::shader_fixed& input = actor.materials[w].shaderInput;
+			changed |= mutalisk::setIfChanged(input.diffuse.r, f);
+			changed |= mutalisk::setIfChanged(input.diffuse.g, f);
+			changed |= mutalisk::setIfChanged(input.diffuse.b, f);
 		}
+		if(changed)
+			touchMaterials(scene, q);
 	}
 }
 
@@ -682,10 +993,13 @@ void updateAnimatedProperties5(mutalisk::RenderableScene const& scene)
 		mutalisk::data::scene::Actor& actor = const_cast<mutalisk::data::scene::Actor&>(actors[q]);
 
 		float fadeIn = scene.mState.sampleAnimation(actor.nodeName, "fadein", time, 1.0f);
+		bool changed = false;
 		for(size_t w = 0; w < actor.materials.size(); ++w)
 		{
-			actor.materials[w].shaderInput.transparency = 1.0f - fadeIn;
+			changed |= mutalisk::setIfChanged(actor.materials[w].shaderInput.transparency, 1.0f - fadeIn);
 		}
+		if(changed)
+			touchMaterials(scene, q);
 	}
 }
 
@@ -1029,7 +1343,7 @@ int TestDemo::loadTextThreaded(SceSize args, void *argp)
 void TestDemo::loadTextScene()
 {
 	unloadTextures(scn.logo);
-	scn.walk.renderable->mResources.animCharSet.reset();
+	scn.walk.renderable->mResources.releaseAnimation();
 	{
 		SceUID textth = sceKernelCreateThread("loadTextThreaded", loadTextThreaded, 0x12, 0x10000, PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU, NULL);
 		if (textth < 0)
@@ -1065,7 +1379,7 @@ void TestDemo::loadPhoneB()
 void TestDemo::loadText()
 {
 	printf("%s\n", __FUNCTION__);
-	scn.spiral.renderable->mResources.animCharSet.reset();
+	scn.spiral.renderable->mResources.releaseAnimation();
 	unloadTextures(scn.spiral);
 	unloadTextures(scn.phone1);
 	loadTextures(scn.textWalk);
@@ -1119,7 +1433,7 @@ int TestDemo::loadWeaponThreaded(SceSize args, void *argp)
 void TestDemo::loadWeaponScenes()
 {
 	printf("%s\n", __FUNCTION__);
-	scn.textWalk.renderable->mResources.animCharSet.reset();
+	scn.textWalk.renderable->mResources.releaseAnimation();
 
 	SceUID th = sceKernelCreateThread("loadWeaponThreaded", loadWeaponThreaded, 0x12, 0x10000, PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU, NULL);
 	if (th < 0)
@@ -1183,24 +1497,24 @@ int TestDemo::loadExploThreaded(SceSize args, void *argp)
 
 void TestDemo::loadExploScenes()
 {
-	scn.phone1.renderable->mResources.animCharSet.reset();	
-	scn.phone2.renderable->mResources.animCharSet.reset();	
-	scn.phone3.renderable->mResources.animCharSet.reset();	
-	scn.phone4.renderable->mResources.animCharSet.reset();	
-	scn.phoneTrans.renderable->mResources.animCharSet.reset();
+	scn.phone1.renderable->mResources.releaseAnimation();	
+	scn.phone2.renderable->mResources.releaseAnimation();	
+	scn.phone3.renderable->mResources.releaseAnimation();	
+	scn.phone4.renderable->mResources.releaseAnimation();	
+	scn.phoneTrans.renderable->mResources.releaseAnimation();
 	scn.phone1.renderable->mResources.meshes.resize(0);
 	scn.phone2.renderable->mResources.meshes.resize(0);	
 	scn.phone3.renderable->mResources.meshes.resize(0);	
 	scn.phone4.renderable->mResources.meshes.resize(0);
 	scn.phoneTrans.renderable->mResources.meshes.resize(0);
 
-	scn.textBG.renderable->mResources.animCharSet.reset();	
-	scn.text.renderable->mResources.animCharSet.reset();		
-	scn.jealousy.renderable->mResources.animCharSet.reset();	
-	scn.beer1.renderable->mResources.animCharSet.reset();		
-	scn.beer2.renderable->mResources.animCharSet.reset();		
-	scn.garlic1.renderable->mResources.animCharSet.reset();	
-	scn.garlic2.renderable->mResources.animCharSet.reset();	
+	scn.textBG.renderable->mResources.releaseAnimation();	
+	scn.text.renderable->mResources.releaseAnimation();		
+	scn.jealousy.renderable->mResources.releaseAnimation();	
+	scn.beer1.renderable->mResources.releaseAnimation();		
+	scn.beer2.renderable->mResources.releaseAnimation();		
+	scn.garlic1.renderable->mResources.releaseAnimation();	
+	scn.garlic2.renderable->mResources.releaseAnimation();	
 
 	scn.textBG.renderable->mResources.meshes.resize(0);	
 	scn.text.renderable->mResources.meshes.resize(0);		
@@ -1244,12 +1558,12 @@ int TestDemo::loadWindowThreaded(SceSize args, void *argp)
 
 void TestDemo::loadWindowScenes()
 {
-	scn.mix1.renderable->mResources.animCharSet.reset();	
-	scn.mix2.renderable->mResources.animCharSet.reset();	
-	scn.mix3.renderable->mResources.animCharSet.reset();	
-	scn.reload.renderable->mResources.animCharSet.reset();
-	scn.m16.renderable->mResources.animCharSet.reset();		
-	scn.gun.renderable->mResources.animCharSet.reset();
+	scn.mix1.renderable->mResources.releaseAnimation();	
+	scn.mix2.renderable->mResources.releaseAnimation();	
+	scn.mix3.renderable->mResources.releaseAnimation();	
+	scn.reload.renderable->mResources.releaseAnimation();
+	scn.m16.renderable->mResources.releaseAnimation();		
+	scn.gun.renderable->mResources.releaseAnimation();
 
 	scn.mix1.renderable->mResources.meshes.resize(0);	
 	scn.mix2.renderable->mResources.meshes.resize(0);	
@@ -1258,10 +1572,10 @@ void TestDemo::loadWindowScenes()
 	scn.m16.renderable->mResources.meshes.resize(0);		
 	scn.gun.renderable->mResources.meshes.resize(0);
 
-//	scn.bullet1.renderable->mResources.animCharSet.reset();
-//	scn.expGirl1BG.renderable->mResources.animCharSet.reset();
-//	scn.expGirl1.renderable->mResources.animCharSet.reset();	
-//	scn.bullet2.renderable->mResources.animCharSet.reset();	
+//	scn.bullet1.renderable->mResources.releaseAnimation();
+//	scn.expGirl1BG.renderable->mResources.releaseAnimation();
+//	scn.expGirl1.renderable->mResources.releaseAnimation();	
+//	scn.bullet2.renderable->mResources.releaseAnimation();	
 
 	SceUID th = sceKernelCreateThread("loadWindowThreaded", loadWindowThreaded, 0x12, 0x10000, PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU, NULL);
 	if (th < 0)
@@ -1303,14 +1617,14 @@ int TestDemo::loadEndThreaded(SceSize args, void *argp)
 
 void TestDemo::loadEndScenes()
 {
-	scn.bullet1.renderable->mResources.animCharSet.reset();
-	scn.expGirl1BG.renderable->mResources.animCharSet.reset();
-	scn.expGirl1.renderable->mResources.animCharSet.reset();	
-	scn.bullet2.renderable->mResources.animCharSet.reset();	
-//	scn.expGirl2BG.renderable->mResources.animCharSet.reset();
-//	scn.expGirl2.renderable->mResources.animCharSet.reset();	
-//	scn.windowBarbie.renderable->mResources.animCharSet.reset();	
-//	scn.window.renderable->mResources.animCharSet.reset();
+	scn.bullet1.renderable->mResources.releaseAnimation();
+	scn.expGirl1BG.renderable->mResources.releaseAnimation();
+	scn.expGirl1.renderable->mResources.releaseAnimation();	
+	scn.bullet2.renderable->mResources.releaseAnimation();	
+//	scn.expGirl2BG.renderable->mResources.releaseAnimation();
+//	scn.expGirl2.renderable->mResources.releaseAnimation();	
+//	scn.windowBarbie.renderable->mResources.releaseAnimation();	
+//	scn.window.renderable->mResources.releaseAnimation();
 
 	scn.expGirl1BG.renderable->mResources.meshes.resize(0);
 	scn.expGirl1.renderable->mResources.meshes.resize(0);	
@@ -1349,8 +1663,8 @@ void TestDemo::loadEndScenes()
 void TestDemo::loadEnd()
 {
 //	printf("%s %s %i\n", __FILE__, __FUNCTION__, __LINE__);
-//	scn.expGirl2BG.renderable->mResources.animCharSet.reset();
-//	scn.expGirl2.renderable->mResources.animCharSet.reset();	
+//	scn.expGirl2BG.renderable->mResources.releaseAnimation();
+//	scn.expGirl2.renderable->mResources.releaseAnimation();	
 
 //	printf("%s %s %i\n", __FILE__, __FUNCTION__, __LINE__);
 //	scn.expGirl2BG.renderable->mResources.meshes.resize(0);
@@ -1367,5 +1681,14 @@ void TestDemo::loadEnd()
 
 void TestDemo::quitDemo()
 {
+	mutalisk::printResourceStats();
+	if(scn.flower.renderable)
+		mutalisk::printSurfaceStats(*scn.flower.renderable, "flower");
+	if(scn.spiral.renderable)
+		mutalisk::printSurfaceStats(*scn.spiral.renderable, "spiral");
+	mutalisk::printReflectionStats();
+#if defined(MUTALISK_PROFILER)
+	mutalisk::profiler::writeChromeTrace("ms0:/mutalisk_trace.json");
+#endif
 	exitRequest = 1;
 }
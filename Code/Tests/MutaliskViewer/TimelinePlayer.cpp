@@ -368,7 +368,7 @@ int main(int argc, char* argv[])
 //;;updateTime.peek();
 
 ;;finishAndSyncTime.peek();
-			sceGuSync(0,0);
+			mutalisk::gFrameFence.sync();
 ;;finishAndSyncTime.peek();
 
 ;;static mutalisk::TimeBlock frameTime; frameTime.peek();
@@ -465,6 +465,7 @@ int main(int argc, char* argv[])
 		}
 
 		sceGuFinish();
+		mutalisk::gFrameFence.submit();
 		val++;
 	}
 
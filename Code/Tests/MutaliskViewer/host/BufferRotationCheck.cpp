@@ -0,0 +1,163 @@
+// Runs BufferRotation against a simulated GE that finishes lists a number of
+// frames after they are submitted, the way the main loop of TimelinePlayer
+// drives skinned meshes: update (acquire + write), render (markDrawn), submit.
+// Some frames are held, they draw the same buffer again without skinning.
+//
+// Checks that a buffer is never written while a submitted or recorded list
+// still reads it, that buffers rotate when the GE keeps up and how often the
+// CPU has to wait. Exits with 1 on the first broken invariant.
+
+#include <player/BufferRotation.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace mutalisk;
+
+namespace
+{
+	// lists complete in order, `lag` frames after they were submitted
+	class FakeGe : public GpuFence
+	{
+	public:
+		FakeGe(unsigned lag) : mLag(lag), mSubmitted(0), mCompleted(0), mWaits(0) {}
+
+		virtual ValueT pending() const { return mSubmitted + 1; }
+		virtual ValueT completed() const { return mCompleted; }
+		virtual void wait(ValueT value)
+		{
+			if(value > mSubmitted)
+				return;
+			++mWaits;
+			if(mCompleted < value)
+				mCompleted = value;
+		}
+
+		void submit() { ++mSubmitted; }
+		void tick()
+		{
+			if(mSubmitted > mLag && mCompleted < mSubmitted - mLag)
+				mCompleted = mSubmitted - mLag;
+		}
+
+		unsigned waits() const { return mWaits; }
+
+	private:
+		unsigned	mLag;
+		ValueT		mSubmitted;
+		ValueT		mCompleted;
+		unsigned	mWaits;
+	};
+
+	struct Result
+	{
+		unsigned stalls;
+		unsigned rotations;		// acquires that moved to another buffer
+		unsigned acquires;
+	};
+
+	int gFailures = 0;
+
+	void fail(char const* what, unsigned buffers, unsigned lag, unsigned frame, unsigned buffer)
+	{
+		fprintf(stderr, "FAILED %s: buffers %u, lag %u, frame %u, buffer %u\n", what, buffers, lag, frame, buffer);
+		++gFailures;
+	}
+
+	// `holdEvery` holds every n-th frame, 0 never; `drawsPerFrame` is how
+	// many times a frame draws the mesh, mirror passes draw it twice
+	Result run(unsigned buffers, unsigned lag, unsigned holdEvery, unsigned drawsPerFrame, unsigned frames)
+	{
+		FakeGe ge(lag);
+		BufferRotation rotation(buffers);
+
+		// last list that reads each buffer, kept apart from the rotation
+		std::vector<GpuFence::ValueT> readBy(buffers, 0);
+		std::vector<unsigned> contents(buffers, 0);
+
+		Result r = { 0, 0, 0 };
+		unsigned written = 0;
+		for(unsigned frame = 1; frame <= frames; ++frame)
+		{
+			ge.tick();
+
+			bool held = holdEvery && (frame % holdEvery) == 0 && written > 0;
+			if(!held)
+			{
+				unsigned previous = rotation.current();
+				unsigned index = rotation.acquire(ge);
+				++r.acquires;
+				if(index != previous)
+					++r.rotations;
+				if(index >= buffers)
+					fail("index out of range", buffers, lag, frame, index);
+				else
+				{
+					if(readBy[index] > ge.completed())
+						fail("overwrote a buffer the GE still reads", buffers, lag, frame, index);
+					contents[index] = frame;
+					written = frame;
+				}
+			}
+
+			for(unsigned d = 0; d < drawsPerFrame; ++d)
+			{
+				unsigned index = rotation.current();
+				if(contents[index] != written)
+					fail("drew a stale buffer", buffers, lag, frame, index);
+				rotation.markDrawn(ge);
+				readBy[index] = ge.pending();
+			}
+			ge.submit();
+		}
+		r.stalls = rotation.stalls();
+		if(r.stalls != ge.waits())
+			fail("stalls and fence waits disagree", buffers, lag, frames, rotation.current());
+		return r;
+	}
+
+	void expect(bool ok, char const* what)
+	{
+		if(!ok)
+		{
+			fprintf(stderr, "FAILED %s\n", what);
+			++gFailures;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned const frames = 600;
+
+	fprintf(stderr, "buffers lag hold draws   acquires rotations stalls\n");
+	for(unsigned buffers = 1; buffers <= BufferRotation::MaxBuffers; ++buffers)
+		for(unsigned lag = 0; lag <= 3; ++lag)
+			for(unsigned hold = 0; hold <= 3; hold += 3)
+				for(unsigned draws = 1; draws <= 2; ++draws)
+				{
+					Result r = run(buffers, lag, hold, draws, frames);
+					fprintf(stderr, "%7u %3u %4u %5u %10u %9u %6u\n", buffers, lag, hold, draws, r.acquires, r.rotations, r.stalls);
+
+					// a list in flight per frame of lag plus the one being
+					// written, the CPU never waits with enough buffers
+					if(buffers >= lag + 1)
+						expect(r.stalls == 0, "no stalls with a buffer per frame in flight");
+					if(buffers > 1 && hold == 0)
+						expect(r.rotations == r.acquires, "every skinned frame writes another buffer");
+				}
+
+	// the main loop syncs before recording, so the GE is at most one frame
+	// behind while the next frame is skinned: double buffering never waits
+	Result r = run(2, 1, 0, 1, frames);
+	expect(r.stalls == 0, "double buffering keeps up with a synced loop");
+
+	if(gFailures)
+	{
+		fprintf(stderr, "%d failures\n", gFailures);
+		return 1;
+	}
+	fprintf(stderr, "all invariants hold\n");
+	return 0;
+}
@@ -0,0 +1,89 @@
+// Compares CoherentDepthSort against a full std::sort per frame for ball
+// counts between 1k and 50k. Balls are spread over a head sized ellipsoid
+// shell like the face mesh, the camera orbits it with slow yaw and a pitch
+// sway, at the frame rate of the demo.
+
+#include <DepthSort.h>
+
+#include <sys/time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	struct ByDepth
+	{
+		ByDepth(float const* depth) : mDepth(depth) {}
+		bool operator()(unsigned a, unsigned b) const { return mDepth[a] < mDepth[b]; }
+		float const* mDepth;
+	};
+
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+
+	float frand() { return rand() / (float)RAND_MAX; }
+}
+
+int main(int argc, char** argv)
+{
+	int const frames = 600;					// 10 seconds at 60 fps
+	float const yawPerFrame = 0.006f;		// radians, a full turn in ~17 seconds
+	float const swayPerFrame = 0.02f;
+
+	unsigned const counts[] = { 1000, 5000, 10000, 20000, 50000 };
+	for(unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+	{
+		unsigned count = counts[c];
+		std::vector<float> pos(count * 3);
+		srand(count);
+		for(unsigned q = 0; q < count; ++q)
+		{
+			float a = frand() * 6.2832f, b = acosf(frand() * 2.0f - 1.0f);
+			float r = 0.9f + 0.1f * frand();
+			pos[q*3+0] = r * 0.8f * sinf(b) * cosf(a);
+			pos[q*3+1] = r * 1.1f * cosf(b);
+			pos[q*3+2] = r * 0.9f * sinf(b) * sinf(a);
+		}
+
+		std::vector<float> depth(count);
+		std::vector<unsigned> reference(count);
+		mutalisk::CoherentDepthSort sorter;
+		double fullTime = 0, coherentTime = 0;
+		bool same = true;
+
+		for(int f = 0; f < frames; ++f)
+		{
+			float yaw = f * yawPerFrame;
+			float pitch = 0.3f * sinf(f * swayPerFrame);
+			float ax = sinf(yaw) * cosf(pitch), ay = sinf(pitch), az = cosf(yaw) * cosf(pitch);
+			for(unsigned q = 0; q < count; ++q)
+				depth[q] = pos[q*3+0] * ax + pos[q*3+1] * ay + pos[q*3+2] * az;
+
+			double start = seconds();
+			for(unsigned q = 0; q < count; ++q)
+				reference[q] = q;
+			std::sort(reference.begin(), reference.end(), ByDepth(&depth[0]));
+			fullTime += seconds() - start;
+
+			start = seconds();
+			unsigned const* order = sorter.sort(&depth[0], count);
+			coherentTime += seconds() - start;
+
+			for(unsigned q = 1; q < count && same; ++q)
+				same = depth[order[q-1]] <= depth[order[q]];
+		}
+
+		mutalisk::CoherentDepthSort::Stats const& stats = sorter.stats();
+		printf("%6u balls: std::sort %7.3f ms, coherent %7.3f ms (%.1fx), insertion %u, radix %u, moves/frame %u%s\n",
+			count, 1000 * fullTime / frames, 1000 * coherentTime / frames, fullTime / coherentTime,
+			stats.insertionSorts, stats.radixSorts, stats.moves / frames, same? "": " UNSORTED");
+	}
+	return 0;
+}
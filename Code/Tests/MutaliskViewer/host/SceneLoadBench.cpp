@@ -0,0 +1,273 @@
+// Load time of the largest demo scenes with the resource loads of
+// RenderableScene::prepare spread over ResourceLoader workers, against the
+// serial path without workers. Each pass reads and parses every mesh and the
+// animations of a scene and reads and hashes its textures, the jobs psp
+// prepare() issues; results are published in scene order the same way.
+//
+// Files come from the page cache after the first pass, so every scene is also
+// loaded with a memory stick model: a job sleeps for the transfer time of its
+// file before reading it, leaving the cpu to the other workers like a thread
+// blocked in sceIoRead does. There is one stick, transfers take turns on it.
+// --stick sets the rate in KB/s, 0 turns it off.
+// A checksum over the published resources must match the serial one for
+// every worker count.
+
+#include <player/ResourceLoader.h>
+#include <player/ResourceCache.h>
+#include <mutalisk/mutalisk.h>
+#include <mutalisk/platform.h>
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+using namespace mutalisk;
+
+namespace
+{
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+
+	// the worker half of the psp TextureJob
+	struct TextureJob : public ResourceLoader::Job
+	{
+		explicit TextureJob(std::string const& fullName) : fullName(fullName), data(0), size(0), hash(0) {}
+		~TextureJob() { free(data); }
+
+		virtual void run()
+		{
+			data = readFile(fullName, size, sizeof(data::MtxHeader));
+			if(data)
+				hash = contentHash(data, size);
+		}
+
+		std::string		fullName;
+		void*			data;
+		unsigned		size;
+		unsigned		hash;
+	};
+
+	pthread_mutex_t gStick = PTHREAD_MUTEX_INITIALIZER;
+
+	// waits out the transfer before the real read
+	template <typename JobT>
+	struct StickJob : public JobT
+	{
+		StickJob(std::string const& fullName, unsigned delayUs) : JobT(fullName), delayUs(delayUs) {}
+
+		virtual void run()
+		{
+			if(delayUs)
+			{
+				pthread_mutex_lock(&gStick);
+				usleep(delayUs);
+				pthread_mutex_unlock(&gStick);
+			}
+			JobT::run();
+		}
+
+		unsigned	delayUs;
+	};
+
+	unsigned fileSize(std::string const& fullName)
+	{
+		unsigned size = 0;
+		void* data = readFile(fullName, size);
+		free(data);
+		return size;
+	}
+
+	// the files of a scene, their sizes and stick transfer times
+	struct SceneFiles
+	{
+		std::vector<std::string>	meshes;
+		std::vector<std::string>	textures;
+		std::string					anim;
+		std::vector<unsigned>		meshUs;
+		std::vector<unsigned>		textureUs;
+		unsigned					animUs;
+		unsigned					bytes;
+
+		SceneFiles(data::scene const& scene, std::string const& prefix) : animUs(0), bytes(0)
+		{
+			for(size_t q = 0; q < scene.meshIds.size(); ++q)
+				meshes.push_back(prefix + scene.meshIds[q]);
+			for(size_t q = 0; q < scene.textureIds.size(); ++q)
+				textures.push_back(prefix + scene.textureIds[q]);
+			anim = prefix + scene.animCharId;
+		}
+
+		unsigned count() const { return unsigned(meshes.size() + textures.size() + 1); }
+
+		void setStick(unsigned stickKBps)
+		{
+			bytes = 0;
+			meshUs.resize(meshes.size());
+			for(size_t q = 0; q < meshes.size(); ++q)
+				meshUs[q] = transferUs(meshes[q], stickKBps);
+			textureUs.resize(textures.size());
+			for(size_t q = 0; q < textures.size(); ++q)
+				textureUs[q] = transferUs(textures[q], stickKBps);
+			animUs = transferUs(anim, stickKBps);
+		}
+
+		unsigned transferUs(std::string const& fullName, unsigned stickKBps)
+		{
+			unsigned size = fileSize(fullName);
+			bytes += size;
+			return stickKBps? unsigned(size * 1000000.0 / (stickKBps * 1024.0)): 0;
+		}
+	};
+
+	unsigned mix(unsigned checksum, unsigned value)
+	{
+		return contentHash(&value, sizeof(value), checksum);
+	}
+
+	// one prepare() worth of loads; returns a checksum of what was published
+	unsigned load(SceneFiles const& files, unsigned workers)
+	{
+		typedef StickJob<LoadJob<data::mesh> > MeshJob;
+		typedef StickJob<TextureJob> StickTextureJob;
+		typedef StickJob<LoadJob<mutant::anim_character_set> > AnimJob;
+
+		std::vector<MeshJob*> meshJobs;
+		std::vector<StickTextureJob*> textureJobs;
+		AnimJob animJob(files.anim, files.animUs);
+		for(size_t q = 0; q < files.meshes.size(); ++q)
+			meshJobs.push_back(new MeshJob(files.meshes[q], files.meshUs[q]));
+		for(size_t q = 0; q < files.textures.size(); ++q)
+			textureJobs.push_back(new StickTextureJob(files.textures[q], files.textureUs[q]));
+
+		unsigned checksum = 2166136261U;
+		{
+			// same order as prepare()
+			ResourceLoader loader(workers);
+			loader.add(animJob);
+			for(size_t q = 0; q < meshJobs.size(); ++q)
+				loader.add(*meshJobs[q]);
+			for(size_t q = 0; q < textureJobs.size(); ++q)
+				loader.add(*textureJobs[q]);
+
+			for(size_t q = 0; q < meshJobs.size(); ++q)
+			{
+				loader.wait(*meshJobs[q]);
+				data::mesh const* mesh = meshJobs[q]->resource.get();
+				checksum = mix(checksum, mesh? mesh->vertexCount: ~0U);
+				checksum = mix(checksum, mesh? mesh->indexCount: ~0U);
+				if(mesh && mesh->vertexData)
+					checksum = contentHash(mesh->vertexData, mesh->vertexDataSize, checksum);
+			}
+			for(size_t q = 0; q < textureJobs.size(); ++q)
+			{
+				loader.wait(*textureJobs[q]);
+				checksum = mix(checksum, textureJobs[q]->hash);
+			}
+			loader.wait(animJob);
+			mutant::anim_character_set const* animCharSet = animJob.resource.get();
+			checksum = mix(checksum, animCharSet? (unsigned)animCharSet->size(): ~0U);
+			for(size_t q = 0; animCharSet && q < animCharSet->size(); ++q)
+				checksum = mix(checksum, (unsigned)(*animCharSet)[q].size());
+		}
+
+		for(size_t q = 0; q < meshJobs.size(); ++q)
+			delete meshJobs[q];
+		for(size_t q = 0; q < textureJobs.size(); ++q)
+			delete textureJobs[q];
+		return checksum;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string root = "../../../../ReleaseCandidate/__SCE__SuicideBarbie/BarbieData/";
+	unsigned stickKBps = 2048;
+	std::vector<std::string> sceneNames;
+	for(int q = 1; q < argc; ++q)
+	{
+		if(std::string(argv[q]) == "--data" && q + 1 < argc)
+			root = std::string(argv[++q]) + "/";
+		else if(std::string(argv[q]) == "--stick" && q + 1 < argc)
+			stickKBps = unsigned(atoi(argv[++q]));
+		else
+			sceneNames.push_back(argv[q]);
+	}
+	if(sceneNames.empty())
+	{
+		sceneNames.push_back("walk/psp/walk.msk");
+		sceneNames.push_back("text/psp/text.msk");
+		sceneNames.push_back("flower/psp/flower.msk");
+		sceneNames.push_back("suicidebarbie2/psp/suicidebarbie2.msk");
+		sceneNames.push_back("telephone_s3/psp/telephone_s3.msk");
+	}
+
+	unsigned const workerCounts[] = { 0, 1, 2, 4 };
+	unsigned const configs = sizeof(workerCounts) / sizeof(workerCounts[0]);
+
+	int failures = 0;
+	fprintf(stderr, "%-38s %-11s %5s %6s", "scene", "source", "files", "KB");
+	for(unsigned w = 0; w < configs; ++w)
+		fprintf(stderr, workerCounts[w]? "  %u workers": "     serial", workerCounts[w]);
+	fprintf(stderr, "  (median ms)\n");
+
+	for(size_t s = 0; s < sceneNames.size(); ++s)
+	{
+		std::string const sceneFile = root + sceneNames[s];
+		std::string const prefix = sceneFile.substr(0, sceneFile.find_last_of('/') + 1);
+
+		LoadJob<data::scene> sceneJob(sceneFile);
+		sceneJob.run();
+		if(!sceneJob.resource.get())
+		{
+			++failures;
+			continue;
+		}
+		SceneFiles files(*sceneJob.resource, prefix);
+
+		for(int stick = 0; stick < (stickKBps? 2: 1); ++stick)
+		{
+			files.setStick(stick? stickKBps: 0);
+			int const passes = stick? 3: 9;
+
+			char source[32];
+			snprintf(source, sizeof(source), stick? "%u KB/s": "page cache", stickKBps);
+			fprintf(stderr, "%-38s %-11s %5u %6u", sceneNames[s].c_str(), source, files.count(), files.bytes / 1024);
+
+			unsigned const serialChecksum = load(files, 0);
+			for(unsigned w = 0; w < configs; ++w)
+			{
+				std::vector<double> times;
+				for(int p = 0; p < passes; ++p)
+				{
+					double start = seconds();
+					unsigned checksum = load(files, workerCounts[w]);
+					times.push_back((seconds() - start) * 1000.0);
+					if(checksum != serialChecksum)
+					{
+						fprintf(stderr, "\nFAILED %s with %u workers published other resources than the serial load\n",
+							sceneNames[s].c_str(), workerCounts[w]);
+						++failures;
+					}
+				}
+				std::sort(times.begin(), times.end());
+				fprintf(stderr, " %10.2f", times[passes / 2]);
+			}
+			fprintf(stderr, "\n");
+		}
+	}
+
+	if(failures)
+	{
+		fprintf(stderr, "%d failures\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+// Skins random vertices with PreparedSkin and with the per vertex loop it
+// replaced, which stays the reference:
+//
+//	- weights summing to 1 over one to four bones give the same positions
+//	  and normals
+//	- weights below the prune threshold are dropped without moving the vertex
+//	- vertices with all weights zero or below the threshold end at the origin
+//	  both ways
+// Exits with 1 on the first broken invariant.
+
+#include <player/ScenePlayer.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace mutalisk;
+
+namespace
+{
+	enum { Bones = 6, WeightsPerVertex = 4, Vertices = 4096 };
+	float const Tolerance = 1e-3f;
+
+	int gFailures = 0;
+
+	void expect(bool ok, char const* what, unsigned a = 0, unsigned b = 0)
+	{
+		if(!ok)
+		{
+			fprintf(stderr, "FAILED %s (%u, %u)\n", what, a, b);
+			++gFailures;
+		}
+	}
+
+	float random01()
+	{
+		return static_cast<float>(rand()) / RAND_MAX;
+	}
+
+	float randomSigned(float range)
+	{
+		return (random01() * 2.0f - 1.0f) * range;
+	}
+
+	// a rotation around z and a translation
+	CTransform::t_matrix randomPose()
+	{
+		float const a = randomSigned(3.0f);
+		float const c = cosf(a), s = sinf(a);
+		return CTransform::t_matrix(
+			c, s, 0.0f,
+			-s, c, 0.0f,
+			0.0f, 0.0f, 1.0f,
+			randomSigned(10.0f), randomSigned(10.0f), randomSigned(10.0f));
+	}
+
+	enum VertexKind { Normalized, Single, Pruned, Zero, BelowThreshold, Kinds };
+
+	void randomWeights(float* weights, unsigned char* boneIds, VertexKind kind)
+	{
+		for(unsigned w = 0; w < WeightsPerVertex; ++w)
+		{
+			boneIds[w] = static_cast<unsigned char>(rand() % Bones);
+			weights[w] = 0.0f;
+		}
+
+		switch(kind)
+		{
+		case Normalized:
+		{
+			float total = 0.0f;
+			for(unsigned w = 0; w < WeightsPerVertex; ++w)
+				total += (weights[w] = 0.05f + random01());
+			for(unsigned w = 0; w < WeightsPerVertex; ++w)
+				weights[w] /= total;
+			break;
+		}
+		case Single:
+			weights[rand() % WeightsPerVertex] = 1.0f;
+			break;
+		case Pruned:
+			for(unsigned w = 0; w < WeightsPerVertex; ++w)
+				weights[w] = 0.0002f;
+			weights[rand() % WeightsPerVertex] = 1.0f;
+			break;
+		case BelowThreshold:
+			for(unsigned w = 0; w < WeightsPerVertex; ++w)
+				weights[w] = 0.0005f;
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool near(Vec3 const& a, Vec3 const& b)
+	{
+		return fabsf(a.x - b.x) <= Tolerance && fabsf(a.y - b.y) <= Tolerance && fabsf(a.z - b.z) <= Tolerance;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	srand(17);
+
+	data::skin_info skinInfo;
+	skinInfo.weightsPerVertex = WeightsPerVertex;
+	skinInfo.bones.resize(Bones);
+	std::vector<CTransform::t_matrix> pose(Bones);
+	CSkinnedAlgos::BoneMapT boneMap;
+	for(unsigned q = 0; q < Bones; ++q)
+	{
+		// bind matrices as exported, transposed against Mat34; see setMatrix
+		CTransform::t_matrix bind = randomPose();
+		float* m = skinInfo.bones[q].matrix.data;
+		for(unsigned r = 0; r < 3; ++r)
+		{
+			Vec3 const& row = bind.Rot.Row[r];
+			m[r] = row.x; m[4 + r] = row.y; m[8 + r] = row.z;
+		}
+		m[3] = m[7] = m[11] = 0.0f;
+		m[12] = bind.Move.x; m[13] = bind.Move.y; m[14] = bind.Move.z; m[15] = 1.0f;
+
+		pose[q] = randomPose();
+		boneMap.push_back(std::make_pair(int(q), int(q)));
+	}
+
+	std::vector<Vec3> positions(Vertices), normals(Vertices);
+	std::vector<float> weights(Vertices * WeightsPerVertex);
+	std::vector<unsigned char> boneIds(Vertices * WeightsPerVertex);
+	for(unsigned q = 0; q < Vertices; ++q)
+	{
+		Vec3 p = { randomSigned(5.0f), randomSigned(5.0f), randomSigned(5.0f) };
+		Vec3 n = { randomSigned(1.0f), randomSigned(1.0f), randomSigned(1.0f) };
+		positions[q] = p;
+		normals[q] = n;
+		randomWeights(&weights[q * WeightsPerVertex], &boneIds[q * WeightsPerVertex], VertexKind(q % Kinds));
+	}
+
+	size_t const vertexStride = sizeof(Vec3), weightStride = WeightsPerVertex * sizeof(float);
+	std::vector<Vec3> refPositions(Vertices), refNormals(Vertices);
+	CSkinnedAlgos::processSkinMesh(&positions[0], &normals[0], &weights[0], &boneIds[0], &refPositions[0], &refNormals[0],
+		vertexStride, weightStride, WeightsPerVertex, vertexStride, Vertices, skinInfo, boneMap, &pose[0]);
+
+	PreparedSkin skin;
+	CSkinnedAlgos::prepareSkin(skin, &weights[0], &boneIds[0], weightStride, WeightsPerVertex, Vertices, skinInfo);
+	expect(!skin.empty() && skin.groups[0].influences == 0, "vertices without influences grouped first");
+
+	// garbage in the targets, every vertex has to be written
+	Vec3 const garbage = { 1e6f, -1e6f, 1e6f };
+	std::vector<Vec3> outPositions(Vertices, garbage), outNormals(Vertices, garbage);
+	CSkinnedAlgos::processPreparedSkin(&positions[0], &normals[0], &outPositions[0], &outNormals[0],
+		vertexStride, vertexStride, skin, boneMap, &pose[0]);
+
+	Vec3 const origin = { 0.0f, 0.0f, 0.0f };
+	for(unsigned q = 0; q < Vertices; ++q)
+	{
+		VertexKind const kind = VertexKind(q % Kinds);
+		if(!near(outPositions[q], refPositions[q]) || !near(outNormals[q], refNormals[q]))
+		{
+			expect(false, "prepared skinning against the per vertex loop", q, kind);
+			break;
+		}
+		if((kind == Zero || kind == BelowThreshold) && (!near(outPositions[q], origin) || !near(outNormals[q], origin)))
+		{
+			expect(false, "vertex without influences at the origin", q, kind);
+			break;
+		}
+	}
+	expect(skin.prunedWeights >= (Vertices / Kinds) * (WeightsPerVertex - 1), "small weights pruned", skin.prunedWeights);
+
+	if(gFailures)
+	{
+		fprintf(stderr, "%d failures\n", gFailures);
+		return 1;
+	}
+	fprintf(stderr, "prepared skinning matches, %u groups, %u weights pruned\n", (unsigned)skin.groups.size(), skin.prunedWeights);
+	return 0;
+}
@@ -0,0 +1,87 @@
+// Measures SpriteBatch for 1k to 100k sprites spread randomly over a few
+// textures and blend states, the way the intro mixes glow layers and text.
+// Reports draw calls against one draw per sprite and the vertex build time,
+// and checks that every batch has a single state and keeps submission order.
+
+#include <SpriteBatch.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned const counts[] = { 1000, 10000, 50000, 100000 };
+	int const textureCount = 8;
+	int const blendCount = 3;
+	int const repeats = 20;
+
+	int textures[textureCount];
+	mutalisk::SpriteBatch::State states[textureCount * blendCount];
+	for(int t = 0; t < textureCount; ++t)
+		for(int b = 0; b < blendCount; ++b)
+		{
+			mutalisk::SpriteBatch::State& s = states[t * blendCount + b];
+			s.texture = &textures[t];
+			s.srcFix = (b == 0)? 0: 0x00c8c8c8 * b;
+			s.dstFix = (b == 0)? 0: 0x00a0a0a0;
+		}
+
+	printf("%8s %10s %8s %12s %12s\n", "sprites", "per-sprite", "batched", "add us", "build us");
+	bool ok = true;
+	for(unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+	{
+		unsigned const n = counts[c];
+		srand(n);
+		std::vector<int> stateOf(n);
+		for(unsigned q = 0; q < n; ++q)
+			stateOf[q] = rand() % (textureCount * blendCount);
+
+		std::vector<mutalisk::SpriteBatch::Vertex> vertices(n * 2);
+		mutalisk::SpriteBatch batch;
+		double addTime = 0.0, buildTime = 0.0;
+		size_t batchCount = 0;
+		for(int r = 0; r < repeats; ++r)
+		{
+			batch.clear();
+			double t0 = seconds();
+			for(unsigned q = 0; q < n; ++q)
+				batch.add(states[stateOf[q]], q % 480, (q / 480) % 272, 16, 16, q);
+			double t1 = seconds();
+			std::vector<mutalisk::SpriteBatch::Batch> const& batches = batch.build(&vertices[0]);
+			double t2 = seconds();
+			addTime += t1 - t0;
+			buildTime += t2 - t1;
+			batchCount = batches.size();
+
+			if(r == 0)
+			{
+				// color holds the submission index, it must increase within a batch
+				for(size_t b = 0; b < batches.size(); ++b)
+				{
+					mutalisk::SpriteBatch::Vertex const* v = &vertices[batches[b].firstVertex];
+					for(unsigned q = 2; q < batches[b].vertexCount; q += 2)
+						if(v[q].color <= v[q - 2].color || !(states[stateOf[v[q].color]] == batches[b].state))
+							ok = false;
+				}
+			}
+		}
+
+		printf("%8u %10u %8u %12.1f %12.1f\n", n, n, (unsigned)batchCount,
+			addTime * 1e6 / repeats, buildTime * 1e6 / repeats);
+	}
+
+	printf(ok? "batches verified\n": "BATCH ORDER MISMATCH\n");
+	return ok? 0: 1;
+}
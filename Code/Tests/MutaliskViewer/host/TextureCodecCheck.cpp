@@ -0,0 +1,248 @@
+// Round trips through the texture codec and its results against plain
+// per-pixel reference code, the way the GE documents the formats. Built with
+// SSE2 this checks the vector paths, with -mno-sse2 the scalar ones the PSP
+// runs; both have to give the same bits.
+//
+//	- swizzle against the block address formula, unswizzle undoes it
+//	- 16 bit conversions for every 16 bit value and random 8888 pixels,
+//	  16 -> 8888 -> 16 is exact
+//	- CLUT4/CLUT8: images with few colors survive quantization exactly, the
+//	  others map to the nearest palette entry
+// Exits with 1 on the first broken invariant.
+
+#include <mutalisk/texture_codec.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace mutalisk::data;
+
+namespace
+{
+	int gFailures = 0;
+
+	void expect(bool ok, char const* what, unsigned a = 0, unsigned b = 0)
+	{
+		if(!ok)
+		{
+			fprintf(stderr, "FAILED %s (%u, %u)\n", what, a, b);
+			++gFailures;
+		}
+	}
+
+	unsigned gSeed = 12345;
+	unsigned random32()
+	{
+		gSeed ^= gSeed << 13;
+		gSeed ^= gSeed >> 17;
+		gSeed ^= gSeed << 5;
+		return gSeed;
+	}
+
+	// channel widths in order r, g, b, a
+	void formatBits(int format, unsigned bits[4])
+	{
+		static unsigned const table[3][4] = { { 5, 6, 5, 0 }, { 5, 5, 5, 1 }, { 4, 4, 4, 4 } };
+		memcpy(bits, table[format], sizeof(table[format]));
+	}
+
+	unsigned reference16(unsigned pixel, int format)
+	{
+		unsigned bits[4];
+		formatBits(format, bits);
+		unsigned result = 0, shift = 0;
+		for(unsigned c = 0; c < 4; shift += bits[c++])
+		{
+			unsigned max = (1U << bits[c]) - 1;
+			unsigned v = (pixel >> (8 * c)) & 0xff;
+			result |= ((2 * v * max + 255) / 510) << shift;
+		}
+		return result;
+	}
+
+	unsigned reference8888(unsigned pixel, int format)
+	{
+		unsigned bits[4];
+		formatBits(format, bits);
+		unsigned result = 0, shift = 0;
+		for(unsigned c = 0; c < 4; shift += bits[c++])
+		{
+			unsigned v = 0xff;
+			if(bits[c])
+			{
+				unsigned max = (1U << bits[c]) - 1;
+				unsigned field = (pixel >> shift) & max;
+				// top bits repeated down, the exact value when max divides 255
+				v = 0;
+				for(int s = 8 - int(bits[c]); s > -int(bits[c]); s -= int(bits[c]))
+					v |= (s >= 0)? (field << s): (field >> -s);
+				v &= 0xff;
+			}
+			result |= v << (8 * c);
+		}
+		return result;
+	}
+
+	void checkSwizzle()
+	{
+		unsigned const sizes[][2] = { { 16, 8 }, { 32, 16 }, { 64, 8 }, { 256, 64 }, { 512, 272 }, { 48, 24 } };
+		for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+		{
+			unsigned const widthBytes = sizes[s][0], height = sizes[s][1];
+			std::vector<unsigned char> linear(widthBytes * height), swizzled(linear.size()), back(linear.size());
+			for(size_t q = 0; q < linear.size(); ++q)
+				linear[q] = static_cast<unsigned char>(random32());
+
+			swizzleTexture(&swizzled[0], &linear[0], widthBytes, height);
+			for(unsigned y = 0; y < height; ++y)
+				for(unsigned x = 0; x < widthBytes; ++x)
+				{
+					unsigned block = (y / 8) * (widthBytes / 16) + x / 16;
+					unsigned address = block * 128 + (y % 8) * 16 + x % 16;
+					if(swizzled[address] != linear[y * widthBytes + x])
+					{
+						expect(false, "swizzled byte at its block address", x, y);
+						y = height;
+						break;
+					}
+				}
+
+			unswizzleTexture(&back[0], &swizzled[0], widthBytes, height);
+			expect(back == linear, "unswizzle undoes swizzle", widthBytes, height);
+		}
+		expect(canSwizzle(480 * 2, 272) && !canSwizzle(24, 8) && !canSwizzle(16, 4), "swizzle size rules");
+	}
+
+	void check16(int format)
+	{
+		// every 16 bit value, from an odd offset so that vectors and tails
+		// both see them
+		std::vector<unsigned short> all(65536 + 3), back(all.size());
+		std::vector<unsigned> expanded(all.size());
+		for(unsigned q = 0; q < 65536; ++q)
+			all[q + 1] = static_cast<unsigned short>(q);
+
+		convert16To8888(&expanded[1], &all[1], 65536 + 1, format);
+		for(unsigned q = 0; q < 65536; ++q)
+			if(expanded[q + 1] != reference8888(q, format))
+			{
+				expect(false, "16 -> 8888 against reference", format, q);
+				break;
+			}
+
+		convert8888To16(&back[1], &expanded[1], 65536 + 1, format);
+		for(unsigned q = 0; q < 65536; ++q)
+			if(back[q + 1] != q)
+			{
+				expect(false, "16 -> 8888 -> 16 round trip", format, q);
+				break;
+			}
+
+		// random pixels and every channel value
+		unsigned const count = 4099;
+		std::vector<unsigned> pixels(count);
+		std::vector<unsigned short> reduced(count);
+		for(unsigned q = 0; q < count; ++q)
+			pixels[q] = (q < 256)? q * 0x01010101: random32();
+		convert8888To16(&reduced[0], &pixels[0], count, format);
+		for(unsigned q = 0; q < count; ++q)
+			if(reduced[q] != reference16(pixels[q], format))
+			{
+				expect(false, "8888 -> 16 against reference", format, pixels[q]);
+				break;
+			}
+	}
+
+	// first palette entry of the smallest squared RGBA distance
+	unsigned referenceNearest(unsigned pixel, unsigned const* clut, unsigned entries)
+	{
+		unsigned best = ~0U, index = 0;
+		for(unsigned e = 0; e < entries; ++e)
+		{
+			unsigned d = 0;
+			for(unsigned c = 0; c < 4; ++c)
+			{
+				int diff = int((pixel >> (8 * c)) & 0xff) - int((clut[e] >> (8 * c)) & 0xff);
+				d += unsigned(diff * diff);
+			}
+			if(d < best)
+			{
+				best = d;
+				index = e;
+			}
+		}
+		return index;
+	}
+
+	void checkClut(unsigned colors, unsigned maxColors, unsigned count)
+	{
+		std::vector<unsigned> palette(colors), image(count), back(count);
+		for(unsigned q = 0; q < colors; ++q)
+			palette[q] = random32();
+		// runs of the same color, as in flat texture areas
+		for(unsigned q = 0; q < count; ++q)
+			image[q] = (q && random32() % 4)? image[q - 1]: palette[random32() % colors];
+
+		unsigned clut[256];
+		unsigned entries = buildClut(clut, maxColors, &image[0], count);
+		expect(entries <= maxColors && entries > 0, "palette size", entries, maxColors);
+
+		std::vector<unsigned char> indices(count);
+		quantizeToClut(&indices[0], &image[0], count, clut, entries);
+		for(unsigned q = 0; q < count; ++q)
+			if(indices[q] != referenceNearest(image[q], clut, entries))
+			{
+				expect(false, "quantized to the nearest entry", q, indices[q]);
+				break;
+			}
+
+		std::vector<unsigned char> packed(count);
+		if(maxColors <= 16)
+		{
+			packClut4(&packed[0], &indices[0], count);
+			expandClut4(&back[0], &packed[0], count, clut);
+		}
+		else
+			expandClut8(&back[0], &indices[0], count, clut);
+
+		unsigned mismatches = 0;
+		for(unsigned q = 0; q < count; ++q)
+		{
+			if(back[q] != clut[indices[q]])
+			{
+				expect(false, "expanded through the palette", q, back[q]);
+				break;
+			}
+			mismatches += (back[q] != image[q]);
+		}
+		if(colors <= maxColors)
+			expect(mismatches == 0, "few colors survive quantization exactly", colors, mismatches);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	checkSwizzle();
+
+	for(int format = TextureFormat_5650; format <= TextureFormat_4444; ++format)
+		check16(format);
+
+	checkClut(16, 16, 4097);
+	checkClut(11, 16, 1023);
+	checkClut(256, 256, 8191);
+	checkClut(200, 256, 513);
+	checkClut(1000, 16, 4096);
+	checkClut(5000, 256, 65536);
+
+	expect(textureBitsPerPixel(TextureFormat_T4) == 4 && textureBitsPerPixel(TextureFormat_4444) == 16, "bits per pixel");
+
+	if(gFailures)
+	{
+		fprintf(stderr, "%d failures\n", gFailures);
+		return 1;
+	}
+	fprintf(stderr, "all round trips hold\n");
+	return 0;
+}
@@ -0,0 +1,162 @@
+// Converts a plain 2bpp intro animation (loop*.bin) into the delta + run length
+// format read by loadAnim() and compares both formats: size on disk and decode
+// throughput into T8 frames. The converted file is verified to decode to the
+// same frames before it is written.
+
+#include <IntroAnimCodec.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+	typedef std::vector<uint32_t> WordsT;
+
+	enum { MinSkip = 2 };		// shorter unchanged runs are cheaper as literals
+
+	// appends the tokens turning prev into curr, returns the token word count
+	uint32_t encodeFrame(WordsT const& prev, WordsT const& curr, WordsT& out)
+	{
+		size_t start = out.size();
+		size_t n = curr.size();
+		size_t i = 0;
+		while(i < n)
+		{
+			size_t skip = i;
+			while(skip < n && prev[skip] == curr[skip])
+				++skip;
+			if(skip == n)
+				break;
+			if(skip - i >= MinSkip)
+			{
+				out.push_back((uint32_t)((skip - i) << 1));
+				i = skip;
+			}
+
+			// literal run until the next long enough unchanged run
+			size_t end = i;
+			while(end < n)
+			{
+				size_t same = end;
+				while(same < n && same - end < MinSkip && prev[same] == curr[same])
+					++same;
+				if(same - end >= MinSkip || same == n)
+					break;
+				end = same + 1;
+			}
+			if(end > n)
+				end = n;
+			out.push_back((uint32_t)(((end - i) << 1) | 1));
+			for(size_t q = i; q < end; ++q)
+				out.push_back(prev[q] ^ curr[q]);
+			i = end;
+		}
+		return (uint32_t)(out.size() - start);
+	}
+
+	double seconds()
+	{
+		timeval tv;
+		gettimeofday(&tv, 0);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: %s in.bin [out.dlt]\n", argv[0]);
+		return 1;
+	}
+
+	FILE* in = fopen(argv[1], "rb");
+	uint32_t header[3];
+	if(!in || fread(header, 4, 3, in) != 3 || header[0] == INTRO_DELTA_MAGIC)
+	{
+		printf("unable to read plain animation %s\n", argv[1]);
+		return 1;
+	}
+	uint32_t frames = header[0], width = header[1], height = header[2];
+	size_t frameWords = width * height / 16;
+
+	std::vector<WordsT> packed(frames, WordsT(frameWords));
+	for(uint32_t f = 0; f < frames; ++f)
+		if(fread(&packed[f][0], 4, frameWords, in) != frameWords)
+		{
+			printf("truncated frame %u\n", f);
+			return 1;
+		}
+	fclose(in);
+
+	// encode
+	WordsT delta;
+	delta.push_back(INTRO_DELTA_MAGIC);
+	delta.push_back(frames);
+	delta.push_back(width);
+	delta.push_back(height);
+	WordsT zero(frameWords, 0);
+	for(uint32_t f = 0; f < frames; ++f)
+	{
+		size_t countAt = delta.size();
+		delta.push_back(0);
+		delta[countAt] = encodeFrame((f > 0)? packed[f - 1]: zero, packed[f], delta);
+	}
+
+	size_t plainBytes = 12 + frames * frameWords * 4;
+	size_t deltaBytes = delta.size() * 4;
+	printf("%s: %u frames %ux%u\n", argv[1], frames, width, height);
+	printf("size: plain %u bytes, delta %u bytes (%.1f%%)\n",
+		(unsigned)plainBytes, (unsigned)deltaBytes, 100.0 * deltaBytes / plainBytes);
+
+	// decode both formats, delta output must match
+	WordsT t8(frameWords * 4);
+	WordsT frame(frameWords);
+	for(uint32_t f = 0, pos = 4; f < frames; ++f)
+	{
+		uint32_t tokenWords = delta[pos++];
+		if(!applyFrameDelta(&delta[pos], tokenWords, &frame[0], frameWords) || frame != packed[f])
+		{
+			printf("FAILED: frame %u does not round trip\n", f);
+			return 1;
+		}
+		pos += tokenWords;
+	}
+
+	int const runs = 200;
+	double pixels = double(width) * height * frames * runs;
+	double start = seconds();
+	for(int r = 0; r < runs; ++r)
+		for(uint32_t f = 0; f < frames; ++f)
+			uncompressFrame(&packed[f][0], &t8[0], frameWords);
+	double plainTime = seconds() - start;
+
+	start = seconds();
+	for(int r = 0; r < runs; ++r)
+	{
+		memset(&frame[0], 0, frameWords * 4);
+		for(uint32_t f = 0, pos = 4; f < frames; ++f)
+		{
+			uint32_t tokenWords = delta[pos++];
+			applyFrameDelta(&delta[pos], tokenWords, &frame[0], frameWords);
+			uncompressFrame(&frame[0], &t8[0], frameWords);
+			pos += tokenWords;
+		}
+	}
+	double deltaTime = seconds() - start;
+	printf("decode: plain %.1f Mpixel/s, delta %.1f Mpixel/s\n", pixels / plainTime / 1e6, pixels / deltaTime / 1e6);
+
+	if(argc > 2)
+	{
+		FILE* out = fopen(argv[2], "wb");
+		if(!out || fwrite(&delta[0], 4, delta.size(), out) != delta.size())
+		{
+			printf("unable to write %s\n", argv[2]);
+			return 1;
+		}
+		fclose(out);
+	}
+	return 0;
+}
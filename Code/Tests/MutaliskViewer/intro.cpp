@@ -5,10 +5,13 @@
 #include <pspgu.h>
 
 #include <platform.h>
+#include <mutalisk/texture_codec.h>
 
 #include <pspdisplay.h>
 #include "intro.h"
 #include "AnimCreator.h"
+#include "IntroAnimCodec.h"
+#include "SpriteBatch.h"
 
 /*
 
@@ -114,7 +117,6 @@ SceUID startIntro(const IntroRenderTarget renderTarget[2])
 	return introth;
 }
 
-void uncompressFrame(uint32_t* in, uint32_t* out, int size);
 mutalisk::data::psp_texture* loadTexture(const std::string& name);
 int loadAnim(const std::string name, std::vector<mutalisk::data::psp_texture*>& textures);
 void drawDots(float time, int evenFrame, float fade);
@@ -252,6 +254,9 @@ int loadAnim(const std::string name, std::vector<mutalisk::data::psp_texture*>&
 	uint32_t height;
 
 	sceIoRead(fd, &frames, 4);
+	bool isDelta = (frames == INTRO_DELTA_MAGIC);
+	if (isDelta)
+		sceIoRead(fd, &frames, 4);
 	sceIoRead(fd, &width, 4);
 	sceIoRead(fd, &height, 4);
 
@@ -263,16 +268,36 @@ int loadAnim(const std::string name, std::vector<mutalisk::data::psp_texture*>&
 	uint32_t frameSizePacked = width * height / 4;
 	uint32_t mtxSize = frameSizeUnpacked + sizeof(mutalisk::data::MtxHeader) + sizeof(uint32_t) * 8;
 
+	// delta frames are applied in place on the previous packed frame,
+	// worst case token stream is one token per word plus the word itself
 	uint32_t* framePtr = (uint32_t*)malloc(frameSizePacked);
-	uint32_t* tempPtr = (uint32_t*)malloc(frameSizeUnpacked);
+	uint32_t* tokenPtr = isDelta? (uint32_t*)malloc(frameSizePacked * 2): 0;
+	if (isDelta)
+		memset(framePtr, 0x00, frameSizePacked);
+
+	// frames are stored swizzled, the GE samples them a block at a time
+	bool swizzle = mutalisk::data::canSwizzle(width, height);
+	uint8_t* linearPtr = swizzle? (uint8_t*)malloc(frameSizeUnpacked): 0;
 
 	textures.resize(0);
 	textures.reserve(frames);
 
 	for (uint32_t i = 0; i < frames; ++i)
 	{
-		sceIoRead(fd, framePtr, frameSizePacked);
-		uncompressFrame(framePtr, tempPtr, frameSizePacked / 4);
+		if (isDelta)
+		{
+			uint32_t tokenWords = 0;
+			sceIoRead(fd, &tokenWords, 4);
+			if (tokenWords > frameSizePacked / 2 ||
+				sceIoRead(fd, tokenPtr, tokenWords * 4) != (int)(tokenWords * 4) ||
+				!applyFrameDelta(tokenPtr, tokenWords, framePtr, frameSizePacked / 4))
+			{
+				printf("corrupt delta frame %i\n", i);
+				break;
+			}
+		}
+		else
+			sceIoRead(fd, framePtr, frameSizePacked);
 
 		mutalisk::data::MtxHeader* mtxPtr = (mutalisk::data::MtxHeader*)malloc(mtxSize);
 		memset(mtxPtr, 0x00, sizeof(mutalisk::data::MtxHeader));
@@ -285,9 +310,15 @@ int loadAnim(const std::string name, std::vector<mutalisk::data::psp_texture*>&
 		mtxPtr->clutFormat		= GU_PSM_8888;
 		mtxPtr->clutEntries		= 1;
 		mtxPtr->paletteOffset	= frameSizeUnpacked;
+		mtxPtr->swizzle			= swizzle;
 
-		//swizzle here
-		memcpy(mtxPtr+1, tempPtr, (width * height));
+		if (swizzle)
+		{
+			uncompressFrame(framePtr, (uint32_t*)linearPtr, frameSizePacked / 4);
+			mutalisk::data::swizzleTexture(mtxPtr+1, linearPtr, width, height);
+		}
+		else
+			uncompressFrame(framePtr, (uint32_t*)(mtxPtr+1), frameSizePacked / 4);
 		uint32_t* palette = (uint32_t*)((uint32_t)(mtxPtr+1) + frameSizeUnpacked);
 		memset(palette, 0x00, sizeof(uint32_t)*8);
 		*palette++ = 0xff000000;
@@ -301,31 +332,16 @@ int loadAnim(const std::string name, std::vector<mutalisk::data::psp_texture*>&
 		textures.push_back(texture);
 	}
 	free(framePtr);
-	free(tempPtr);
+	free(tokenPtr);
+	free(linearPtr);
 
 	sceIoClose(fd);
-	return frames;
-}
-
-void uncompressFrame(uint32_t* in, uint32_t* out, int size)
-{
-/*
-	original: 000000aa 000000bb 000000cc 000000dd
-	compress: aabbccdd eeffgghh iijjkkll mmnnoopp
-	swizzled: aaeeiimm bbffjjnn ccggkkoo ddhhllpp
-	decomprs: 0aa00000 0bb00000 0cc00000 0dd00000
-*/
-	for(int i = 0; i < size; ++i)
-	{
-		uint32_t input = *in++;
-		*out++ = ((input & 0xc0c0c0c0) >> 6);
-		*out++ = ((input & 0x30303030) >> 4);
-		*out++ = ((input & 0x0c0c0c0c) >> 2);
-		*out++ = ((input & 0x03030303));
-	}
+	return textures.size();
 }
 
+static mutalisk::SpriteBatch s_quads;
 void drawQuad(mutalisk::data::psp_texture& texture, uint32_t x, uint32_t y, int blurSrcModifier = 200, int blurDstModifier = 160);
+void flushQuads();
 void renderIntro(float time)
 {
 	float out = 1.f;
@@ -351,6 +367,7 @@ void renderIntro(float time)
 		t *= out;
 		drawQuad(*centerDot, 168+49, 88, 0xff * t, 0x00);
 	}
+	flushQuads();
 	clearRect(100, 172, 280, 70);
 	{
 		static int evenFrame = 0;
@@ -368,6 +385,7 @@ void renderIntro(float time)
 		drawQuad(*tblTextA, 160,     225, alpha, 0x00);
 		drawQuad(*tblTextB, 160+128, 225, alpha, 0x00);
 	}
+	flushQuads();
 }
 
 void renderPSPLogo(float time)
@@ -387,6 +405,7 @@ void renderPSPLogo(float time)
 
 	drawQuad(*pspLogoA, 90,     72, 0xff * t, 0x00);
 	drawQuad(*pspLogoB, 90+256, 72, 0xff * t, 0x00);
+	flushQuads();
 }
 
 
@@ -422,53 +441,69 @@ void drawDots(float time, int evenFrame, float fade)
 }
 
 
+// quads are queued and drawn in one stream per texture/blend state by flushQuads
 void drawQuad(mutalisk::data::psp_texture& texture, uint32_t x, uint32_t y, int blurSrcModifier, int blurDstModifier)
 {
-//	int blurSrcModifier = 200;
-//	int blurDstModifier = 160;
-uint32_t color = 0x20ffffff;
-					sceGuEnable(GU_BLEND);
-					unsigned int srcFix = GU_ARGB(0, blurSrcModifier, blurSrcModifier, blurSrcModifier);
-					unsigned int dstFix = GU_ARGB(0, blurDstModifier, blurDstModifier, blurDstModifier);
-			if (blurDstModifier != 0x00)
-					sceGuBlendFunc(GU_ADD, GU_FIX, GU_FIX, srcFix, dstFix);
-			else
-			{
-					sceGuBlendFunc(GU_ADD, GU_SRC_ALPHA, GU_ONE_MINUS_SRC_ALPHA, 0, 0);
-					color = GU_ARGB(blurSrcModifier, blurSrcModifier, blurSrcModifier, blurSrcModifier);
-			}
+	mutalisk::SpriteBatch::State state;
+	state.texture = &texture;
+	uint32_t color = 0x20ffffff;
+	if (blurDstModifier != 0x00)
+	{
+		state.srcFix = GU_ARGB(0, blurSrcModifier, blurSrcModifier, blurSrcModifier);
+		state.dstFix = GU_ARGB(0, blurDstModifier, blurDstModifier, blurDstModifier);
+	}
+	else
+	{
+		// alpha blending, the modifier goes into the vertex color
+		state.srcFix = state.dstFix = 0;
+		color = GU_ARGB(blurSrcModifier, blurSrcModifier, blurSrcModifier, blurSrcModifier);
+	}
+	s_quads.add(state, x, y, texture.width, texture.height, color);
+}
+
+void flushQuads()
+{
+	if (s_quads.spriteCount() == 0)
+		return;
+
+	mutalisk::SpriteBatch::Vertex* vertices = reinterpret_cast<mutalisk::SpriteBatch::Vertex*>(
+		sceGuGetMemory(s_quads.vertexCount() * sizeof(mutalisk::SpriteBatch::Vertex)));
+	std::vector<mutalisk::SpriteBatch::Batch> const& batches = s_quads.build(vertices);
+
+	sceGuEnable(GU_BLEND);
 //	sceGuAlphaFunc(GU_ALWAYS, 0,0);
 	sceGuAmbientColor(~0U);
-	sceGuTexMode(texture.format,0,0,texture.swizzled);
-	sceGuTexImage(texture.mipmap,texture.width,texture.height,texture.stride,texture.data);
 	sceGuTexFilter(GU_LINEAR,GU_LINEAR);
 	sceGuTexWrap(GU_CLAMP, GU_CLAMP);
 //	sceGuTexFunc(GU_TFX_MODULATE,GU_TCC_RGB);
 	sceGuTexFunc(GU_TFX_MODULATE,GU_TCC_RGBA);
 //	sceGuTexScale(1.0f,1.0f);
 	sceGuEnable(GU_TEXTURE_2D);
-	sceGuColor(color);
 	sceGuDisable(GU_LIGHTING);
 	sceGuDisable(GU_DEPTH_TEST);
 	sceGuDepthMask(1);
-	sceGuClutMode(texture.clutFormat,0,0xff,0);
-	sceGuClutLoad(texture.clutEntries,texture.clut);
-	
-	struct QuadVertexTex
+
+	for (size_t i = 0; i < batches.size(); ++i)
 	{
-		float u, v;
-		short x,y,z;
-	};
-	QuadVertexTex* vertices = reinterpret_cast<QuadVertexTex*>(sceGuGetMemory(2 * sizeof(QuadVertexTex)));
-	vertices[0].u = 0; vertices[0].v = 0;
-	vertices[0].x = x; vertices[0].y = y; vertices[0].z = 0;
-	vertices[1].u = texture.width;
-	vertices[1].v = texture.height;
-	vertices[1].x = vertices[0].x + texture.width; vertices[1].y = vertices[0].y + texture.height; vertices[1].z = 0;
+		mutalisk::SpriteBatch::Batch const& batch = batches[i];
+		mutalisk::data::psp_texture const& texture = *static_cast<mutalisk::data::psp_texture const*>(batch.state.texture);
+
+		if (batch.state.dstFix != 0x00)
+			sceGuBlendFunc(GU_ADD, GU_FIX, GU_FIX, batch.state.srcFix, batch.state.dstFix);
+		else
+			sceGuBlendFunc(GU_ADD, GU_SRC_ALPHA, GU_ONE_MINUS_SRC_ALPHA, 0, 0);
 
-	sceGuDrawArray(GU_SPRITES,GU_TEXTURE_32BITF|GU_VERTEX_16BIT|GU_TRANSFORM_2D,2,0,vertices);
+		sceGuTexMode(texture.format,0,0,texture.swizzled);
+		sceGuTexImage(texture.mipmap,texture.width,texture.height,texture.stride,texture.data);
+		sceGuClutMode(texture.clutFormat,0,0xff,0);
+		sceGuClutLoad(texture.clutEntries,texture.clut);
+
+		sceGuDrawArray(GU_SPRITES,GU_TEXTURE_32BITF|GU_COLOR_8888|GU_VERTEX_16BIT|GU_TRANSFORM_2D,
+			batch.vertexCount,0,vertices + batch.firstVertex);
+	}
 
 	sceGuDepthMask(0);
+	s_quads.clear();
 }
 
 void clearRect(uint32_t x, uint32_t y, uint32_t w, uint32_t h)
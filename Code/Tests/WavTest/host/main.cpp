@@ -0,0 +1,100 @@
+// Host side benchmark of mutalisk::AudioStream. The producer thread streams
+// the file into the ring, the consumer thread drains it at playback rate into
+// a null sink and seeks to random positions; reports underruns and seek latency.
+
+#include <player/AudioStream.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+	class StdioAudioFile : public mutalisk::AudioFile
+	{
+	public:
+		StdioAudioFile(unsigned readDelayUs) : mFile(0), mReadDelayUs(readDelayUs) {}
+		~StdioAudioFile() { if(mFile) fclose(mFile); }
+
+		bool open(char const* fileName) { mFile = fopen(fileName, "rb"); return mFile != 0; }
+
+		// optional delay models the access time of slow media
+		virtual int read(void* dst, unsigned size) { if(mReadDelayUs) usleep(mReadDelayUs); return (int)fread(dst, 1, size, mFile); }
+		virtual bool seek(unsigned offset) { return fseek(mFile, offset, SEEK_SET) == 0; }
+
+	private:
+		FILE*		mFile;
+		unsigned	mReadDelayUs;
+	};
+
+	enum { OutputSamples = 1024 };
+
+	mutalisk::AudioStream gStream;
+	volatile bool gStreaming = true;
+
+	void* producer(void*)
+	{
+		while(gStreaming)
+		{
+			if(gStream.isFull() || !gStream.fill())
+				usleep(1000);
+		}
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("usage: %s file.wav [seconds] [seeks] [read delay ms]\n", argv[0]);
+		return 1;
+	}
+
+	float seconds = (argc > 2)? (float)atof(argv[2]): 10.0f;
+	unsigned seekCount = (argc > 3)? atoi(argv[3]): 50;
+	unsigned readDelayUs = (argc > 4)? (unsigned)(atof(argv[4]) * 1000): 0;
+
+	StdioAudioFile file(readDelayUs);
+	if(!file.open(argv[1]) || !gStream.open(&file))
+	{
+		printf("unable to open %s\n", argv[1]);
+		return 1;
+	}
+
+	mutalisk::AudioSeekIndex const& index = gStream.index();
+	printf("format %d, %u Hz, %u channels, %u blocks of %u bytes, %u samples\n",
+		index.format, index.frequency, index.channels, index.blockCount(), index.blockAlign, index.sampleCount());
+
+	unsigned blocksPerPeriod = (OutputSamples + index.samplesPerBlock - 1) / index.samplesPerBlock;
+	std::vector<unsigned char> sink(blocksPerPeriod * index.blockAlign);
+	unsigned periodUs = (unsigned)(1000000.0 * blocksPerPeriod * index.samplesPerBlock / index.frequency);
+	unsigned periods = (unsigned)(seconds * 1000000 / periodUs);
+	unsigned seekEvery = (seekCount > 0)? periods / seekCount + 1: ~0U;
+
+	pthread_t thread;
+	pthread_create(&thread, 0, producer, 0);
+
+	srand(1);
+	unsigned next = mutalisk::AudioStream::microseconds();
+	for(unsigned q = 0; q < periods && !gStream.finished(); ++q)
+	{
+		if(q > 0 && q % seekEvery == 0)
+			gStream.seek(rand() % index.sampleCount());
+
+		gStream.read(&sink[0], sink.size());
+
+		next += periodUs;
+		int wait = (int)(next - mutalisk::AudioStream::microseconds());
+		if(wait > 0)
+			usleep(wait);
+	}
+
+	gStreaming = false;
+	pthread_join(thread, 0);
+
+	gStream.printStats();
+	return 0;
+}
@@ -0,0 +1,157 @@
+#!/bin/bash
+#
+# Incremental replacement for goPsp.bat.
+#
+# Every scene listed in goPsp.bat is rebuilt only when the content of its
+# inputs (source assets, .props, the scene's batch files - goPsp.bat and the
+# ones it calls - and the converter executables) has changed since the last successful build. A manifest with
+# the content hash and the size/mtime of every input is kept in
+# <scene>/psp/.buildcache; the stat lines are compared first so an untouched
+# tree never has to be hashed. Dirty scenes are converted in parallel.
+#
+# usage: ./goPsp.sh [-f] [-j jobs] [scene ...]
+#	-f	ignore the cache and rebuild everything
+#	-j	number of scenes converted in parallel (default: cpu count)
+#
+# The converters are Windows executables; BAT_RUNNER selects how the scene
+# batch files are run (default: "cmd //c" under msys/cygwin, "wine cmd /c"
+# elsewhere).
+
+set -e
+
+cd "`dirname $0`" || { echo "ERROR: Could not enter the data directory."; exit 1; }
+
+TOOLS=../../Tools/bin
+CACHE_NAME=.buildcache
+
+if command -v sha1sum >/dev/null 2>&1; then
+	HASH="sha1sum"
+else
+	HASH="shasum"
+fi
+
+if stat -c '%s' goPsp.bat >/dev/null 2>&1; then
+	STAT="stat -c %n:%s:%Y"
+else
+	STAT="stat -f %N:%z:%m"
+fi
+
+if [ -z "$BAT_RUNNER" ]; then
+	case "$OSTYPE" in
+		msys*|cygwin*)	BAT_RUNNER="cmd //c" ;;
+		*)				BAT_RUNNER="wine cmd /c" ;;
+	esac
+fi
+export BAT_RUNNER
+
+now() {
+	if [ -n "$EPOCHREALTIME" ]; then
+		echo "$EPOCHREALTIME"
+	else
+		date +%s
+	fi
+}
+
+# inputs <scene>: every file the conversion of <scene> depends on; all batch
+# files of the scene count, goPsp.bat may @call the others
+inputs() {
+	ls -1 "$1"/*.fbx "$1"/*.props "$1"/*.tga "$1"/*.png "$1"/*.jpg "$1"/*.bmp "$1"/*.bat 2>/dev/null || true
+	echo "$TOOLS/ImportScene.exe"
+	echo "$TOOLS/ImageConverter.exe"
+}
+
+# contentHash <files>: single hash over names and contents of all files
+contentHash() {
+	$HASH "$@" | $HASH | cut -c1-40
+}
+
+# isCached <scene>: succeeds if the manifest still matches the inputs,
+# refreshes the recorded stats when only timestamps have changed
+isCached() {
+	local scene=$1
+	local manifest=$scene/psp/$CACHE_NAME
+	test -f "$manifest" || return 1
+
+	local files=`inputs "$scene"`
+	local stats=`$STAT $files`
+	if [ "`sed -n '2,$p' "$manifest"`" = "$stats" ]; then
+		return 0
+	fi
+
+	local hash=`contentHash $files`
+	if [ "`head -n 1 "$manifest"`" = "$hash" ]; then
+		{ echo "$hash"; echo "$stats"; } > "$manifest"
+		return 0
+	fi
+	return 1
+}
+
+# buildScene <scene>: runs the scene's goPsp.bat and records the manifest
+buildScene() {
+	local scene=$1
+	local files=`inputs "$scene"`
+	local stats=`$STAT $files`
+	local hash=`contentHash $files`
+
+	mkdir -p "$scene/psp"
+	rm -f "$scene/psp/$CACHE_NAME"
+	if ( cd "$scene" && $BAT_RUNNER goPsp.bat ); then
+		{ echo "$hash"; echo "$stats"; } > "$scene/psp/$CACHE_NAME"
+		echo "built: $scene"
+	else
+		echo "ERROR: Conversion of $scene failed."
+		return 1
+	fi
+}
+
+# internal entry point used by the parallel job pool below
+if [ "$1" = "--build-scene" ]; then
+	buildScene "$2"
+	exit $?
+fi
+
+FORCE=0
+JOBS=`nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4`
+while getopts "fj:" opt; do
+	case $opt in
+		f)	FORCE=1 ;;
+		j)	JOBS=$OPTARG ;;
+		*)	exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -gt 0 ]; then
+	SCENES="$*"
+else
+	SCENES=`sed -n 's/.*buildScenePsp\.bat[[:space:]]*\([^[:space:]]*\).*/\1/p' goPsp.bat | tr -d '\r'`
+fi
+
+START=`now`
+TOTAL=0
+HITS=0
+DIRTY=""
+for scene in $SCENES; do
+	TOTAL=$((TOTAL + 1))
+	if [ $FORCE = 0 ] && isCached "$scene"; then
+		HITS=$((HITS + 1))
+	else
+		DIRTY="$DIRTY $scene"
+	fi
+done
+
+FAILED=0
+if [ -n "$DIRTY" ]; then
+	printf '%s\n' $DIRTY | xargs -n 1 -P "$JOBS" "./`basename $0`" --build-scene || FAILED=1
+fi
+
+END=`now`
+awk -v total=$TOTAL -v hits=$HITS -v start=$START -v end=$END 'BEGIN {
+	rate = (total > 0) ? 100.0 * hits / total : 100.0;
+	printf("scenes: %d, cache hits: %d (%.1f%%), rebuilt: %d, time: %.2fs\n", total, hits, rate, total - hits, end - start);
+}'
+
+if [ $FAILED != 0 ]; then
+	echo "ERROR: Some scenes failed to convert."
+	exit 1
+fi
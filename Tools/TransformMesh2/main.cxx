@@ -178,6 +178,8 @@ int main(int argc, char** argv)
 		DisplayGenericInfo(lScene);
 	}
 
+	mutalisk::packTextureAtlases();
+
 	if(targetAllPlatforms)
 	{
 		mutalisk::saveScene(mutalisk::Platform::PSP);
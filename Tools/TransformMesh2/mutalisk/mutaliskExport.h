@@ -135,6 +135,7 @@ struct OutputTexture
 	std::string					name;
 	KFbxTexture*				parameters;
 	com_ptr<IDirect3DTexture9>	data;
+	bool						generated;		// atlas, has no source file
 };
 
 struct OutputScene
@@ -152,6 +153,9 @@ struct OutputScene
 		std::string				zBufferOp;
 		std::string				xTexWrapOp;
 		std::string				yTexWrapOp;
+		bool					inAtlas;
+		float					atlasOffset[2];
+		float					atlasScale[2];
 	};
 	typedef std::vector<Material>						MaterialsT;
 
@@ -231,6 +235,9 @@ float gGlobalScale = 0.01f;
 bool gEnableScalingPivots = true;
 bool gEnableAnimatedProperties = true;
 bool gEnableVisibilityFlag = false;
+bool gEnableTextureAtlas = false;
+unsigned gTextureAtlasSize = 256;
+unsigned gTextureAtlasMaxTileSize = 64;
 
 struct Curve
 {
@@ -1199,6 +1206,15 @@ void blit(OutputScene const& scene, mutalisk::data::scene& data)
 				data.actors[q].materials[w].shaderInput.transparency = i->transparency;
 			}
 
+			if(i->materials[w].inAtlas)
+			{ // atlas tile, applied after the material's own uv transform
+				mutalisk::data::shader_fixed& input = data.actors[q].materials[w].shaderInput;
+				input.uOffset = input.uOffset * i->materials[w].atlasScale[0] + i->materials[w].atlasOffset[0];
+				input.vOffset = input.vOffset * i->materials[w].atlasScale[1] + i->materials[w].atlasOffset[1];
+				input.uScale *= i->materials[w].atlasScale[0];
+				input.vScale *= i->materials[w].atlasScale[1];
+			}
+
 			{ // surface properties
 				mutalisk::data::Color& ambient = data.actors[q].materials[w].shaderInput.ambient;
 				mutalisk::data::Color& diffuse = data.actors[q].materials[w].shaderInput.diffuse;
@@ -1831,6 +1847,7 @@ OutputTexture* processTextureResource(std::string resourceName)
 	result.name = fileName2TextureName(resourceName);
 	result.parameters = 0;
 	result.data = textureData;
+	result.generated = false;
 
 	return &result;
 }
@@ -2764,8 +2781,11 @@ void beginScene(char const* sceneFileName)
 {
 	// LUA
 	std::string sceneProperties = mutalisk::fileName2SceneName(std::string(sceneFileName)) + ".props";
+	// compiled .props next to the converted scene, reused while the source is unchanged
+	mutalisk::lua::LuaPlayer::getInstance().setBytecodeCache(gPlatform.targetDir);
 	mutalisk::lua::LuaPlayer::getInstance().exec(sceneProperties);
 	mutalisk::lua::readFromResult(gProperties);
+	mutalisk::lua::LuaPlayer::getInstance().printStats();
 	mutalisk::lua::LuaPlayer::getInstance().garbageCollect();
 
 	{
@@ -2800,6 +2820,25 @@ void beginScene(char const* sceneFileName)
 			if(properties.vectors[EnableScalingPivots].size() > 0)
 				gEnableScalingPivots = (properties.vectors[EnableScalingPivots][0] > 0);
 		}
+
+		const std::string EnableTextureAtlas = "enableTextureAtlas";
+		if(properties.hasVector(EnableTextureAtlas))
+		{
+			if(properties.vectors[EnableTextureAtlas].size() > 0)
+				gEnableTextureAtlas = (properties.vectors[EnableTextureAtlas][0] > 0);
+		}
+		const std::string TextureAtlasSize = "textureAtlasSize";
+		if(properties.hasVector(TextureAtlasSize))
+		{
+			if(properties.vectors[TextureAtlasSize].size() > 0)
+				gTextureAtlasSize = static_cast<unsigned>(properties.vectors[TextureAtlasSize][0]);
+		}
+		const std::string TextureAtlasMaxTileSize = "textureAtlasMaxTileSize";
+		if(properties.hasVector(TextureAtlasMaxTileSize))
+		{
+			if(properties.vectors[TextureAtlasMaxTileSize].size() > 0)
+				gTextureAtlasMaxTileSize = static_cast<unsigned>(properties.vectors[TextureAtlasMaxTileSize][0]);
+		}
 	}
 	// \LUA
 
@@ -2819,6 +2858,299 @@ void processAnimation(KFbxScene* pScene)
 	processAnimation(gOutputScene.animResource["scene"], pScene);
 }
 
+// texture atlas
+//
+// Small clamped textures of the scene are packed into shared atlases, so that
+// the player opens and uploads fewer files and switches textures less often.
+// Materials keep their mesh uvs and get the tile rectangle through
+// uOffset/vOffset/uScale/vScale instead (saved since shader_fixed 0x0104),
+// so materials whose uv transform is animated stay out of the atlas. Tiles are surrounded with a gutter
+// of replicated edge texels, so bilinear filtering does not bleed between them.
+namespace {
+	unsigned const TEXTURE_ATLAS_GUTTER = 2;
+
+	struct AtlasTile
+	{
+		OutputTexture*	texture;
+		unsigned		width, height;
+		unsigned		x, y;
+		unsigned		atlasIndex;
+	};
+
+	bool byTileHeight(AtlasTile const& a, AtlasTile const& b)
+	{
+		if(a.height != b.height)
+			return a.height > b.height;
+		return a.width > b.width;
+	}
+
+	unsigned nextPow2(unsigned v)
+	{
+		unsigned result = 1;
+		while(result < v)
+			result <<= 1;
+		return result;
+	}
+
+	bool isClamped(std::string const& texWrapOp)
+	{
+		static TexWrapOpByName opByName;
+		if(texWrapOp == "")
+			return true; // shader_fixed default
+		return (opByName(texWrapOp) == mutalisk::data::shader_fixed::twoClamp);
+	}
+
+	// uvs of every vertex using the material, after the material's own uv
+	// transform, must stay inside the tile
+	bool hasUnitUvs(OutputSkinnedMesh const& mesh, size_t materialIndex, mutalisk::data::shader_fixed const& input)
+	{
+		float const UV_EPSILON = 1e-3f;
+		std::vector<OutputSkinnedMesh::IndexT> const& indices = (materialIndex < mesh.subsets.size())?
+			mesh.subsets[materialIndex].indices: mesh.indices;
+		for(size_t q = 0; q < indices.size(); ++q)
+		{
+			BaseSkinnedMesh::Vec3 const& uvw = mesh.vertices[indices[q]].uvw;
+			float const u = uvw[0] * input.uScale + input.uOffset;
+			float const v = uvw[1] * input.vScale + input.vOffset;
+			if(u < -UV_EPSILON || u > 1.0f + UV_EPSILON ||
+				v < -UV_EPSILON || v > 1.0f + UV_EPSILON)
+				return false;
+		}
+		return true;
+	}
+
+	// the players rewrite uOffset/vOffset/uScale/vScale of actors with these
+	// properties every frame, which would throw the tile transform away
+	bool hasUvProperties(OutputScene::Actor const& actor)
+	{
+		static char const* const names[] = { "UVScroll" };
+		OutputScene::Properties animated;
+		if(actor.node)
+			processAnimatedProperties(actor.node, animated);
+		for(size_t q = 0; q < sizeof(names) / sizeof(names[0]); ++q)
+			if(actor.properties.hasVector(names[q]) || actor.properties.hasCurve(names[q]) || animated.hasCurve(names[q]))
+				return true;
+		return false;
+	}
+
+	// approximates the sceGuTexImage calls issued by the player for the scene
+	unsigned countTextureSwitches(OutputScene const& scene)
+	{
+		unsigned switches = 0;
+		OutputTexture const* current = 0;
+		for(OutputScene::ActorsT::const_iterator i = scene.actors.begin(); i != scene.actors.end(); ++i)
+			for(size_t w = 0; w < i->materials.size(); ++w)
+				if(i->materials[w].colorTexture && i->materials[w].colorTexture != current)
+				{
+					current = i->materials[w].colorTexture;
+					++switches;
+				}
+		return switches;
+	}
+
+	void copyRect(IDirect3DSurface9* dst, RECT const& dstRect, IDirect3DSurface9* src, RECT const& srcRect)
+	{
+		HRESULT hr = D3DXLoadSurfaceFromSurface(dst, 0, &dstRect, src, 0, &srcRect, D3DX_FILTER_POINT, 0);
+		assertWarning(SUCCEEDED(hr), "Failed to copy texture into atlas");
+	}
+
+	void blitTile(IDirect3DSurface9* dst, IDirect3DSurface9* src, AtlasTile const& tile)
+	{
+		LONG const g = TEXTURE_ATLAS_GUTTER;
+		LONG const x = tile.x, y = tile.y, w = tile.width, h = tile.height;
+		RECT srcAll = { 0, 0, w, h };
+		RECT dstAll = { x, y, x + w, y + h };
+		copyRect(dst, dstAll, src, srcAll);
+
+		// gutter: edges and corners stretched from the outermost texels
+		RECT srcL = { 0, 0, 1, h },			dstL = { x - g, y, x, y + h };
+		RECT srcR = { w - 1, 0, w, h },		dstR = { x + w, y, x + w + g, y + h };
+		RECT srcT = { 0, 0, w, 1 },			dstT = { x, y - g, x + w, y };
+		RECT srcB = { 0, h - 1, w, h },		dstB = { x, y + h, x + w, y + h + g };
+		copyRect(dst, dstL, src, srcL);
+		copyRect(dst, dstR, src, srcR);
+		copyRect(dst, dstT, src, srcT);
+		copyRect(dst, dstB, src, srcB);
+
+		RECT srcTL = { 0, 0, 1, 1 },			dstTL = { x - g, y - g, x, y };
+		RECT srcTR = { w - 1, 0, w, 1 },		dstTR = { x + w, y - g, x + w + g, y };
+		RECT srcBL = { 0, h - 1, 1, h },		dstBL = { x - g, y + h, x, y + h + g };
+		RECT srcBR = { w - 1, h - 1, w, h },	dstBR = { x + w, y + h, x + w + g, y + h + g };
+		copyRect(dst, dstTL, src, srcTL);
+		copyRect(dst, dstTR, src, srcTR);
+		copyRect(dst, dstBL, src, srcBL);
+		copyRect(dst, dstBR, src, srcBR);
+	}
+}
+
+void packTextureAtlases(OutputScene& scene)
+{
+	if(!gEnableTextureAtlas)
+		return;
+
+	size_t const texturesBefore = scene.textureResources.size();
+	unsigned const switchesBefore = countTextureSwitches(scene);
+
+	// candidates: small textures used only as clamped color maps with a fixed
+	// uv transform
+	std::map<OutputTexture*, bool> atlasable;
+	for(OutputScene::OutputTexturesT::iterator i = scene.textureResources.begin(); i != scene.textureResources.end(); ++i)
+	{
+		if(!i->second.data)
+			continue;
+		D3DSURFACE_DESC desc;
+		i->second.data->GetLevelDesc(0, &desc);
+		if(desc.Width <= gTextureAtlasMaxTileSize && desc.Height <= gTextureAtlasMaxTileSize)
+			atlasable[&i->second] = false; // becomes true once referenced
+	}
+	// blit exports every material with the default uv transform
+	mutalisk::data::shader_fixed const exportedInput;
+	for(OutputScene::ActorsT::const_iterator i = scene.actors.begin(); i != scene.actors.end(); ++i)
+		for(size_t w = 0; w < i->materials.size(); ++w)
+		{
+			OutputScene::Material const& material = i->materials[w];
+			if(material.envmapTexture)
+				atlasable.erase(material.envmapTexture);
+
+			if(!material.colorTexture || material.systemTextureIndex != ~0U)
+				continue;
+			std::map<OutputTexture*, bool>::iterator it = atlasable.find(material.colorTexture);
+			if(it == atlasable.end())
+				continue;
+
+			if(!isClamped(material.xTexWrapOp) || !isClamped(material.yTexWrapOp) ||
+				!i->mesh || !hasUnitUvs(*i->mesh, w, exportedInput) || hasUvProperties(*i))
+				atlasable.erase(it);
+			else
+				it->second = true;
+		}
+
+	std::vector<AtlasTile> tiles;
+	for(std::map<OutputTexture*, bool>::const_iterator i = atlasable.begin(); i != atlasable.end(); ++i)
+	{
+		if(!i->second)
+			continue;
+		D3DSURFACE_DESC desc;
+		i->first->data->GetLevelDesc(0, &desc);
+		AtlasTile tile = { i->first, desc.Width, desc.Height, 0, 0, 0 };
+		tiles.push_back(tile);
+	}
+	std::sort(tiles.begin(), tiles.end(), byTileHeight);
+
+	// shelf packing
+	unsigned const size = gTextureAtlasSize;
+	std::vector<unsigned> atlasHeights;
+	unsigned shelfX = 0, shelfY = 0, shelfHeight = 0;
+	for(size_t q = 0; q < tiles.size(); ++q)
+	{
+		unsigned const w = tiles[q].width + 2 * TEXTURE_ATLAS_GUTTER;
+		unsigned const h = tiles[q].height + 2 * TEXTURE_ATLAS_GUTTER;
+		if(w > size || h > size)
+		{
+			tiles.erase(tiles.begin() + q--);
+			continue;
+		}
+
+		if(atlasHeights.empty())
+			atlasHeights.push_back(0);
+		if(shelfX + w > size)
+		{
+			shelfX = 0;
+			shelfY += shelfHeight;
+			shelfHeight = 0;
+		}
+		if(shelfY + h > size)
+		{
+			atlasHeights.push_back(0);
+			shelfX = shelfY = shelfHeight = 0;
+		}
+
+		tiles[q].atlasIndex = atlasHeights.size() - 1;
+		tiles[q].x = shelfX + TEXTURE_ATLAS_GUTTER;
+		tiles[q].y = shelfY + TEXTURE_ATLAS_GUTTER;
+		shelfX += w;
+		shelfHeight = max(shelfHeight, h);
+		atlasHeights.back() = max(atlasHeights.back(), shelfY + shelfHeight);
+	}
+
+	// single tile atlases only add gutter
+	std::vector<unsigned> tilesPerAtlas(atlasHeights.size(), 0);
+	for(size_t q = 0; q < tiles.size(); ++q)
+		++tilesPerAtlas[tiles[q].atlasIndex];
+
+	std::map<OutputTexture*, OutputTexture*> remap;
+	std::map<OutputTexture*, AtlasTile const*> tileByTexture;
+	for(size_t a = 0; a < atlasHeights.size(); ++a)
+	{
+		if(tilesPerAtlas[a] < 2)
+			continue;
+
+		unsigned const height = nextPow2(atlasHeights[a]);
+		com_ptr<IDirect3DTexture9> atlasData;
+		HRESULT hr = D3DXCreateTexture(gDxNullRefDevice, size, height, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &atlasData);
+		assertWarning(SUCCEEDED(hr), "Failed to create texture atlas", continue);
+
+		com_ptr<IDirect3DSurface9> dstSurface;
+		atlasData->GetSurfaceLevel(0, &dstSurface);
+
+		char atlasName[16];
+		sprintf_s(atlasName, sizeof(atlasName), "_atlas%d", static_cast<int>(a));
+		std::string const name = scene.name + atlasName;
+		OutputTexture& atlas = scene.textureResources[name];
+		atlas.source = name;
+		atlas.name = name;
+		atlas.parameters = 0;
+		atlas.data = atlasData;
+		atlas.generated = true;
+
+		for(size_t q = 0; q < tiles.size(); ++q)
+		{
+			if(tiles[q].atlasIndex != a)
+				continue;
+
+			com_ptr<IDirect3DSurface9> srcSurface;
+			tiles[q].texture->data->GetSurfaceLevel(0, &srcSurface);
+			blitTile(dstSurface, srcSurface, tiles[q]);
+
+			remap[tiles[q].texture] = &atlas;
+			tileByTexture[tiles[q].texture] = &tiles[q];
+		}
+		printf("Texture atlas %s: %dx%d, %d tiles\n", name.c_str(), size, height, tilesPerAtlas[a]);
+	}
+
+	// point materials to the atlas tiles
+	for(OutputScene::ActorsT::iterator i = scene.actors.begin(); i != scene.actors.end(); ++i)
+		for(size_t w = 0; w < i->materials.size(); ++w)
+		{
+			OutputScene::Material& material = i->materials[w];
+			std::map<OutputTexture*, OutputTexture*>::const_iterator it = remap.find(material.colorTexture);
+			if(it == remap.end())
+				continue;
+
+			AtlasTile const& tile = *tileByTexture[material.colorTexture];
+			D3DSURFACE_DESC desc;
+			it->second->data->GetLevelDesc(0, &desc);
+
+			material.colorTexture = it->second;
+			material.inAtlas = true;
+			material.atlasOffset[0] = static_cast<float>(tile.x) / desc.Width;
+			material.atlasOffset[1] = static_cast<float>(tile.y) / desc.Height;
+			material.atlasScale[0] = static_cast<float>(tile.width) / desc.Width;
+			material.atlasScale[1] = static_cast<float>(tile.height) / desc.Height;
+		}
+
+	for(std::map<OutputTexture*, OutputTexture*>::const_iterator i = remap.begin(); i != remap.end(); ++i)
+		scene.textureResources.erase(i->first->source);
+
+	printf("Texture atlas: %d textures -> %d, texture switches %d -> %d\n",
+		static_cast<int>(texturesBefore), static_cast<int>(scene.textureResources.size()), switchesBefore, countTextureSwitches(scene));
+}
+
+void packTextureAtlases()
+{
+	packTextureAtlases(gOutputScene);
+}
+
 void saveScene(Platform platform)
 {
 	setPlatform(platform);
@@ -2857,7 +3189,14 @@ void saveScene(Platform platform)
 		}
 		else if(gPlatform == Platform::PSP)
 		{
-			convertTexture(textureName2FileName(i->second.name), i->first);
+			if(i->second.generated)
+			{
+				std::string const tmpName = i->second.name + ".tga";
+				save(tmpName, *i->second.data);
+				convertTexture(textureName2FileName(i->second.name), outputFileName(tmpName));
+			}
+			else
+				convertTexture(textureName2FileName(i->second.name), i->first);
 		}
 	}
 